@@ -0,0 +1,753 @@
+/**
+bench_recip_arith.cpp
+encode & decode speed of the cdf->range maps , over cdf_bits , table bits and data
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#define _CRT_SECURE_NO_WARNINGS
+
+/**
+
+bench_recip_arith [options] [files]
+
+for each data set and each cdf_bits , normalizes the order-0 histogram , then times
+encode and decode with every map :
+
+    sm98 , sm98_64              (no multiply or divide)
+    cacm87 , cacm87_64          (decoder divides)
+    rangecoder , rangecoder64   (decoder divides)
+    recip_arith , recip_arith64 (RECIP_ARITH_TABLE_BITS)
+        all through recip_arith_policy_coder_t , on the 32-bit and 64-bit states
+    recip_arith_lj  (recip_arith_lj.h , range left-justified , no clz before the table lookup)
+    recip_arith_t   (recip_arith_coder_t from recip_arith_template.h , table_bits swept)
+
+data sets are the files on the command line plus synthetic byte streams :
+    uniform , geometric (p ~ 0.75^i) and skewed (90% on one symbol , the rest uniform)
+    each over alphabets of 2 , 16 , 64 and 256 symbols
+
+options :
+    -n <count>      synthetic symbols per data set (default 1M)
+    -runs <count>   timed runs per config (default 5)
+    -cdf <bits>     only this cdf_bits (default sweeps 10,12,14,16)
+    -nosynth        skip the synthetic data
+    -csv , -json    machine readable output (default is a text table)
+    -perf           also read hardware counters around the timed runs (Linux perf_event_open) :
+                    core cycles , IPC , branch misses and L1D read misses per symbol
+
+built with -DRECIP_ARITH_INSTRUMENT (on recip_arith.cpp too) it also reports the software counters
+from the checked round trip : renorm bytes per symbol and their distribution , carries and carry walks.
+
+loss is bpb minus the order-0 entropy of the data , so it includes the histogram
+normalization to cdf_bits as well as the map's own loss.
+
+each config is run once untimed and checked with memcmp , then timed runs times.
+speeds are reported from the median run , along with the best run and the relative
+standard deviation of the run times.  MB/s counts one symbol as one byte.
+
+cycles/symbol are from the time stamp counter (rdtsc) on x86 , which ticks at the nominal
+clock rate , not the core clock ; with turbo or power saving they are only comparable
+on the same machine.  elsewhere they are reported as 0.
+
+**/
+
+#include "recip_arith.h"
+#include "recip_arith_template.h"
+#include "recip_arith_lj.h"
+#include "recip_arith_reference_maps.h"
+#include "recip_arith_policy.h"
+#include "recip_arith_static_model.h"
+#include "recip_arith_perf.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BENCH_HAS_TSC   1
+static uint64_t bench_tsc() { return __rdtsc(); }
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC   1
+static uint64_t bench_tsc() { return __rdtsc(); }
+#else
+#define BENCH_HAS_TSC   0
+static uint64_t bench_tsc() { return 0; }
+#endif
+
+static double bench_seconds()
+{
+    return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+//=================================================================
+//
+// the maps , all with the same interface so one encode & decode loop times them all
+//  recip_arith_policy_coder_t has it for the four maps on both states ; these are the others
+
+// recip_arith_lj.h : the same bitstream with range left-justified , its own encoder & decoder state
+struct bench_state_lj
+{
+    typedef recip_arith_lj_encoder encoder;
+    typedef recip_arith_lj_decoder decoder;
+
+    static recip_arith_inline void encoder_start(encoder * ac,uint8_t * ptr) { recip_arith_lj_encoder_start(ac,ptr); }
+    static recip_arith_inline void encoder_renorm(encoder * ac) { recip_arith_lj_encoder_renorm(ac); }
+    static recip_arith_inline uint8_t * encoder_finish(encoder * ac) { return recip_arith_lj_encoder_finish(ac); }
+
+    static recip_arith_inline void decoder_start(decoder * ac,const uint8_t * ptr) { recip_arith_lj_decoder_start(ac,ptr); }
+    static recip_arith_inline void decoder_renorm(decoder * ac) { recip_arith_lj_decoder_renorm(ac); }
+};
+
+struct bench_map_recip_arith_lj : public bench_state_lj
+{
+    static recip_arith_inline void put(encoder * ac,uint32_t low,uint32_t freq,uint32_t cdf_bits) { recip_arith_lj_encoder_put(ac,low,freq,cdf_bits); }
+    static recip_arith_inline uint32_t peek(decoder * ac,uint32_t cdf_bits) { return recip_arith_lj_decoder_peek(ac,cdf_bits); }
+    static recip_arith_inline void remove(decoder * ac,uint32_t low,uint32_t freq,uint32_t) { recip_arith_lj_decoder_remove(ac,low,freq); }
+};
+
+// recip_arith_coder_t ignores the runtime cdf_bits , it was checked against t_coder::cdf_bits before the loops
+template <typename t_coder>
+struct bench_map_template : public recip_arith_state32
+{
+    static recip_arith_inline void put(encoder * ac,uint32_t low,uint32_t freq,uint32_t) { t_coder::put(ac,low,freq); }
+    static recip_arith_inline uint32_t peek(decoder * ac,uint32_t) { return t_coder::peek(ac); }
+    static recip_arith_inline void remove(decoder * ac,uint32_t low,uint32_t freq,uint32_t) { t_coder::remove(ac,low,freq); }
+};
+
+template <typename t_map>
+static size_t bench_encode(uint8_t * comp,const uint8_t * syms,size_t count,const uint32_t * cdf,uint32_t cdf_bits)
+{
+    typename t_map::encoder enc;
+    t_map::encoder_start(&enc,comp);
+
+    for(size_t i=0;i<count;i++)
+    {
+        int sym = syms[i];
+        uint32_t low = cdf[sym];
+        uint32_t freq = cdf[sym+1] - low;
+
+        t_map::put(&enc,low,freq,cdf_bits);
+        t_map::encoder_renorm(&enc);
+    }
+
+    return t_map::encoder_finish(&enc) - comp;
+}
+
+template <typename t_map>
+static void bench_decode(uint8_t * syms,size_t count,const uint8_t * comp,const uint32_t * cdf,const uint8_t * decode_table,uint32_t cdf_bits)
+{
+    typename t_map::decoder dec;
+    t_map::decoder_start(&dec,comp);
+
+    for(size_t i=0;i<count;i++)
+    {
+        uint32_t target = t_map::peek(&dec,cdf_bits);
+        uint8_t sym = decode_table[target];
+        syms[i] = sym;
+        uint32_t low = cdf[sym];
+        uint32_t freq = cdf[sym+1] - low;
+        t_map::remove(&dec,low,freq,cdf_bits);
+        t_map::decoder_renorm(&dec);
+    }
+}
+
+//=================================================================
+//
+// one data set with its model at one cdf_bits
+
+struct bench_case
+{
+    const char * data_name;
+    int alphabet;           // number of symbols used
+    double entropy_bpb;     // of the data's own histogram
+    const uint8_t * syms;
+    size_t count;
+
+    uint32_t cdf_bits;
+    uint32_t cdf[257];
+    uint8_t * decode_table; // (1<<cdf_bits)+1
+
+    uint8_t * comp;         // worst case plus decoder read-ahead
+    uint8_t * dec;
+};
+
+enum { BENCH_FORMAT_TEXT , BENCH_FORMAT_CSV , BENCH_FORMAT_JSON };
+
+struct bench_options
+{
+    size_t synth_count;
+    int runs;
+    int only_cdf_bits;  // 0 = sweep
+    bool synth;
+    int format;
+    bool perf;
+};
+
+static bench_options g_options = { 1<<20 , 5 , 0 , true , BENCH_FORMAT_TEXT , false };
+static int g_rows_written = 0;
+
+// opened in main if -perf and the kernel allows it :
+static recip_arith_perf g_perf;
+static bool g_have_perf = false;
+
+// timing summary of one direction
+struct bench_timing
+{
+    double mbps_median;
+    double mbps_best;
+    double cycles_per_symbol;   // of the median run
+    double rsd_percent;         // relative std dev of the run times
+
+    double perf_per_symbol[RECIP_ARITH_PERF_COUNT];    // over all timed runs , if g_have_perf
+
+    #ifdef RECIP_ARITH_INSTRUMENT
+    recip_arith_counters counters;  // of the checked round trip
+    #endif
+};
+
+static int bench_compare_doubles(const void * a,const void * b)
+{
+    double x = *(const double *)a , y = *(const double *)b;
+    return ( x < y ) ? -1 : ( x > y ) ? 1 : 0;
+}
+
+static bench_timing bench_summarize(const double * seconds,const double * ticks,int runs,size_t count)
+{
+    double sorted_seconds[64];
+    double sorted_ticks[64];
+    memcpy(sorted_seconds,seconds,runs*sizeof(double));
+    memcpy(sorted_ticks,ticks,runs*sizeof(double));
+    qsort(sorted_seconds,runs,sizeof(double),bench_compare_doubles);
+    qsort(sorted_ticks,runs,sizeof(double),bench_compare_doubles);
+
+    double median = sorted_seconds[runs/2];
+    double best = sorted_seconds[0];
+    if ( median <= 0.0 ) median = 1e-9;
+    if ( best <= 0.0 ) best = 1e-9;
+
+    double mean = 0.0;
+    for(int r=0;r<runs;r++) mean += seconds[r];
+    mean /= runs;
+    double var = 0.0;
+    for(int r=0;r<runs;r++) var += (seconds[r] - mean)*(seconds[r] - mean);
+    var /= ( runs > 1 ) ? (runs - 1) : 1;
+
+    bench_timing t;
+    t.mbps_median = count / (median * 1000000.0);
+    t.mbps_best = count / (best * 1000000.0);
+    t.cycles_per_symbol = sorted_ticks[runs/2] / count;
+    t.rsd_percent = ( mean > 0.0 ) ? 100.0 * sqrt(var) / mean : 0.0;
+    return t;
+}
+
+// the optional perf & counter fields , after the timing fields of one direction
+
+static void bench_write_extra_text(const char * dir,const bench_timing * t,size_t count)
+{
+    if ( g_have_perf )
+    {
+        const double * p = t->perf_per_symbol;
+        printf("    %s perf : cycles/sym %.2f , ipc %.2f , branch_misses/sym %.4f , l1d_misses/sym %.4f\n",dir,
+            p[RECIP_ARITH_PERF_CYCLES],
+            ( p[RECIP_ARITH_PERF_CYCLES] > 0.0 ) ? p[RECIP_ARITH_PERF_INSTRUCTIONS] / p[RECIP_ARITH_PERF_CYCLES] : 0.0,
+            p[RECIP_ARITH_PERF_BRANCH_MISSES],p[RECIP_ARITH_PERF_L1D_MISSES]);
+    }
+
+    #ifdef RECIP_ARITH_INSTRUMENT
+    const recip_arith_counters * c = &t->counters;
+    bool is_enc = ( dir[0] == 'e' );
+    uint64_t renorms = is_enc ? c->encoder_renorms : c->decoder_renorms;
+    uint64_t bytes = is_enc ? c->encoder_bytes : c->decoder_bytes;
+    const uint64_t * histo = is_enc ? c->encoder_renorm_histo : c->decoder_renorm_histo;
+    if ( renorms == 0 ) return;
+
+    printf("    %s renorm : bytes/sym %.3f , by bytes",dir,bytes/(double)count);
+    for(int b=0;b<=RECIP_ARITH_COUNTERS_MAX_RENORM_BYTES;b++)
+        if ( histo[b] ) printf(" %d:%.1f%%",b,100.0*histo[b]/renorms);
+    if ( is_enc )
+        printf(" , carries/ksym %.3f , walk avg %.2f max %llu",1000.0*c->carries/count,
+            c->carries ? c->carry_walk_bytes/(double)c->carries : 0.0,(unsigned long long)c->carry_walk_max);
+    printf("\n");
+    #else
+    (void)count;
+    #endif
+}
+
+static void bench_write_extra_csv_header(const char * dir)
+{
+    if ( g_have_perf )
+    {
+        for(int i=0;i<RECIP_ARITH_PERF_COUNT;i++)
+            printf(",%s_%s_per_symbol",dir,recip_arith_perf_name(i));
+    }
+    #ifdef RECIP_ARITH_INSTRUMENT
+    printf(",%s_renorm_bytes_per_symbol",dir);
+    for(int b=0;b<=RECIP_ARITH_COUNTERS_MAX_RENORM_BYTES;b++)
+        printf(",%s_renorms_%d_bytes",dir,b);
+    if ( dir[0] == 'e' ) printf(",carries,carry_walk_bytes,carry_walk_max");
+    #endif
+}
+
+static void bench_write_extra_csv(const char * dir,const bench_timing * t,size_t count)
+{
+    if ( g_have_perf )
+    {
+        for(int i=0;i<RECIP_ARITH_PERF_COUNT;i++)
+            printf(",%.4f",t->perf_per_symbol[i]);
+    }
+    #ifdef RECIP_ARITH_INSTRUMENT
+    const recip_arith_counters * c = &t->counters;
+    bool is_enc = ( dir[0] == 'e' );
+    const uint64_t * histo = is_enc ? c->encoder_renorm_histo : c->decoder_renorm_histo;
+    printf(",%.4f",( is_enc ? c->encoder_bytes : c->decoder_bytes )/(double)count);
+    for(int b=0;b<=RECIP_ARITH_COUNTERS_MAX_RENORM_BYTES;b++)
+        printf(",%llu",(unsigned long long)histo[b]);
+    if ( is_enc ) printf(",%llu,%llu,%llu",(unsigned long long)c->carries,(unsigned long long)c->carry_walk_bytes,(unsigned long long)c->carry_walk_max);
+    #else
+    (void)dir; (void)t; (void)count;
+    #endif
+}
+
+// JSON fields go inside the direction's object , each with a leading comma
+static void bench_write_extra_json(const char * dir,const bench_timing * t,size_t count)
+{
+    if ( g_have_perf )
+    {
+        printf(",\"perf_per_symbol\":{");
+        for(int i=0;i<RECIP_ARITH_PERF_COUNT;i++)
+            printf("%s\"%s\":%.4f",i ? "," : "",recip_arith_perf_name(i),t->perf_per_symbol[i]);
+        printf("}");
+    }
+    #ifdef RECIP_ARITH_INSTRUMENT
+    const recip_arith_counters * c = &t->counters;
+    bool is_enc = ( dir[0] == 'e' );
+    const uint64_t * histo = is_enc ? c->encoder_renorm_histo : c->decoder_renorm_histo;
+    printf(",\"renorm_bytes_per_symbol\":%.4f,\"renorms_by_bytes\":[",( is_enc ? c->encoder_bytes : c->decoder_bytes )/(double)count);
+    for(int b=0;b<=RECIP_ARITH_COUNTERS_MAX_RENORM_BYTES;b++)
+        printf("%s%llu",b ? "," : "",(unsigned long long)histo[b]);
+    printf("]");
+    if ( is_enc ) printf(",\"carries\":%llu,\"carry_walk_bytes\":%llu,\"carry_walk_max\":%llu",
+        (unsigned long long)c->carries,(unsigned long long)c->carry_walk_bytes,(unsigned long long)c->carry_walk_max);
+    #else
+    (void)dir; (void)t; (void)count;
+    #endif
+}
+
+static void bench_write_row(const bench_case * bc,const char * map_name,int table_bits,size_t comp_len,
+                            const bench_timing * enc,const bench_timing * dec)
+{
+    double bpb = comp_len * 8.0 / bc->count;
+
+    // a map without a decoder reports zeros :
+    bench_timing none = { };
+    if ( dec == NULL ) dec = &none;
+
+    switch(g_options.format)
+    {
+    case BENCH_FORMAT_TEXT:
+        if ( g_rows_written == 0 )
+        {
+            printf("%-24s %5s %-14s %3s %3s %7s %7s | %8s %7s %5s | %8s %7s %5s\n",
+                "data","alph","map","tb","cdf","bpb","loss",
+                "enc MB/s","cyc/sym","rsd%","dec MB/s","cyc/sym","rsd%");
+        }
+        printf("%-24s %5d %-14s %3d %3d %7.4f %7.4f | %8.1f %7.2f %5.1f | %8.1f %7.2f %5.1f\n",
+            bc->data_name,bc->alphabet,map_name,table_bits,(int)bc->cdf_bits,bpb,bpb - bc->entropy_bpb,
+            enc->mbps_median,enc->cycles_per_symbol,enc->rsd_percent,
+            dec->mbps_median,dec->cycles_per_symbol,dec->rsd_percent);
+        bench_write_extra_text("enc",enc,bc->count);
+        bench_write_extra_text("dec",dec,bc->count);
+        break;
+
+    case BENCH_FORMAT_CSV:
+        if ( g_rows_written == 0 )
+        {
+            printf("data,alphabet,symbols,map,table_bits,cdf_bits,comp_bytes,bpb,entropy_bpb,"
+                "enc_mbps_median,enc_mbps_best,enc_cycles_per_symbol,enc_rsd_percent,"
+                "dec_mbps_median,dec_mbps_best,dec_cycles_per_symbol,dec_rsd_percent");
+            bench_write_extra_csv_header("enc");
+            bench_write_extra_csv_header("dec");
+            printf("\n");
+        }
+        printf("%s,%d,%llu,%s,%d,%d,%llu,%.5f,%.5f,%.2f,%.2f,%.3f,%.2f,%.2f,%.2f,%.3f,%.2f",
+            bc->data_name,bc->alphabet,(unsigned long long)bc->count,map_name,table_bits,(int)bc->cdf_bits,
+            (unsigned long long)comp_len,bpb,bc->entropy_bpb,
+            enc->mbps_median,enc->mbps_best,enc->cycles_per_symbol,enc->rsd_percent,
+            dec->mbps_median,dec->mbps_best,dec->cycles_per_symbol,dec->rsd_percent);
+        bench_write_extra_csv("enc",enc,bc->count);
+        bench_write_extra_csv("dec",dec,bc->count);
+        printf("\n");
+        break;
+
+    case BENCH_FORMAT_JSON:
+        printf("%s\n  {\"data\":\"%s\",\"alphabet\":%d,\"symbols\":%llu,\"map\":\"%s\",\"table_bits\":%d,\"cdf_bits\":%d,"
+            "\"comp_bytes\":%llu,\"bpb\":%.5f,\"entropy_bpb\":%.5f,"
+            "\"enc\":{\"mbps_median\":%.2f,\"mbps_best\":%.2f,\"cycles_per_symbol\":%.3f,\"rsd_percent\":%.2f",
+            ( g_rows_written == 0 ) ? "[" : ",",
+            bc->data_name,bc->alphabet,(unsigned long long)bc->count,map_name,table_bits,(int)bc->cdf_bits,
+            (unsigned long long)comp_len,bpb,bc->entropy_bpb,
+            enc->mbps_median,enc->mbps_best,enc->cycles_per_symbol,enc->rsd_percent);
+        bench_write_extra_json("enc",enc,bc->count);
+        printf("},\"dec\":{\"mbps_median\":%.2f,\"mbps_best\":%.2f,\"cycles_per_symbol\":%.3f,\"rsd_percent\":%.2f",
+            dec->mbps_median,dec->mbps_best,dec->cycles_per_symbol,dec->rsd_percent);
+        bench_write_extra_json("dec",dec,bc->count);
+        printf("}}");
+        break;
+    }
+
+    g_rows_written++;
+    fflush(stdout);
+}
+
+// check one round trip , then time the runs ; returns false on a decode mismatch
+template <typename t_map>
+static bool bench_map(const bench_case * bc,const char * map_name,int table_bits)
+{
+    const int runs = g_options.runs;
+    double enc_seconds[64] , enc_ticks[64];
+    double dec_seconds[64] , dec_ticks[64];
+    uint64_t enc_perf[RECIP_ARITH_PERF_COUNT] = { } , dec_perf[RECIP_ARITH_PERF_COUNT] = { };
+    uint64_t perf_values[RECIP_ARITH_PERF_COUNT];
+
+    #ifdef RECIP_ARITH_INSTRUMENT
+    recip_arith_counters enc_counters , dec_counters = { };
+    recip_arith_counters_reset();
+    #endif
+
+    size_t comp_len = bench_encode<t_map>(bc->comp,bc->syms,bc->count,bc->cdf,bc->cdf_bits);
+
+    #ifdef RECIP_ARITH_INSTRUMENT
+    enc_counters = recip_arith_counters_get();
+    recip_arith_counters_reset();
+    #endif
+
+    memset(bc->dec,0,bc->count);
+    bench_decode<t_map>(bc->dec,bc->count,bc->comp,bc->cdf,bc->decode_table,bc->cdf_bits);
+    if ( memcmp(bc->syms,bc->dec,bc->count) != 0 )
+    {
+        fprintf(stderr,"bench_recip_arith: %s decode mismatch on %s cdf_bits=%d\n",map_name,bc->data_name,(int)bc->cdf_bits);
+        return false;
+    }
+
+    #ifdef RECIP_ARITH_INSTRUMENT
+    dec_counters = recip_arith_counters_get();
+    #endif
+
+    // perf counting brackets the timed region , the ioctls stay out of the timings :
+    for(int r=0;r<runs;r++)
+    {
+        if ( g_have_perf ) recip_arith_perf_start(&g_perf);
+        double t0 = bench_seconds();
+        uint64_t c0 = bench_tsc();
+        bench_encode<t_map>(bc->comp,bc->syms,bc->count,bc->cdf,bc->cdf_bits);
+        enc_ticks[r] = (double)(bench_tsc() - c0);
+        enc_seconds[r] = bench_seconds() - t0;
+        if ( g_have_perf )
+        {
+            recip_arith_perf_stop(&g_perf,perf_values);
+            for(int i=0;i<RECIP_ARITH_PERF_COUNT;i++) enc_perf[i] += perf_values[i];
+        }
+    }
+    bench_timing enc = bench_summarize(enc_seconds,enc_ticks,runs,bc->count);
+    for(int i=0;i<RECIP_ARITH_PERF_COUNT;i++) enc.perf_per_symbol[i] = enc_perf[i] / ((double)runs * bc->count);
+    #ifdef RECIP_ARITH_INSTRUMENT
+    enc.counters = enc_counters;
+    #endif
+
+    for(int r=0;r<runs;r++)
+    {
+        if ( g_have_perf ) recip_arith_perf_start(&g_perf);
+        double t0 = bench_seconds();
+        uint64_t c0 = bench_tsc();
+        bench_decode<t_map>(bc->dec,bc->count,bc->comp,bc->cdf,bc->decode_table,bc->cdf_bits);
+        dec_ticks[r] = (double)(bench_tsc() - c0);
+        dec_seconds[r] = bench_seconds() - t0;
+        if ( g_have_perf )
+        {
+            recip_arith_perf_stop(&g_perf,perf_values);
+            for(int i=0;i<RECIP_ARITH_PERF_COUNT;i++) dec_perf[i] += perf_values[i];
+        }
+    }
+    bench_timing dec = bench_summarize(dec_seconds,dec_ticks,runs,bc->count);
+    for(int i=0;i<RECIP_ARITH_PERF_COUNT;i++) dec.perf_per_symbol[i] = dec_perf[i] / ((double)runs * bc->count);
+    #ifdef RECIP_ARITH_INSTRUMENT
+    dec.counters = dec_counters;
+    #endif
+
+    bench_write_row(bc,map_name,table_bits,comp_len,&enc,&dec);
+    return true;
+}
+
+//=================================================================
+//
+// recip_arith_coder_t over table bits ; every <table_bits,cdf_bits> has to be instantiated
+//  numerator bits is the least that keeps the reciprocal exact (and at least 32)
+
+#define BENCH_NUMERATOR_BITS(tb,cb)     ( ((cb) + 2*(tb)) > 32 ? ((cb) + 2*(tb)) : 32 )
+
+typedef bool (*bench_template_func)(const bench_case * bc,const char * map_name,int table_bits);
+
+struct bench_template_entry
+{
+    int table_bits;
+    int cdf_bits;
+    bench_template_func func;
+};
+
+#define BENCH_TEMPLATE(tb,cb)   { tb , cb , bench_map< bench_map_template< recip_arith_coder_t<tb,BENCH_NUMERATOR_BITS(tb,cb),cb> > > }
+
+// the 32-bit coder needs cdf_bits + table_bits - 1 <= 24 :
+static const bench_template_entry c_bench_templates[] =
+{
+    BENCH_TEMPLATE(4,10) , BENCH_TEMPLATE(4,12) , BENCH_TEMPLATE(4,14) , BENCH_TEMPLATE(4,16) ,
+    BENCH_TEMPLATE(6,10) , BENCH_TEMPLATE(6,12) , BENCH_TEMPLATE(6,14) , BENCH_TEMPLATE(6,16) ,
+    BENCH_TEMPLATE(8,10) , BENCH_TEMPLATE(8,12) , BENCH_TEMPLATE(8,14) , BENCH_TEMPLATE(8,16) ,
+    BENCH_TEMPLATE(10,10) , BENCH_TEMPLATE(10,12) , BENCH_TEMPLATE(10,14) ,
+    BENCH_TEMPLATE(12,10) , BENCH_TEMPLATE(12,12) ,
+};
+
+static const int c_bench_cdf_bits[] = { 10 , 12 , 14 , 16 };
+
+//=================================================================
+
+static bool bench_data_set(const char * data_name,const uint8_t * syms,size_t count)
+{
+    uint32_t counts[256] = { };
+    for(size_t i=0;i<count;i++) counts[ syms[i] ] += 1;
+
+    bench_case bc;
+    bc.data_name = data_name;
+    bc.syms = syms;
+    bc.count = count;
+
+    bc.alphabet = 0;
+    bc.entropy_bpb = 0.0;
+    for(int s=0;s<256;s++)
+    {
+        if ( counts[s] == 0 ) continue;
+        bc.alphabet++;
+        double p = counts[s] / (double)count;
+        bc.entropy_bpb -= p * log2(p);
+    }
+
+    // every map expands by well under 2X ; decoders read a few bytes past the end :
+    bc.comp = (uint8_t *) malloc(2*count + 64);
+    bc.dec = (uint8_t *) malloc(count);
+    bc.decode_table = (uint8_t *) malloc(((size_t)1<<16) + 1);
+
+    bool ok = true;
+
+    for(int ci=0;ok && ci<(int)(sizeof(c_bench_cdf_bits)/sizeof(c_bench_cdf_bits[0]));ci++)
+    {
+        uint32_t cdf_bits = c_bench_cdf_bits[ci];
+        if ( g_options.only_cdf_bits != 0 && (int)cdf_bits != g_options.only_cdf_bits ) continue;
+
+        uint32_t freqs[256];
+        if ( ! recip_arith_normalize_counts(freqs,counts,256,cdf_bits) ) continue;
+
+        bc.cdf_bits = cdf_bits;
+        recip_arith_cdf_from_freqs(bc.cdf,freqs,256);
+
+        for(int s=0;s<256;s++)
+            for(uint32_t c=bc.cdf[s];c<bc.cdf[s+1];c++)
+                bc.decode_table[c] = (uint8_t) s;
+        // target == cdf_tot is okay :
+        bc.decode_table[(size_t)1<<cdf_bits] = bc.decode_table[((size_t)1<<cdf_bits)-1];
+
+        ok = ok && bench_map< recip_arith_policy_coder_t<recip_arith_map_sm98,recip_arith_state32> >(&bc,"sm98",0);
+        ok = ok && bench_map< recip_arith_policy_coder_t<recip_arith_map_sm98,recip_arith_state64> >(&bc,"sm98_64",0);
+        ok = ok && bench_map< recip_arith_policy_coder_t<recip_arith_map_cacm87,recip_arith_state32> >(&bc,"cacm87",0);
+        ok = ok && bench_map< recip_arith_policy_coder_t<recip_arith_map_cacm87,recip_arith_state64> >(&bc,"cacm87_64",0);
+        ok = ok && bench_map< recip_arith_policy_coder_t<recip_arith_map_rangecoder,recip_arith_state32> >(&bc,"rangecoder",0);
+        ok = ok && bench_map< recip_arith_policy_coder_t<recip_arith_map_rangecoder,recip_arith_state64> >(&bc,"rangecoder64",0);
+        ok = ok && bench_map< recip_arith_policy_coder_t<recip_arith_map_recip,recip_arith_state32> >(&bc,"recip_arith",RECIP_ARITH_TABLE_BITS);
+        ok = ok && bench_map< recip_arith_policy_coder_t<recip_arith_map_recip,recip_arith_state64> >(&bc,"recip_arith64",RECIP_ARITH_TABLE_BITS);
+        ok = ok && bench_map<bench_map_recip_arith_lj>(&bc,"recip_arith_lj",RECIP_ARITH_TABLE_BITS);
+
+        for(int ti=0;ok && ti<(int)(sizeof(c_bench_templates)/sizeof(c_bench_templates[0]));ti++)
+        {
+            const bench_template_entry * te = &c_bench_templates[ti];
+            if ( te->cdf_bits != (int)cdf_bits ) continue;
+            ok = te->func(&bc,"recip_arith_t",te->table_bits);
+        }
+    }
+
+    free(bc.comp);
+    free(bc.dec);
+    free(bc.decode_table);
+
+    return ok;
+}
+
+//=================================================================
+//
+// synthetic data
+
+enum { BENCH_DIST_UNIFORM , BENCH_DIST_GEOMETRIC , BENCH_DIST_SKEWED , BENCH_DIST_COUNT };
+
+static const char * c_bench_dist_names[BENCH_DIST_COUNT] = { "uniform" , "geometric" , "skewed" };
+
+static uint64_t bench_rand_next(uint64_t * state)
+{
+    // splitmix64 :
+    uint64_t z = ( *state += 0x9E3779B97F4A7C15ULL );
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void bench_make_synthetic(uint8_t * syms,size_t count,int dist,int alphabet,uint64_t seed)
+{
+    double cum[257];
+    cum[0] = 0.0;
+    for(int s=0;s<alphabet;s++)
+    {
+        double p;
+        switch(dist)
+        {
+        case BENCH_DIST_GEOMETRIC:  p = pow(0.75,s); break;
+        case BENCH_DIST_SKEWED:     p = ( s == 0 ) ? 0.9 : 0.1/(alphabet-1); break;
+        default:                    p = 1.0; break;
+        }
+        cum[s+1] = cum[s] + p;
+    }
+
+    uint64_t state = seed;
+    for(size_t i=0;i<count;i++)
+    {
+        // uniform double in [0,cum[alphabet]) , then binary search :
+        double u = (bench_rand_next(&state) >> 11) * (1.0/9007199254740992.0) * cum[alphabet];
+        int lo = 0 , hi = alphabet - 1;
+        while ( lo < hi )
+        {
+            int mid = (lo + hi)/2;
+            if ( u < cum[mid+1] ) hi = mid;
+            else lo = mid + 1;
+        }
+        syms[i] = (uint8_t) lo;
+    }
+}
+
+//=================================================================
+
+// reads in chunks rather than ftell , so files over 2GB load where size_t allows
+static uint8_t * bench_read_file(const char * name,size_t * p_len)
+{
+    FILE * fp = fopen(name,"rb");
+    if ( ! fp ) return NULL;
+
+    size_t capacity = 1<<20 , len = 0;
+    uint8_t * data = (uint8_t *) malloc(capacity);
+    while ( data )
+    {
+        if ( len == capacity )
+        {
+            capacity *= 2;
+            uint8_t * grown = (uint8_t *) realloc(data,capacity);
+            if ( ! grown ) { free(data); data = NULL; break; }
+            data = grown;
+        }
+        size_t got = fread(data+len,1,capacity-len,fp);
+        if ( got == 0 ) break;
+        len += got;
+    }
+    fclose(fp);
+
+    if ( data && len == 0 ) { free(data); data = NULL; }
+    *p_len = len;
+    return data;
+}
+
+int main(int argc,char * argv[])
+{
+    int num_files = 0;
+    const char * files[256];
+
+    for(int i=1;i<argc;i++)
+    {
+        const char * arg = argv[i];
+        if ( strcmp(arg,"-n") == 0 && i+1 < argc ) g_options.synth_count = (size_t) strtoull(argv[++i],NULL,10);
+        else if ( strcmp(arg,"-runs") == 0 && i+1 < argc ) g_options.runs = atoi(argv[++i]);
+        else if ( strcmp(arg,"-cdf") == 0 && i+1 < argc ) g_options.only_cdf_bits = atoi(argv[++i]);
+        else if ( strcmp(arg,"-nosynth") == 0 ) g_options.synth = false;
+        else if ( strcmp(arg,"-csv") == 0 ) g_options.format = BENCH_FORMAT_CSV;
+        else if ( strcmp(arg,"-json") == 0 ) g_options.format = BENCH_FORMAT_JSON;
+        else if ( strcmp(arg,"-perf") == 0 ) g_options.perf = true;
+        else if ( arg[0] == '-' || num_files == 256 )
+        {
+            fprintf(stderr,"bench_recip_arith [-n count] [-runs count] [-cdf bits] [-nosynth] [-csv|-json] [-perf] [files]\n");
+            return 1;
+        }
+        else files[num_files++] = arg;
+    }
+
+    if ( g_options.runs < 1 ) g_options.runs = 1;
+    if ( g_options.runs > 64 ) g_options.runs = 64;
+    if ( g_options.synth_count < 1 ) g_options.synth_count = 1;
+
+    recip_arith_table_init();
+
+    if ( g_options.perf )
+    {
+        g_have_perf = recip_arith_perf_open(&g_perf);
+        if ( ! g_have_perf )
+            fprintf(stderr,"bench_recip_arith: perf_event_open unavailable , -perf ignored\n");
+    }
+
+    if ( g_options.format == BENCH_FORMAT_TEXT )
+    {
+        printf("bench_recip_arith : %d runs , cycles are %s\n",g_options.runs,
+            BENCH_HAS_TSC ? "time stamp counter ticks" : "not measured");
+    }
+
+    bool ok = true;
+
+    if ( g_options.synth )
+    {
+        size_t count = g_options.synth_count;
+        uint8_t * syms = (uint8_t *) malloc(count);
+        static const int c_alphabets[] = { 2 , 16 , 64 , 256 };
+
+        for(int d=0;ok && d<BENCH_DIST_COUNT;d++)
+        {
+            for(int a=0;ok && a<(int)(sizeof(c_alphabets)/sizeof(c_alphabets[0]));a++)
+            {
+                char name[64];
+                sprintf(name,"%s%d",c_bench_dist_names[d],c_alphabets[a]);
+                bench_make_synthetic(syms,count,d,c_alphabets[a],1 + d*16 + a);
+                ok = bench_data_set(name,syms,count);
+            }
+        }
+
+        free(syms);
+    }
+
+    for(int f=0;ok && f<num_files;f++)
+    {
+        size_t len = 0;
+        uint8_t * data = bench_read_file(files[f],&len);
+        if ( data == NULL )
+        {
+            fprintf(stderr,"bench_recip_arith: can't read %s\n",files[f]);
+            ok = false;
+            break;
+        }
+        ok = bench_data_set(files[f],data,len);
+        free(data);
+    }
+
+    if ( g_options.format == BENCH_FORMAT_JSON )
+        printf("%s]\n",( g_rows_written == 0 ) ? "[" : "\n");
+
+    if ( g_have_perf )
+        recip_arith_perf_close(&g_perf);
+
+    return ok ? 0 : 2;
+}
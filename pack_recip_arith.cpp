@@ -0,0 +1,500 @@
+/**
+pack_recip_arith.cpp
+command line order-0 file compressor , memory-mapped windows in and out
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#define _CRT_SECURE_NO_WARNINGS
+
+/**
+
+pack_recip_arith c [-cdf bits] [-window kb] <in> <out>
+pack_recip_arith d [-window kb] <in> <out>
+
+c compresses in to out , d decompresses.
+Input and output are memory-mapped one window at a time (default 1 MB , rounded to the mapping granularity) ,
+so files of any size (64-bit) run with a few windows resident , not the whole file.
+Reports the sizes , bits per byte , wall time including I/O , and peak RSS where available.
+
+compress makes two passes over the input : the order-0 histogram , then the coding.
+The coder is recip_arith_stream_encoder , flushing into the output windows ;
+the output file grows a window at a time and is cut to size at the end.
+decompress knows raw_len from the header , so it sizes the output once and
+refills recip_arith_stream_decoder from the input windows.
+
+file layout , integers big endian :
+
+    u32 magic       PACK_RECIP_ARITH_MAGIC
+    u32 cdf_bits
+    u64 raw_len
+    32 byte bitmap of the symbols present , u16 (freq-1) for each present symbol   (if raw_len > 0)
+    recip_arith stream , to the end of the file
+
+decompress checks the header , masks out of range targets (recip_arith_decoder_peek_masked) so the
+symbol lookup stays in bounds , and stops with an error when a target was out of range or the decoder
+reads more than RECIP_ARITH_DECODER_MAX_OVERREAD bytes past the end of the file (it was truncated).
+Other corruption isn't detected : it decodes to the wrong bytes , of the right length.
+Use recip_arith_block or recip_arith_order1 for fully checked decoding.
+
+**/
+
+#include "recip_arith.h"
+#include "recip_arith_stream.h"
+#include "recip_arith_checked.h"
+#include "recip_arith_static_model.h"
+#include "recip_arith_symbol_lookup.h"
+#include "recip_arith_mmap.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#define PACK_RECIP_ARITH_MAGIC              (0x52414D31)    // "RAM1"
+#define PACK_RECIP_ARITH_FIXED_HEADER_SIZE  (16)
+#define PACK_RECIP_ARITH_MAX_HEADER_SIZE    (PACK_RECIP_ARITH_FIXED_HEADER_SIZE + 32 + 2*256)
+#define PACK_RECIP_ARITH_DEFAULT_WINDOW     (1<<20)
+
+// cdf_bits must hold 256 symbols at freq >= 1 , and (freq-1) must fit in a u16 :
+#define PACK_RECIP_ARITH_MIN_CDF_BITS       (8)
+#define PACK_RECIP_ARITH_MAX_CDF_BITS       (16)
+
+//=========================================================================================
+
+static double pack_seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void pack_print_peak_rss()
+{
+    #ifndef _WIN32
+    struct rusage ru;
+    if ( getrusage(RUSAGE_SELF,&ru) == 0 )
+    {
+        #ifdef __APPLE__
+        printf("peak RSS : %.1f MB\n",ru.ru_maxrss / (1024.0*1024.0));
+        #else
+        printf("peak RSS : %.1f MB\n",ru.ru_maxrss / 1024.0);
+        #endif
+    }
+    #endif
+}
+
+//=========================================================================================
+// compress
+
+// the output side of the stream encoder : each flush maps the next window , growing the file
+struct pack_output
+{
+    recip_arith_mmap_file * file;
+    recip_arith_mmap_window window;
+    uint64_t window_offset;
+    size_t window_size;
+    uint64_t comp_len;          // bytes of the file that are final
+    uint8_t * scratch;          // written instead once a window can't be mapped
+    bool failed;
+};
+
+static uint8_t * pack_output_map(pack_output * out,uint64_t offset)
+{
+    recip_arith_mmap_unmap(&out->window);
+    out->window_offset = offset;
+    if ( ! recip_arith_mmap_resize(out->file,offset + out->window_size) ) return NULL;
+    return recip_arith_mmap_map(out->file,&out->window,offset,out->window_size);
+}
+
+static uint8_t * pack_output_flush(void * user,uint8_t * buf,size_t len,size_t * p_capacity)
+{
+    pack_output * out = (pack_output *)user;
+    out->comp_len = out->window_offset + (uint64_t)(buf - out->window.base) + len;
+
+    if ( ! out->failed )
+    {
+        uint8_t * next = pack_output_map(out,out->window_offset + out->window_size);
+        if ( next != NULL )
+        {
+            *p_capacity = out->window_size;
+            return next;
+        }
+        out->failed = true;
+    }
+
+    // the encoder keeps writing into the old buffer after a NULL , which is unmapped now ,
+    //  so hand it scratch to run out on ; compress reports the error at the end
+    if ( out->scratch == NULL ) out->scratch = (uint8_t *) malloc(out->window_size);
+    *p_capacity = out->window_size;
+    return out->scratch;
+}
+
+static bool pack_compress(const char * in_name,const char * out_name,uint32_t cdf_bits,size_t window_size)
+{
+    double t0 = pack_seconds();
+
+    recip_arith_mmap_file in;
+    if ( ! recip_arith_mmap_open_read(&in,in_name) )
+    {
+        fprintf(stderr,"pack_recip_arith: can't open %s\n",in_name);
+        return false;
+    }
+    const uint64_t raw_len = in.size;
+
+    recip_arith_mmap_window in_window = { };
+
+    // pass 1 : histogram
+    uint64_t counts64[256] = { };
+    for(uint64_t off=0;off<raw_len;off+=window_size)
+    {
+        size_t len = (size_t)( (raw_len - off) < window_size ? (raw_len - off) : window_size );
+        const uint8_t * raw = recip_arith_mmap_map(&in,&in_window,off,len);
+        if ( raw == NULL )
+        {
+            fprintf(stderr,"pack_recip_arith: can't map %s\n",in_name);
+            recip_arith_mmap_close(&in);
+            return false;
+        }
+        for(size_t i=0;i<len;i++) counts64[ raw[i] ] += 1;
+    }
+    recip_arith_mmap_unmap(&in_window);
+
+    // counts to 32 bits for normalization ; keep used symbols nonzero :
+    uint64_t max_count = 0;
+    for(int s=0;s<256;s++) if ( counts64[s] > max_count ) max_count = counts64[s];
+    int count_shift = 0;
+    while ( (max_count >> count_shift) > 0xFFFFFFFFull ) count_shift++;
+
+    uint32_t counts[256];
+    for(int s=0;s<256;s++)
+    {
+        uint64_t c = counts64[s] >> count_shift;
+        if ( c == 0 && counts64[s] != 0 ) c = 1;
+        counts[s] = (uint32_t)c;
+    }
+
+    uint32_t freqs[256];
+    uint32_t cdf[257];
+    if ( raw_len > 0 )
+    {
+        if ( ! recip_arith_normalize_counts(freqs,counts,256,cdf_bits) )
+        {
+            fprintf(stderr,"pack_recip_arith: can't normalize the histogram\n");
+            recip_arith_mmap_close(&in);
+            return false;
+        }
+        recip_arith_cdf_from_freqs(cdf,freqs,256);
+    }
+
+    recip_arith_mmap_file out_file;
+    if ( ! recip_arith_mmap_create(&out_file,out_name) )
+    {
+        fprintf(stderr,"pack_recip_arith: can't create %s\n",out_name);
+        recip_arith_mmap_close(&in);
+        return false;
+    }
+
+    pack_output out = { };
+    out.file = &out_file;
+    out.window_size = window_size;
+
+    bool ok = true;
+    uint8_t * header = pack_output_map(&out,0);
+    if ( header == NULL ) ok = false;
+
+    if ( ok )
+    {
+        uint8_t * ptr = header;
+        recip_arith_put_be32(ptr,PACK_RECIP_ARITH_MAGIC);
+        recip_arith_put_be32(ptr+4,cdf_bits);
+        recip_arith_put_be64(ptr+8,raw_len);
+        ptr += PACK_RECIP_ARITH_FIXED_HEADER_SIZE;
+        out.comp_len = PACK_RECIP_ARITH_FIXED_HEADER_SIZE;
+
+        if ( raw_len > 0 )
+        {
+            uint8_t * bitmap = ptr;
+            memset(bitmap,0,32);
+            ptr += 32;
+            for(int s=0;s<256;s++)
+            {
+                if ( freqs[s] == 0 ) continue;
+                bitmap[s>>3] |= (uint8_t)(1<<(s&7));
+                *ptr++ = (uint8_t)((freqs[s]-1)>>8);
+                *ptr++ = (uint8_t)(freqs[s]-1);
+            }
+
+            // pass 2 : code ; the stream starts right after the header in the first window
+            recip_arith_stream_encoder enc;
+            recip_arith_stream_encoder_start(&enc,ptr,window_size - (size_t)(ptr - header),pack_output_flush,&out);
+
+            for(uint64_t off=0;off<raw_len && ok;off+=window_size)
+            {
+                size_t len = (size_t)( (raw_len - off) < window_size ? (raw_len - off) : window_size );
+                const uint8_t * raw = recip_arith_mmap_map(&in,&in_window,off,len);
+                if ( raw == NULL ) { ok = false; break; }
+
+                for(size_t i=0;i<len;i++)
+                {
+                    int sym = raw[i];
+                    recip_arith_stream_encoder_put(&enc,cdf[sym],freqs[sym],cdf_bits);
+                    recip_arith_stream_encoder_renorm(&enc);
+                }
+            }
+            recip_arith_mmap_unmap(&in_window);
+
+            if ( ! recip_arith_stream_encoder_finish(&enc) ) ok = false;
+        }
+    }
+    if ( out.failed ) ok = false;
+    free(out.scratch);
+
+    recip_arith_mmap_unmap(&out.window);
+    if ( ok ) ok = recip_arith_mmap_resize(&out_file,out.comp_len);
+    recip_arith_mmap_close(&out_file);
+    recip_arith_mmap_close(&in);
+
+    if ( ! ok )
+    {
+        fprintf(stderr,"pack_recip_arith: error writing %s\n",out_name);
+        return false;
+    }
+
+    double seconds = pack_seconds() - t0;
+    printf("%s : %llu -> %llu = %.3f bpb\n",in_name,(unsigned long long)raw_len,(unsigned long long)out.comp_len,
+        raw_len ? (out.comp_len * 8.0) / raw_len : 0.0);
+    printf("compress : %.3f seconds , %.1f MB/s\n",seconds,raw_len / (seconds * 1024 * 1024));
+    return true;
+}
+
+//=========================================================================================
+// decompress
+
+// the input side of the stream decoder : each refill maps the next window
+struct pack_input
+{
+    recip_arith_mmap_file * file;
+    recip_arith_mmap_window window;
+    uint64_t next_offset;
+    size_t window_size;
+    size_t first_skip;          // header bytes at the start of the first window
+};
+
+static const uint8_t * pack_input_refill(void * user,size_t * p_len)
+{
+    pack_input * in = (pack_input *)user;
+    *p_len = 0;
+    if ( in->next_offset >= in->file->size ) return NULL;
+
+    uint64_t remain = in->file->size - in->next_offset;
+    size_t len = (size_t)( remain < in->window_size ? remain : in->window_size );
+    const uint8_t * p = recip_arith_mmap_map(in->file,&in->window,in->next_offset,len);
+    if ( p == NULL ) return NULL;
+    in->next_offset += len;
+
+    p += in->first_skip;
+    len -= in->first_skip;
+    in->first_skip = 0;
+
+    *p_len = len;
+    return p;
+}
+
+static bool pack_decompress(const char * in_name,const char * out_name,size_t window_size)
+{
+    double t0 = pack_seconds();
+
+    recip_arith_mmap_file in_file;
+    if ( ! recip_arith_mmap_open_read(&in_file,in_name) )
+    {
+        fprintf(stderr,"pack_recip_arith: can't open %s\n",in_name);
+        return false;
+    }
+
+    pack_input in = { };
+    in.file = &in_file;
+    in.window_size = window_size;
+
+    // parse the header from the first window :
+    size_t first_len = (size_t)( in_file.size < window_size ? in_file.size : window_size );
+    const uint8_t * header = ( first_len >= PACK_RECIP_ARITH_FIXED_HEADER_SIZE ) ?
+        recip_arith_mmap_map(&in_file,&in.window,0,first_len) : NULL;
+    if ( header == NULL || recip_arith_get_be32(header) != PACK_RECIP_ARITH_MAGIC )
+    {
+        fprintf(stderr,"pack_recip_arith: %s is not a pack_recip_arith file\n",in_name);
+        recip_arith_mmap_unmap(&in.window);
+        recip_arith_mmap_close(&in_file);
+        return false;
+    }
+
+    uint32_t cdf_bits = recip_arith_get_be32(header+4);
+    uint64_t raw_len = recip_arith_get_be64(header+8);
+    const uint8_t * ptr = header + PACK_RECIP_ARITH_FIXED_HEADER_SIZE;
+    const uint8_t * end = header + first_len;
+
+    bool ok = ( cdf_bits >= PACK_RECIP_ARITH_MIN_CDF_BITS && cdf_bits <= PACK_RECIP_ARITH_MAX_CDF_BITS );
+
+    uint32_t cdf[257];
+    if ( ok && raw_len > 0 )
+    {
+        if ( end - ptr < 32 ) ok = false;
+        const uint8_t * bitmap = ptr;
+        ptr += 32;
+        cdf[0] = 0;
+        for(int s=0;s<256 && ok;s++)
+        {
+            uint32_t freq = 0;
+            if ( bitmap[s>>3] & (1<<(s&7)) )
+            {
+                if ( end - ptr < 2 ) { ok = false; break; }
+                freq = ((ptr[0]<<8) | ptr[1]) + 1;
+                ptr += 2;
+            }
+            cdf[s+1] = cdf[s] + freq;
+        }
+        if ( ok && cdf[256] != ((uint32_t)1<<cdf_bits) ) ok = false;
+    }
+    if ( ! ok )
+    {
+        fprintf(stderr,"pack_recip_arith: bad header in %s\n",in_name);
+        recip_arith_mmap_unmap(&in.window);
+        recip_arith_mmap_close(&in_file);
+        return false;
+    }
+
+    // the first refill maps window 0 again , past the header :
+    in.first_skip = (size_t)(ptr - header);
+    recip_arith_mmap_unmap(&in.window);
+
+    recip_arith_mmap_file out_file;
+    if ( ! recip_arith_mmap_create(&out_file,out_name) || ! recip_arith_mmap_resize(&out_file,raw_len) )
+    {
+        fprintf(stderr,"pack_recip_arith: can't create %s\n",out_name);
+        recip_arith_mmap_close(&in_file);
+        return false;
+    }
+
+    bool corrupt = false;
+    if ( raw_len > 0 )
+    {
+        recip_arith_symbol_lookup lut;
+        if ( ! recip_arith_symbol_lookup_init(&lut,cdf,256,cdf_bits,RECIP_ARITH_LOOKUP_AUTO) )
+            ok = false;
+
+        if ( ok )
+        {
+            recip_arith_stream_decoder dec;
+            recip_arith_stream_decoder_start(&dec,pack_input_refill,&in);
+
+            uint32_t bad_target = 0;
+            recip_arith_mmap_window out_window = { };
+            for(uint64_t off=0;off<raw_len && ! corrupt;off+=window_size)
+            {
+                size_t len = (size_t)( (raw_len - off) < window_size ? (raw_len - off) : window_size );
+                uint8_t * raw = recip_arith_mmap_map(&out_file,&out_window,off,len);
+                if ( raw == NULL ) { ok = false; break; }
+
+                for(size_t i=0;i<len;i++)
+                {
+                    // masked so a corrupt stream can't index off the lookup or pick a zero freq symbol :
+                    uint32_t target = recip_arith_decoder_peek_masked(&dec.dec,cdf_bits,&bad_target);
+                    uint32_t sym = recip_arith_symbol_lookup_find(&lut,target);
+                    raw[i] = (uint8_t) sym;
+                    recip_arith_decoder_remove(&dec.dec,cdf[sym],cdf[sym+1] - cdf[sym]);
+                    recip_arith_stream_decoder_renorm(&dec);
+
+                    // truncated : stop rather than decode zeros to raw_len
+                    if ( dec.overread > RECIP_ARITH_DECODER_MAX_OVERREAD ) break;
+                }
+                if ( bad_target || dec.overread > RECIP_ARITH_DECODER_MAX_OVERREAD ) corrupt = true;
+            }
+            recip_arith_mmap_unmap(&out_window);
+
+            recip_arith_symbol_lookup_free(&lut);
+        }
+    }
+
+    recip_arith_mmap_unmap(&in.window);
+    recip_arith_mmap_close(&out_file);
+    recip_arith_mmap_close(&in_file);
+
+    if ( corrupt )
+    {
+        fprintf(stderr,"pack_recip_arith: %s is corrupt or truncated\n",in_name);
+        return false;
+    }
+    if ( ! ok )
+    {
+        fprintf(stderr,"pack_recip_arith: error writing %s\n",out_name);
+        return false;
+    }
+
+    double seconds = pack_seconds() - t0;
+    printf("%s : %llu -> %llu\n",in_name,(unsigned long long)in_file.size,(unsigned long long)raw_len);
+    printf("decompress : %.3f seconds , %.1f MB/s\n",seconds,raw_len / (seconds * 1024 * 1024));
+    return true;
+}
+
+//=========================================================================================
+
+static int pack_usage()
+{
+    fprintf(stderr,"pack_recip_arith c [-cdf bits] [-window kb] <in> <out>\n");
+    fprintf(stderr,"pack_recip_arith d [-window kb] <in> <out>\n");
+    return 1;
+}
+
+int main(int argc,char * argv[])
+{
+    if ( argc < 2 ) return pack_usage();
+    bool compress;
+    if ( strcmp(argv[1],"c") == 0 ) compress = true;
+    else if ( strcmp(argv[1],"d") == 0 ) compress = false;
+    else return pack_usage();
+
+    uint32_t cdf_bits = 13;
+    uint64_t window_kb = PACK_RECIP_ARITH_DEFAULT_WINDOW/1024;
+    const char * names[2];
+    int num_names = 0;
+
+    for(int i=2;i<argc;i++)
+    {
+        const char * arg = argv[i];
+        if ( strcmp(arg,"-cdf") == 0 && i+1 < argc ) cdf_bits = atoi(argv[++i]);
+        else if ( strcmp(arg,"-window") == 0 && i+1 < argc ) window_kb = strtoull(argv[++i],NULL,10);
+        else if ( arg[0] == '-' || num_names == 2 ) return pack_usage();
+        else names[num_names++] = arg;
+    }
+    if ( num_names != 2 ) return pack_usage();
+
+    if ( cdf_bits < PACK_RECIP_ARITH_MIN_CDF_BITS || cdf_bits > PACK_RECIP_ARITH_MAX_CDF_BITS )
+    {
+        fprintf(stderr,"pack_recip_arith: -cdf must be %d-%d\n",PACK_RECIP_ARITH_MIN_CDF_BITS,PACK_RECIP_ARITH_MAX_CDF_BITS);
+        return 1;
+    }
+
+    // windows are whole mapping granules , and must hold the largest header :
+    uint64_t granularity = recip_arith_mmap_granularity();
+    uint64_t window_size = ( (window_kb*1024 + granularity - 1) / granularity ) * granularity;
+    while ( window_size < PACK_RECIP_ARITH_MAX_HEADER_SIZE ) window_size += granularity;
+    if ( window_size > ((uint64_t)1<<30) )
+    {
+        fprintf(stderr,"pack_recip_arith: -window is at most 1 GB\n");
+        return 1;
+    }
+
+    recip_arith_table_init();
+
+    bool ok = compress ?
+        pack_compress(names[0],names[1],cdf_bits,(size_t)window_size) :
+        pack_decompress(names[0],names[1],(size_t)window_size);
+
+    if ( ok ) pack_print_peak_rss();
+    return ok ? 0 : 1;
+}
@@ -25,3 +25,20 @@ void recip_arith_table_init()
         recip_arith_table[i] = (uint32_t)val;
     }
 }
+
+#ifdef RECIP_ARITH_INSTRUMENT
+
+thread_local recip_arith_counters recip_arith_tls_counters = { };
+
+void recip_arith_counters_reset()
+{
+    recip_arith_counters zero = { };
+    recip_arith_tls_counters = zero;
+}
+
+recip_arith_counters recip_arith_counters_get()
+{
+    return recip_arith_tls_counters;
+}
+
+#endif // RECIP_ARITH_INSTRUMENT
@@ -0,0 +1,202 @@
+#pragma once
+/**
+recip_arith_adaptive.h
+adaptive "constant sum shift" nibble & byte models for recip_arith
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_ADAPTIVE_H
+#define RECIP_ARITH_ADAPTIVE_H
+
+#include "recip_arith.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RECIP_ARITH_ADAPTIVE_SSE2
+#include <emmintrin.h>
+#endif
+
+//=========================================================================================
+
+/**
+
+recip_arith_encoder_put needs the cdf to sum to exactly (1<<cdf_bits).
+Count-based adaptive models have to be rescaled to a power of two all the time for that.
+
+Instead these models keep the cdf total constant :
+the cdf is 16 entries (a nibble alphabet) and adapts by moving every entry a fraction of the
+way towards a target cdf that has all the probability on the coded symbol :
+
+    cdf[i] += (mix[i] - cdf[i]) >> RECIP_ARITH_NIBBLE_ADAPT_SHIFT
+
+    mix[i] = i                  for i <= sym
+    mix[i] = total - 16 + i     for i > sym
+
+cdf[0] = 0 and cdf[16] = total are fixed, so the total never changes.
+mix has freq 1 on every symbol except sym , and because the shift rounds down the same way on
+adjacent entries, every freq stays >= 1 too.
+
+The 16 cdf entries are 16 bits each , so the update is two SSE2 vector ops ,
+and the decoder finds the symbol with a vector compare against the target instead of a decode_table.
+
+bytes are coded as two nibbles : the top nibble , then the bottom nibble with the top nibble as context
+
+**/
+
+#define RECIP_ARITH_NIBBLE_CDF_BITS     (15)
+#define RECIP_ARITH_NIBBLE_CDF_TOTAL    (1<<RECIP_ARITH_NIBBLE_CDF_BITS)
+
+// adaptation rate ; lower = faster adaptation , higher = more precise stationary stats
+//  must be >= 1 for the freq >= 1 guarantee
+#ifndef RECIP_ARITH_NIBBLE_ADAPT_SHIFT
+#define RECIP_ARITH_NIBBLE_ADAPT_SHIFT  (6)
+#endif
+
+struct recip_arith_nibble_model
+{
+    // cdf[0] is always 0 , the implicit cdf[16] is RECIP_ARITH_NIBBLE_CDF_TOTAL
+    //  totals stay < 32768 so they're safe in signed 16-bit lanes
+    uint16_t cdf[16];
+};
+
+struct recip_arith_byte_model
+{
+    recip_arith_nibble_model hi;
+    recip_arith_nibble_model lo[16];
+};
+
+//=========================================================================================
+
+static inline void recip_arith_nibble_model_init(recip_arith_nibble_model * m)
+{
+    // start flat :
+    for(int i=0;i<16;i++)
+        m->cdf[i] = (uint16_t)(i * (RECIP_ARITH_NIBBLE_CDF_TOTAL/16));
+}
+
+static inline void recip_arith_byte_model_init(recip_arith_byte_model * m)
+{
+    recip_arith_nibble_model_init(&m->hi);
+    for(int i=0;i<16;i++)
+        recip_arith_nibble_model_init(&m->lo[i]);
+}
+
+static recip_arith_inline uint32_t recip_arith_nibble_model_low(const recip_arith_nibble_model * m,int sym)
+{
+    return m->cdf[sym];
+}
+
+static recip_arith_inline uint32_t recip_arith_nibble_model_high(const recip_arith_nibble_model * m,int sym)
+{
+    return ( sym == 15 ) ? RECIP_ARITH_NIBBLE_CDF_TOTAL : m->cdf[sym+1];
+}
+
+static recip_arith_inline void recip_arith_nibble_model_update(recip_arith_nibble_model * m,int sym)
+{
+    #ifdef RECIP_ARITH_ADAPTIVE_SSE2
+
+    __m128i * pcdf = (__m128i *)m->cdf;
+    __m128i cdf0 = _mm_loadu_si128(pcdf);
+    __m128i cdf1 = _mm_loadu_si128(pcdf+1);
+
+    const __m128i index0 = _mm_setr_epi16(0,1,2,3,4,5,6,7);
+    const __m128i index1 = _mm_setr_epi16(8,9,10,11,12,13,14,15);
+    const __m128i top = _mm_set1_epi16(RECIP_ARITH_NIBBLE_CDF_TOTAL - 16);
+    __m128i vsym = _mm_set1_epi16((short)sym);
+
+    // mix = i + ( i > sym ? total-16 : 0 )
+    __m128i mix0 = _mm_add_epi16(index0, _mm_and_si128( _mm_cmpgt_epi16(index0,vsym) , top ) );
+    __m128i mix1 = _mm_add_epi16(index1, _mm_and_si128( _mm_cmpgt_epi16(index1,vsym) , top ) );
+
+    cdf0 = _mm_add_epi16(cdf0, _mm_srai_epi16( _mm_sub_epi16(mix0,cdf0) , RECIP_ARITH_NIBBLE_ADAPT_SHIFT ) );
+    cdf1 = _mm_add_epi16(cdf1, _mm_srai_epi16( _mm_sub_epi16(mix1,cdf1) , RECIP_ARITH_NIBBLE_ADAPT_SHIFT ) );
+
+    _mm_storeu_si128(pcdf,cdf0);
+    _mm_storeu_si128(pcdf+1,cdf1);
+
+    #else
+
+    for(int i=1;i<16;i++)
+    {
+        int mix = ( i > sym ) ? (RECIP_ARITH_NIBBLE_CDF_TOTAL - 16 + i) : i;
+        int cdf = m->cdf[i];
+        m->cdf[i] = (uint16_t)( cdf + ((mix - cdf) >> RECIP_ARITH_NIBBLE_ADAPT_SHIFT) );
+    }
+
+    #endif
+}
+
+// find sym such that cdf[sym] <= target < cdf[sym+1]
+static recip_arith_inline int recip_arith_nibble_model_find(const recip_arith_nibble_model * m,uint32_t target)
+{
+    // a valid stream has target < total ; clamp so a bad one can't walk off the end :
+    if ( target >= RECIP_ARITH_NIBBLE_CDF_TOTAL ) target = RECIP_ARITH_NIBBLE_CDF_TOTAL-1;
+
+    #ifdef RECIP_ARITH_ADAPTIVE_SSE2
+
+    const __m128i * pcdf = (const __m128i *)m->cdf;
+    __m128i vtarget = _mm_set1_epi16((short)target);
+    __m128i gt0 = _mm_cmpgt_epi16( _mm_loadu_si128(pcdf) , vtarget );
+    __m128i gt1 = _mm_cmpgt_epi16( _mm_loadu_si128(pcdf+1) , vtarget );
+
+    // bit i set where cdf[i] > target ; cdf is monotone so that's all the bits from sym+1 up
+    //  bit 0 is never set since cdf[0] = 0
+    uint32_t gt_mask = (uint32_t)_mm_movemask_epi8( _mm_packs_epi16(gt0,gt1) );
+    uint32_t le_mask = (~gt_mask) & 0xFFFF;
+    return 31 - clz32(le_mask);
+
+    #else
+
+    int sym = 0;
+    for(int i=1;i<16;i++)
+        sym += ( m->cdf[i] <= target );
+    return sym;
+
+    #endif
+}
+
+//=========================================================================================
+
+// code a nibble , renorm , and adapt the model
+
+static recip_arith_inline void recip_arith_encoder_put_nibble(recip_arith_encoder * ac,recip_arith_nibble_model * m,int sym)
+{
+    recip_arith_assert( sym >= 0 && sym < 16 );
+    uint32_t low = recip_arith_nibble_model_low(m,sym);
+    uint32_t high = recip_arith_nibble_model_high(m,sym);
+    recip_arith_encoder_put(ac,low,high-low,RECIP_ARITH_NIBBLE_CDF_BITS);
+    recip_arith_encoder_renorm(ac);
+    recip_arith_nibble_model_update(m,sym);
+}
+
+static recip_arith_inline int recip_arith_decoder_get_nibble(recip_arith_decoder * ac,recip_arith_nibble_model * m)
+{
+    uint32_t target = recip_arith_decoder_peek(ac,RECIP_ARITH_NIBBLE_CDF_BITS);
+    int sym = recip_arith_nibble_model_find(m,target);
+    uint32_t low = recip_arith_nibble_model_low(m,sym);
+    uint32_t high = recip_arith_nibble_model_high(m,sym);
+    recip_arith_decoder_remove(ac,low,high-low);
+    recip_arith_decoder_renorm(ac);
+    recip_arith_nibble_model_update(m,sym);
+    return sym;
+}
+
+static recip_arith_inline void recip_arith_encoder_put_byte(recip_arith_encoder * ac,recip_arith_byte_model * m,int sym)
+{
+    recip_arith_encoder_put_nibble(ac,&m->hi,sym>>4);
+    recip_arith_encoder_put_nibble(ac,&m->lo[sym>>4],sym&15);
+}
+
+static recip_arith_inline int recip_arith_decoder_get_byte(recip_arith_decoder * ac,recip_arith_byte_model * m)
+{
+    int hi = recip_arith_decoder_get_nibble(ac,&m->hi);
+    int lo = recip_arith_decoder_get_nibble(ac,&m->lo[hi]);
+    return (hi<<4) | lo;
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_ADAPTIVE_H
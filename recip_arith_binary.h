@@ -0,0 +1,158 @@
+#pragma once
+/**
+recip_arith_binary.h
+adaptive binary coding on the recip_arith encoder & decoder
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_BINARY_H
+#define RECIP_ARITH_BINARY_H
+
+#include "recip_arith.h"
+
+//=========================================================================================
+
+/**
+
+binary decisions with an adaptive 12-bit probability
+
+the split point uses the same r_top-quantized map as recip_arith_encoder_put :
+
+    bound = p0 * r_norm      (r_norm = r_top << shift , as in _put with cdf_bits = 12)
+
+bit 0 gets [0,bound) and bit 1 gets [bound,range) ,
+so bit 1 also picks up the top of range that the multi-symbol map leaves unused.
+
+The decoder just compares code against bound , so no reciprocal multiply is needed at all.
+
+These work on the plain recip_arith_encoder / recip_arith_decoder , renorm after every bit ,
+and can be freely mixed with multi-symbol puts & peeks on the same stream.
+
+**/
+
+#define RECIP_ARITH_BINARY_PROB_BITS    (12)
+#define RECIP_ARITH_BINARY_PROB_ONE     (1<<RECIP_ARITH_BINARY_PROB_BITS)
+#define RECIP_ARITH_BINARY_PROB_INIT    (RECIP_ARITH_BINARY_PROB_ONE/2)
+
+// adaptation rate ; p moves 1/32 of the way towards the coded bit
+#define RECIP_ARITH_BINARY_ADAPT_SHIFT  (5)
+
+// probability that the bit is 0 , in [1,RECIP_ARITH_BINARY_PROB_ONE)
+typedef uint16_t recip_arith_prob;
+
+//=========================================================================================
+
+static recip_arith_inline uint32_t recip_arith_binary_bound(uint32_t range,uint32_t p0)
+{
+    int range_clz = clz32(range);
+
+    uint32_t r_top = range >> (32 - range_clz - RECIP_ARITH_TABLE_BITS);
+    return (p0 * r_top) << (32 - range_clz - RECIP_ARITH_TABLE_BITS - RECIP_ARITH_BINARY_PROB_BITS);
+}
+
+static recip_arith_inline void recip_arith_prob_update(recip_arith_prob * p,int bit)
+{
+    // p stays in [1,RECIP_ARITH_BINARY_PROB_ONE) : the shift can never take it to 0 or to ONE
+    if ( bit ) *p -= (*p >> RECIP_ARITH_BINARY_ADAPT_SHIFT);
+    else *p += ((RECIP_ARITH_BINARY_PROB_ONE - *p) >> RECIP_ARITH_BINARY_ADAPT_SHIFT);
+}
+
+//=========================================================================================
+
+// encode a bit , adapt p , and renorm
+static recip_arith_inline void recip_arith_encoder_put_bit(recip_arith_encoder * ac,recip_arith_prob * p,int bit)
+{
+    recip_arith_assert( *p > 0 && *p < RECIP_ARITH_BINARY_PROB_ONE );
+    recip_arith_assert( ac->range >= ((uint32_t)1<<24) );
+
+    uint32_t bound = recip_arith_binary_bound(ac->range,*p);
+
+    if ( bit == 0 )
+    {
+        ac->range = bound;
+    }
+    else
+    {
+        uint32_t save_low = ac->low;
+        ac->low += bound;
+        ac->range -= bound;
+        if ( ac->low < save_low ) recip_arith_encoder_carry(ac);
+    }
+
+    recip_arith_prob_update(p,bit);
+    recip_arith_encoder_renorm(ac);
+}
+
+// decode a bit , adapt p , and renorm
+static recip_arith_inline int recip_arith_decoder_get_bit(recip_arith_decoder * ac,recip_arith_prob * p)
+{
+    recip_arith_assert( ac->range >= ((uint32_t)1<<24) );
+
+    uint32_t bound = recip_arith_binary_bound(ac->range,*p);
+
+    int bit;
+    if ( ac->code < bound )
+    {
+        ac->range = bound;
+        bit = 0;
+    }
+    else
+    {
+        ac->code -= bound;
+        ac->range -= bound;
+        bit = 1;
+    }
+
+    recip_arith_prob_update(p,bit);
+    recip_arith_decoder_renorm(ac);
+    return bit;
+}
+
+//=========================================================================================
+
+/**
+
+bit trees : an nbits value as nbits binary decisions , top bit first ,
+each with the bits above it as context
+
+probs has (1<<nbits) entries , [0] is unused
+eg. nbits = 8 codes a byte with probs[256]
+
+**/
+
+static inline void recip_arith_prob_init(recip_arith_prob * probs,int count)
+{
+    for(int i=0;i<count;i++)
+        probs[i] = RECIP_ARITH_BINARY_PROB_INIT;
+}
+
+static recip_arith_inline void recip_arith_encoder_put_bittree(recip_arith_encoder * ac,recip_arith_prob * probs,int nbits,uint32_t value)
+{
+    recip_arith_assert( value < ((uint32_t)1<<nbits) );
+
+    uint32_t node = 1;
+    for(int i=nbits-1;i>=0;i--)
+    {
+        int bit = (value>>i)&1;
+        recip_arith_encoder_put_bit(ac,&probs[node],bit);
+        node = node*2 + bit;
+    }
+}
+
+static recip_arith_inline uint32_t recip_arith_decoder_get_bittree(recip_arith_decoder * ac,recip_arith_prob * probs,int nbits)
+{
+    uint32_t node = 1;
+    for(int i=0;i<nbits;i++)
+    {
+        node = node*2 + recip_arith_decoder_get_bit(ac,&probs[node]);
+    }
+    return node - ((uint32_t)1<<nbits);
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_BINARY_H
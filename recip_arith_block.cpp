@@ -0,0 +1,432 @@
+/**
+recip_arith_block.cpp
+block-parallel framed container for order-0 recip_arith coding
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+
+#include "recip_arith_block.h"
+#include "recip_arith_static_model.h"
+#include "recip_arith_symbol_lookup.h"
+#include "recip_arith_checked.h"
+
+#include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//=========================================================================================
+
+// bitmap + u16 per symbol :
+#define RECIP_ARITH_BLOCK_MODEL_MAX_SIZE    (32 + 2*256)
+
+// the encoder checks for expansion every CHECK_INTERVAL symbols ;
+//  each symbol can put at most 3 bytes (range >= 1<<24 , cdf_bits <= 16)
+//  and _finish at most 2 , so this much past block_len is enough slack :
+#define RECIP_ARITH_BLOCK_CHECK_INTERVAL    (256)
+#define RECIP_ARITH_BLOCK_SLOT_SLACK        (3*RECIP_ARITH_BLOCK_CHECK_INTERVAL + 8)
+
+static uint64_t recip_arith_block_slot_size(uint32_t block_size)
+{
+    return 1 + RECIP_ARITH_BLOCK_MODEL_MAX_SIZE + (uint64_t)block_size + RECIP_ARITH_BLOCK_SLOT_SLACK;
+}
+
+static uint64_t recip_arith_block_count(uint64_t raw_len,uint32_t block_size)
+{
+    return ( raw_len + block_size - 1 ) / block_size;
+}
+
+//=========================================================================================
+
+/**
+
+the worker pool : threads are started the first time a call wants them and then kept ,
+parked on a condition variable , so each compress/decompress only pays a wake & a join on a counter.
+one call uses the pool at a time ; a call that finds it busy (from another thread) spawns its own threads.
+the pool's threads are joined at exit.
+
+**/
+struct recip_arith_block_pool
+{
+    std::mutex call_mutex;              // held for a whole run
+    std::mutex mutex;                   // the fields below
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::vector<std::thread> threads;
+    const std::function<void()> * job;
+    uint64_t generation;                // bumped for each job
+    int num_helpers;                    // pool threads [0,num_helpers) run the job
+    int pending;                        // helpers still running it
+    bool quit;
+
+    recip_arith_block_pool() : job(NULL), generation(0), num_helpers(0), pending(0), quit(false) { }
+    ~recip_arith_block_pool();
+};
+
+static void recip_arith_block_pool_worker(recip_arith_block_pool * pool,int index)
+{
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    for(;;)
+    {
+        pool->wake.wait(lock,[&]{ return pool->quit || pool->generation != seen; });
+        if ( pool->quit ) return;
+        seen = pool->generation;
+        if ( index >= pool->num_helpers ) continue;
+
+        const std::function<void()> * job = pool->job;
+        lock.unlock();
+        (*job)();
+        lock.lock();
+        if ( --pool->pending == 0 ) pool->done.notify_one();
+    }
+}
+
+recip_arith_block_pool::~recip_arith_block_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for(size_t t=0;t<threads.size();t++)
+        threads[t].join();
+}
+
+// the one pool , shared by every parallel_for :
+static recip_arith_block_pool * recip_arith_block_get_pool()
+{
+    static recip_arith_block_pool s_pool;
+    return &s_pool;
+}
+
+// run job on the calling thread and num_helpers pool threads , return when all are done ;
+//  false if another call has the pool
+static bool recip_arith_block_pool_try_run(recip_arith_block_pool * pool,int num_helpers,const std::function<void()> & job)
+{
+    std::unique_lock<std::mutex> call_lock(pool->call_mutex,std::try_to_lock);
+    if ( ! call_lock.owns_lock() ) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        while ( (int)pool->threads.size() < num_helpers )
+            pool->threads.emplace_back(recip_arith_block_pool_worker,pool,(int)pool->threads.size());
+        pool->job = &job;
+        pool->num_helpers = num_helpers;
+        pool->pending = num_helpers;
+        pool->generation++;
+    }
+    pool->wake.notify_all();
+
+    job();
+
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->done.wait(lock,[&]{ return pool->pending == 0; });
+    pool->job = NULL;
+    return true;
+}
+
+/**
+
+run task(0..num_tasks-1) on num_threads threads , the caller's and pool threads
+tasks are handed out one at a time from an atomic counter , so uneven blocks balance
+
+**/
+template <typename t_task>
+static void recip_arith_block_parallel_for(uint64_t num_tasks,int num_threads,const t_task & task)
+{
+    if ( num_threads <= 0 ) num_threads = (int)std::thread::hardware_concurrency();
+    if ( num_threads <= 0 ) num_threads = 1;
+    if ( (uint64_t)num_threads > num_tasks ) num_threads = (int)num_tasks;
+
+    std::atomic<uint64_t> next_task(0);
+
+    std::function<void()> worker = [&]()
+    {
+        for(;;)
+        {
+            uint64_t i = next_task.fetch_add(1);
+            if ( i >= num_tasks ) break;
+            task(i);
+        }
+    };
+
+    if ( num_threads <= 1 )
+    {
+        worker();
+        return;
+    }
+
+    if ( recip_arith_block_pool_try_run(recip_arith_block_get_pool(),num_threads-1,worker) ) return;
+
+    std::vector<std::thread> threads;
+    for(int t=1;t<num_threads;t++)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for(size_t t=0;t<threads.size();t++)
+        threads[t].join();
+}
+
+//=========================================================================================
+
+// encode one block as CODED into slot , return the block size
+//  or 0 if it would not be smaller than the raw bytes
+static uint64_t recip_arith_block_encode_coded(uint8_t * slot,const uint8_t * raw,uint32_t raw_len,uint32_t cdf_bits)
+{
+    uint32_t counts[256] = { };
+    for(uint32_t i=0;i<raw_len;i++) counts[ raw[i] ] += 1;
+
+    uint32_t freqs[256];
+    uint32_t cdf[257];
+    if ( ! recip_arith_normalize_counts(freqs,counts,256,cdf_bits) )
+        return 0;
+    recip_arith_cdf_from_freqs(cdf,freqs,256);
+
+    uint8_t * ptr = slot;
+    *ptr++ = RECIP_ARITH_BLOCK_MODE_CODED;
+
+    uint8_t * bitmap = ptr;
+    memset(bitmap,0,32);
+    ptr += 32;
+    for(int s=0;s<256;s++)
+    {
+        if ( freqs[s] == 0 ) continue;
+        bitmap[s>>3] |= (uint8_t)(1<<(s&7));
+        *ptr++ = (uint8_t)((freqs[s]-1)>>8);
+        *ptr++ = (uint8_t)(freqs[s]-1);
+    }
+
+    // give up once the stream is as big as the raw bytes :
+    uint8_t * limit = slot + 1 + raw_len;
+
+    recip_arith_encoder enc;
+    recip_arith_encoder_start(&enc,ptr);
+
+    for(uint32_t i=0;i<raw_len;)
+    {
+        uint32_t chunk_end = i + RECIP_ARITH_BLOCK_CHECK_INTERVAL;
+        if ( chunk_end > raw_len ) chunk_end = raw_len;
+
+        for(;i<chunk_end;i++)
+        {
+            int sym = raw[i];
+            recip_arith_encoder_put(&enc,cdf[sym],freqs[sym],cdf_bits);
+            recip_arith_encoder_renorm(&enc);
+        }
+
+        if ( enc.ptr >= limit ) return 0;
+    }
+
+    uint8_t * end = recip_arith_encoder_finish(&enc);
+    if ( end >= limit ) return 0;
+
+    return (uint64_t)(end - slot);
+}
+
+// encode one block into slot , return the block size
+static uint64_t recip_arith_block_encode(uint8_t * slot,const uint8_t * raw,uint32_t raw_len,uint32_t cdf_bits)
+{
+    uint64_t comp_len = recip_arith_block_encode_coded(slot,raw,raw_len,cdf_bits);
+    if ( comp_len != 0 ) return comp_len;
+
+    slot[0] = RECIP_ARITH_BLOCK_MODE_RAW;
+    memcpy(slot+1,raw,raw_len);
+    return 1 + (uint64_t)raw_len;
+}
+
+// decode one block , false if it's malformed
+//  never reads outside [comp,comp+comp_len)
+static bool recip_arith_block_decode(uint8_t * raw,uint32_t raw_len,const uint8_t * comp,uint64_t comp_len,uint32_t cdf_bits)
+{
+    if ( comp_len < 1 ) return false;
+
+    if ( comp[0] == RECIP_ARITH_BLOCK_MODE_RAW )
+    {
+        if ( comp_len != 1 + (uint64_t)raw_len ) return false;
+        memcpy(raw,comp+1,raw_len);
+        return true;
+    }
+    if ( comp[0] != RECIP_ARITH_BLOCK_MODE_CODED ) return false;
+
+    const uint8_t * ptr = comp + 1;
+    const uint8_t * end = comp + comp_len;
+    if ( end - ptr < 32 ) return false;
+
+    const uint8_t * bitmap = ptr;
+    ptr += 32;
+
+    uint32_t cdf[257];
+    cdf[0] = 0;
+    for(int s=0;s<256;s++)
+    {
+        uint32_t freq = 0;
+        if ( bitmap[s>>3] & (1<<(s&7)) )
+        {
+            if ( end - ptr < 2 ) return false;
+            freq = ((ptr[0]<<8) | ptr[1]) + 1;
+            ptr += 2;
+        }
+        cdf[s+1] = cdf[s] + freq;
+    }
+    if ( cdf[256] != ((uint32_t)1<<cdf_bits) ) return false;
+    if ( end - ptr < 1 ) return false;
+
+    recip_arith_symbol_lookup lut;
+    if ( ! recip_arith_symbol_lookup_init(&lut,cdf,256,cdf_bits,RECIP_ARITH_LOOKUP_AUTO) )
+        return false;
+
+    recip_arith_checked_decoder dec;
+    recip_arith_checked_decoder_start(&dec,ptr,(size_t)(end - ptr));
+
+    uint32_t i = 0;
+
+    // unchecked renorm while far from the end of the block :
+    for(;;)
+    {
+        size_t n = recip_arith_checked_decoder_safe_count(&dec);
+        if ( n > raw_len - i ) n = raw_len - i;
+        if ( n == 0 ) break;
+
+        for(uint32_t e=i+(uint32_t)n;i<e;i++)
+        {
+            uint32_t target = recip_arith_checked_decoder_peek(&dec,cdf_bits);
+            uint32_t sym = recip_arith_symbol_lookup_find(&lut,target);
+            raw[i] = (uint8_t) sym;
+            recip_arith_checked_decoder_remove(&dec,cdf[sym],cdf[sym+1] - cdf[sym]);
+            recip_arith_decoder_renorm(&dec.dec);
+        }
+    }
+
+    for(;i<raw_len;i++)
+    {
+        uint32_t target = recip_arith_checked_decoder_peek(&dec,cdf_bits);
+        uint32_t sym = recip_arith_symbol_lookup_find(&lut,target);
+        raw[i] = (uint8_t) sym;
+        recip_arith_checked_decoder_remove(&dec,cdf[sym],cdf[sym+1] - cdf[sym]);
+        recip_arith_checked_decoder_renorm(&dec);
+    }
+
+    recip_arith_symbol_lookup_free(&lut);
+
+    return ( recip_arith_checked_decoder_status(&dec) == RECIP_ARITH_DECODE_OK );
+}
+
+//=========================================================================================
+
+uint64_t recip_arith_block_compress_bound(uint64_t raw_len,uint32_t block_size)
+{
+    if ( block_size == 0 ) return 0;
+    uint64_t num_blocks = recip_arith_block_count(raw_len,block_size);
+    return RECIP_ARITH_BLOCK_HEADER_SIZE + 8*(num_blocks+1) + num_blocks*recip_arith_block_slot_size(block_size) + RECIP_ARITH_BLOCK_TAIL_PADDING;
+}
+
+uint64_t recip_arith_block_compress(uint8_t * comp,uint64_t comp_capacity,const uint8_t * raw,uint64_t raw_len,
+                                    uint32_t block_size,uint32_t cdf_bits,int num_threads)
+{
+    if ( block_size == 0 ) return 0;
+    if ( cdf_bits < RECIP_ARITH_BLOCK_MIN_CDF_BITS || cdf_bits > RECIP_ARITH_BLOCK_MAX_CDF_BITS ) return 0;
+    if ( comp_capacity < recip_arith_block_compress_bound(raw_len,block_size) ) return 0;
+
+    uint64_t num_blocks = recip_arith_block_count(raw_len,block_size);
+    uint64_t slot_size = recip_arith_block_slot_size(block_size);
+
+    recip_arith_put_be32(comp,RECIP_ARITH_BLOCK_MAGIC);
+    recip_arith_put_be32(comp+4,block_size);
+    recip_arith_put_be32(comp+8,cdf_bits);
+    recip_arith_put_be64(comp+12,raw_len);
+
+    uint8_t * index = comp + RECIP_ARITH_BLOCK_HEADER_SIZE;
+    uint8_t * data = index + 8*(num_blocks+1);
+
+    std::vector<uint64_t> block_comp_len((size_t)num_blocks);
+
+    // encode each block into its own slot :
+    recip_arith_block_parallel_for(num_blocks,num_threads,[&](uint64_t b)
+    {
+        uint64_t raw_pos = b * block_size;
+        uint64_t len = raw_len - raw_pos;
+        if ( len > block_size ) len = block_size;
+
+        block_comp_len[(size_t)b] = recip_arith_block_encode(data + b*slot_size,raw + raw_pos,(uint32_t)len,cdf_bits);
+    });
+
+    // compact the slots down & write the offsets :
+    //  slots only move down and in order , so memmove never clobbers an unmoved one
+    uint8_t * ptr = data;
+    for(uint64_t b=0;b<num_blocks;b++)
+    {
+        recip_arith_put_be64(index + 8*b,(uint64_t)(ptr - comp));
+        memmove(ptr,data + b*slot_size,(size_t)block_comp_len[(size_t)b]);
+        ptr += block_comp_len[(size_t)b];
+    }
+    recip_arith_put_be64(index + 8*num_blocks,(uint64_t)(ptr - comp));
+
+    memset(ptr,0,RECIP_ARITH_BLOCK_TAIL_PADDING);
+    ptr += RECIP_ARITH_BLOCK_TAIL_PADDING;
+
+    return (uint64_t)(ptr - comp);
+}
+
+bool recip_arith_block_get_raw_len(const uint8_t * comp,uint64_t comp_len,uint64_t * p_raw_len)
+{
+    if ( comp_len < RECIP_ARITH_BLOCK_HEADER_SIZE ) return false;
+    if ( recip_arith_get_be32(comp) != RECIP_ARITH_BLOCK_MAGIC ) return false;
+    *p_raw_len = recip_arith_get_be64(comp+12);
+    return true;
+}
+
+bool recip_arith_block_decompress(uint8_t * raw,uint64_t raw_capacity,const uint8_t * comp,uint64_t comp_len,int num_threads)
+{
+    uint64_t raw_len;
+    if ( ! recip_arith_block_get_raw_len(comp,comp_len,&raw_len) ) return false;
+    if ( raw_capacity < raw_len ) return false;
+
+    uint32_t block_size = recip_arith_get_be32(comp+4);
+    uint32_t cdf_bits = recip_arith_get_be32(comp+8);
+    if ( block_size == 0 ) return false;
+    if ( cdf_bits < RECIP_ARITH_BLOCK_MIN_CDF_BITS || cdf_bits > RECIP_ARITH_BLOCK_MAX_CDF_BITS ) return false;
+
+    uint64_t num_blocks = recip_arith_block_count(raw_len,block_size);
+    if ( num_blocks >= comp_len / 8 ) return false; // (also catches a huge raw_len)
+
+    const uint8_t * index = comp + RECIP_ARITH_BLOCK_HEADER_SIZE;
+    uint64_t data_start = RECIP_ARITH_BLOCK_HEADER_SIZE + 8*(num_blocks+1);
+    uint64_t data_end = comp_len - RECIP_ARITH_BLOCK_TAIL_PADDING;
+    if ( comp_len < data_start + RECIP_ARITH_BLOCK_TAIL_PADDING ) return false;
+
+    // offsets must be in order and inside the data :
+    uint64_t prev = data_start;
+    for(uint64_t b=0;b<=num_blocks;b++)
+    {
+        uint64_t offset = recip_arith_get_be64(index + 8*b);
+        if ( offset < prev || offset > data_end ) return false;
+        if ( b == 0 && offset != data_start ) return false;
+        prev = offset;
+    }
+
+    std::atomic<bool> ok(true);
+
+    recip_arith_block_parallel_for(num_blocks,num_threads,[&](uint64_t b)
+    {
+        uint64_t raw_pos = b * block_size;
+        uint64_t len = raw_len - raw_pos;
+        if ( len > block_size ) len = block_size;
+
+        uint64_t start = recip_arith_get_be64(index + 8*b);
+        uint64_t end = recip_arith_get_be64(index + 8*(b+1));
+
+        if ( ! recip_arith_block_decode(raw + raw_pos,(uint32_t)len,comp + start,end - start,cdf_bits) )
+            ok = false;
+    });
+
+    return ok;
+}
@@ -0,0 +1,94 @@
+#pragma once
+/**
+recip_arith_block.h
+block-parallel framed container for order-0 recip_arith coding
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_BLOCK_H
+#define RECIP_ARITH_BLOCK_H
+
+#include "recip_arith.h"
+
+//=========================================================================================
+
+/**
+
+The input is cut into independent blocks of block_size bytes (the last may be short).
+Each block has its own normalized histogram and its own recip_arith_encoder_start/_finish stream ,
+so blocks encode & decode on separate threads.
+
+container layout , all integers big endian :
+
+    u32 magic       RECIP_ARITH_BLOCK_MAGIC
+    u32 block_size
+    u32 cdf_bits
+    u64 raw_len
+    u64 offsets[num_blocks+1]     block i is [offsets[i],offsets[i+1]) from the container start
+    blocks
+    RECIP_ARITH_BLOCK_TAIL_PADDING zero bytes , room for decoders that read ahead
+
+    num_blocks = ceil(raw_len / block_size)
+
+each block :
+
+    u8 mode
+    RECIP_ARITH_BLOCK_MODE_RAW :    the raw bytes
+    RECIP_ARITH_BLOCK_MODE_CODED :  32 byte bitmap of the symbols present ,
+                                    u16 (freq-1) for each present symbol ,
+                                    recip_arith stream
+
+a block that doesn't get smaller is stored RAW.
+
+recip_arith_block_compress encodes every block into its own preallocated slot of the output ,
+then compacts the slots together in a final pass and writes the offsets.
+So comp must have recip_arith_block_compress_bound bytes , though the result is much smaller.
+
+num_threads <= 0 means one per hardware thread ; the calling thread is one of the workers.
+the other workers come from a pool that is started on first use and kept , so calls don't spawn threads ;
+a call made while another thread's call has the pool spawns threads of its own for that call.
+
+recip_arith_table_init must be called before decompressing.
+
+decompress validates the header , the offsets and each block's model ,
+and decodes the streams with recip_arith_checked_decoder , so corrupt or truncated input
+is reported and never read outside the container.
+
+**/
+
+#define RECIP_ARITH_BLOCK_MAGIC             (0x52414231)    // "RAB1"
+#define RECIP_ARITH_BLOCK_HEADER_SIZE       (20)
+#define RECIP_ARITH_BLOCK_TAIL_PADDING      (8)
+
+#define RECIP_ARITH_BLOCK_MODE_RAW          (0)
+#define RECIP_ARITH_BLOCK_MODE_CODED        (1)
+
+#define RECIP_ARITH_BLOCK_DEFAULT_SIZE      (1<<20)
+#define RECIP_ARITH_BLOCK_DEFAULT_CDF_BITS  (13)
+
+// cdf_bits must hold 256 symbols at freq >= 1 , and (freq-1) must fit in a u16 :
+#define RECIP_ARITH_BLOCK_MIN_CDF_BITS      (8)
+#define RECIP_ARITH_BLOCK_MAX_CDF_BITS      (16)
+
+//=========================================================================================
+
+// bytes of comp that recip_arith_block_compress needs , for any data
+uint64_t recip_arith_block_compress_bound(uint64_t raw_len,uint32_t block_size);
+
+// returns the container size , or 0 on bad arguments
+uint64_t recip_arith_block_compress(uint8_t * comp,uint64_t comp_capacity,const uint8_t * raw,uint64_t raw_len,
+                                    uint32_t block_size,uint32_t cdf_bits,int num_threads);
+
+// reads raw_len from the container header ; false if it isn't a valid header
+bool recip_arith_block_get_raw_len(const uint8_t * comp,uint64_t comp_len,uint64_t * p_raw_len);
+
+// raw must have raw_len bytes ; returns false on a malformed container
+bool recip_arith_block_decompress(uint8_t * raw,uint64_t raw_capacity,const uint8_t * comp,uint64_t comp_len,int num_threads);
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_BLOCK_H
@@ -0,0 +1,122 @@
+#pragma once
+/**
+recip_arith_bypass.h
+raw equiprobable bits on the recip_arith_encoder / recip_arith_decoder , shifts only
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_BYPASS_H
+#define RECIP_ARITH_BYPASS_H
+
+#include "recip_arith.h"
+
+//=========================================================================================
+
+/**
+
+recip_arith_encoder_put_bits writes nbits (1-24) equiprobable bits in one step , in the same stream as
+modeled symbols ; no reciprocal table , no multiply , not limited by cdf_bits.
+
+An exact split of range into 2^nbits equal parts needs a divide in the decoder ,
+so range is cut in units of 2^k instead , k = (bits in range) - 1 - nbits :
+
+    T = range >> k , in [2^nbits , 2^(nbits+1)) units
+    e = T - 2^nbits , the extra units
+
+values below e get 2 units , the rest get 1 (like the sm98 map , the excess goes to the low values)
+
+    low(v) = v + min(v,e)   size(v) = 1 + (v < e)
+
+the decoder gets v back from x = code >> k : v = x>>1 for x < 2e , else x-e ;
+the 2-unit intervals start on even units , so removing v is just masking code to the new range.
+
+loss is log2(1 + e/2^nbits) - e/2^nbits , 0 to 0.086 bits per call , about 0.06 on average
+(plus the range below the last unit , under 2^-nbits) , so batch bits into one call where possible.
+Truncating range to a plain power of two would lose up to a whole bit , about 0.5 on average.
+
+range after put_bits is a power of two , so the next modeled symbol has no map loss ,
+and a following put_bits has e = 0 : runs of put_bits lose nothing after the first.
+
+so put_bits wins for runs of bypass bits and for more than cdf_bits bits in one call (up to 24) ;
+a few bits between modeled symbols are faster and smaller through _put with freq 1 at cdf_bits = nbits.
+measured (big.txt , gcc -O2 , best of 7 runs , MB/s of bytes decoded) :
+
+    16-bit words , put_bits back to back                    about 480 , 16.0000 bits per word
+    byte + 12 bits , the 12 bits with put_bits              about 53 , 12.055 bits
+    byte + 12 bits , the 12 bits with _put freq 1 (cdf 12)  about 59 , 12.000 bits
+
+the decoder has a branch for e == 0 (back-to-back calls , predictable) and selects the value without
+a branch otherwise ; after a modeled symbol e is random , and branching on x < 2e there mispredicted
+(byte + 12 bits decoded at 45-50 MB/s that way).
+
+call _renorm before , as for _put ; range can drop to 1 , the plain byte renorms handle that ,
+the branchless renorms (which need range >= 1<<(RECIP_ARITH_TABLE_BITS-1)) do not.
+
+**/
+
+#define RECIP_ARITH_BYPASS_MAX_BITS     (24)
+
+// the 2^k unit size and the extra units of range , for nbits
+static recip_arith_inline uint32_t recip_arith_bypass_split(uint32_t range,uint32_t nbits,uint32_t * p_extra)
+{
+    recip_arith_assert( nbits >= 1 && nbits <= RECIP_ARITH_BYPASS_MAX_BITS );
+    recip_arith_assert( range >= (1<<24) );
+
+    uint32_t k = 31 - clz32(range) - nbits;
+    *p_extra = (range >> k) - ((uint32_t)1<<nbits);
+    return k;
+}
+
+static recip_arith_inline void recip_arith_encoder_put_bits(recip_arith_encoder * ac,uint32_t value,uint32_t nbits)
+{
+    recip_arith_assert( value < ((uint32_t)1<<nbits) );
+
+    uint32_t e;
+    uint32_t k = recip_arith_bypass_split(ac->range,nbits,&e);
+
+    uint32_t low_units = value + ( value < e ? value : e );
+    uint32_t size_units = 1 + ( value < e ? 1 : 0 );
+
+    uint32_t save_low = ac->low;
+    ac->low += low_units << k;
+    ac->range = size_units << k;
+
+    if ( ac->low < save_low ) recip_arith_encoder_carry(ac);
+}
+
+static recip_arith_inline uint32_t recip_arith_decoder_get_bits(recip_arith_decoder * ac,uint32_t nbits)
+{
+    uint32_t e;
+    uint32_t k = recip_arith_bypass_split(ac->range,nbits,&e);
+
+    // the 2-unit values cover x in [0,2e) and start on even units , the 1-unit ones start at x ;
+    //  either way the value's interval starts at (code >> k) with the low unit bit dropped for 2-unit values ,
+    //  so removing it just masks code to the new range
+    uint32_t x = ac->code >> k;
+
+    // no 2-unit values : range was already a power of two , as after another put_bits
+    if ( e == 0 )
+    {
+        ac->range = (uint32_t)1 << k;
+        ac->code &= ac->range - 1;
+        return x;
+    }
+
+    uint32_t is_double = ( x < 2*e ) ? 1 : 0;
+    uint32_t double_mask = 0 - is_double;
+    uint32_t value = ((x >> 1) & double_mask) | ((x - e) & ~double_mask);
+    recip_arith_assert( value < ((uint32_t)1<<nbits) );
+
+    ac->range = (1 + is_double) << k;
+    ac->code &= ac->range - 1;
+
+    return value;
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_BYPASS_H
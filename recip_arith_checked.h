@@ -0,0 +1,198 @@
+#pragma once
+/**
+recip_arith_checked.h
+bounds-checked recip_arith decoding for untrusted input
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_CHECKED_H
+#define RECIP_ARITH_CHECKED_H
+
+#include "recip_arith.h"
+
+#include <stddef.h>
+
+//=========================================================================================
+
+/**
+
+recip_arith_decoder trusts the stream : _start reads 4 bytes and _renorm reads on with no end pointer ,
+and a corrupt stream can make _peek return targets past the cdf , which then index off the decode_table.
+
+recip_arith_checked_decoder wraps a recip_arith_decoder with an end pointer :
+
+_peek is recip_arith_decoder_peek that flags target >= (1<<cdf_bits) as corrupt
+    and masks it , so the symbol lookup always stays in bounds
+
+_safe_count tells you how many symbols can be decoded before the decoder could reach the end ;
+    those use the plain unchecked recip_arith_decoder_renorm
+then the tail uses _renorm , which checks every byte against the end.
+
+bytes past the end read as zero.  A valid stream is read at most 3 bytes past its end
+(the decoder runs 4 bytes ahead of the encoder , and _finish writes at least one) ,
+so reading further than that means the stream was truncated.
+
+errors are sticky ; check _status once after the whole decode.
+
+**/
+
+#define RECIP_ARITH_DECODE_OK           (0)
+#define RECIP_ARITH_DECODE_CORRUPT      (1)     // a target outside the cdf
+#define RECIP_ARITH_DECODE_TRUNCATED    (2)     // read too far past the end
+
+// a symbol's renorm reads at most 3 bytes : range >= (1<<(RECIP_ARITH_TABLE_BITS-1)) after remove
+#define RECIP_ARITH_DECODER_MAX_BYTES_PER_SYMBOL    (3)
+
+// a valid stream is read at most this far past its end
+#define RECIP_ARITH_DECODER_MAX_OVERREAD            (3)
+
+struct recip_arith_checked_decoder
+{
+    recip_arith_decoder dec;    // use recip_arith_decoder_remove on this
+    const uint8_t * end;
+    size_t overread;            // zero bytes read past end
+    uint32_t corrupt;
+};
+
+static recip_arith_inline uint32_t recip_arith_checked_decoder_get_byte(recip_arith_checked_decoder * ac)
+{
+    if ( ac->dec.ptr < ac->end )
+        return *(ac->dec.ptr)++;
+    ac->overread++;
+    return 0;
+}
+
+static recip_arith_inline void recip_arith_checked_decoder_start(recip_arith_checked_decoder * ac,const uint8_t * ptr,size_t len)
+{
+    ac->end = ptr + len;
+    ac->overread = 0;
+    ac->corrupt = 0;
+
+    ac->dec.ptr = ptr;
+    ac->dec.range = ~(uint32_t)0;
+    ac->dec.code = 0;
+    for(int i=0;i<4;i++)
+        ac->dec.code = (ac->dec.code << 8) | recip_arith_checked_decoder_get_byte(ac);
+}
+
+// how many symbols can be decoded with the unchecked recip_arith_decoder_renorm
+static recip_arith_inline size_t recip_arith_checked_decoder_safe_count(const recip_arith_checked_decoder * ac)
+{
+    if ( ac->dec.ptr >= ac->end ) return 0;
+    return (size_t)(ac->end - ac->dec.ptr) / RECIP_ARITH_DECODER_MAX_BYTES_PER_SYMBOL;
+}
+
+// recip_arith_decoder_peek on a plain decoder , but flags an out of range target in *p_corrupt instead of asserting
+//  and masks it , so the symbol lookup always stays in bounds
+//  (the mask is one AND on the serial chain ; a compare+cmov clamp there cost ~12% decode speed)
+static recip_arith_inline uint32_t recip_arith_decoder_peek_masked(recip_arith_decoder * dec,uint32_t cdf_bits,uint32_t * p_corrupt)
+{
+    uint32_t range = dec->range;
+    int range_clz = clz32(range);
+
+    uint32_t r_top = range >> (32 - range_clz - RECIP_ARITH_TABLE_BITS);
+    uint32_t r_norm = r_top << (32 - range_clz - RECIP_ARITH_TABLE_BITS - cdf_bits);
+
+    dec->range = r_norm;
+
+    uint32_t code_necessary_bits = dec->code >> (32 - range_clz - RECIP_ARITH_TABLE_BITS - cdf_bits);
+
+    uint32_t target = (uint32_t)( ( code_necessary_bits * (uint64_t)recip_arith_table[r_top] ) >> RECIP_ARITH_NUMERATOR_BITS );
+
+    // in a valid stream code < range so target < cdf total :
+    const uint32_t target_mask = ((uint32_t)1<<cdf_bits) - 1;
+    *p_corrupt |= ( target > target_mask );
+    return target & target_mask;
+}
+
+static recip_arith_inline uint32_t recip_arith_checked_decoder_peek(recip_arith_checked_decoder * ac,uint32_t cdf_bits)
+{
+    recip_arith_assert( ac->dec.range >= ((uint32_t)1<<cdf_bits) );
+    return recip_arith_decoder_peek_masked(&ac->dec,cdf_bits,&ac->corrupt);
+}
+
+static recip_arith_inline void recip_arith_checked_decoder_remove(recip_arith_checked_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq)
+{
+    recip_arith_decoder_remove(&ac->dec,cdf_low,cdf_freq);
+}
+
+// bounds-checked renorm for the tail
+static recip_arith_inline void recip_arith_checked_decoder_renorm(recip_arith_checked_decoder * ac)
+{
+    while ( ac->dec.range < (1<<24) )
+    {
+        ac->dec.code = (ac->dec.code << 8) | recip_arith_checked_decoder_get_byte(ac);
+        ac->dec.range <<= 8;
+    }
+}
+
+static inline int recip_arith_checked_decoder_status(const recip_arith_checked_decoder * ac)
+{
+    if ( ac->corrupt ) return RECIP_ARITH_DECODE_CORRUPT;
+    if ( ac->overread > RECIP_ARITH_DECODER_MAX_OVERREAD ) return RECIP_ARITH_DECODE_TRUNCATED;
+    return RECIP_ARITH_DECODE_OK;
+}
+
+//=========================================================================================
+
+/**
+
+recip_arith_checked_decode : decode count symbols from [ptr,ptr+len) with the fast/slow split
+
+decode_table is (1<<cdf_bits) entries , as in test_recip_arith ; it needs no padding slot
+returns RECIP_ARITH_DECODE_OK or an error ; on error syms are garbage but all memory access stayed in bounds
+
+**/
+static inline int recip_arith_checked_decode(uint8_t * syms,size_t count,const uint8_t * ptr,size_t len,
+                                            const uint32_t * cdf,const uint8_t * decode_table,uint32_t cdf_bits)
+{
+    recip_arith_checked_decoder ac;
+    recip_arith_checked_decoder_start(&ac,ptr,len);
+
+    size_t i = 0;
+
+    // fast : far enough from the end that the plain renorm can't run off
+    //  the decoder state and the corrupt flag live in locals here so they stay in registers
+    recip_arith_decoder dec = ac.dec;
+    uint32_t corrupt = 0;
+    for(;;)
+    {
+        size_t n = ( dec.ptr < ac.end ) ? (size_t)(ac.end - dec.ptr) / RECIP_ARITH_DECODER_MAX_BYTES_PER_SYMBOL : 0;
+        if ( n > count - i ) n = count - i;
+        if ( n == 0 ) break;
+
+        for(size_t e=i+n;i<e;i++)
+        {
+            uint32_t target = recip_arith_decoder_peek_masked(&dec,cdf_bits,&corrupt);
+            uint8_t sym = decode_table[target];
+            syms[i] = sym;
+            recip_arith_decoder_remove(&dec,cdf[sym],cdf[sym+1] - cdf[sym]);
+            recip_arith_decoder_renorm(&dec);
+        }
+    }
+    ac.dec = dec;
+    ac.corrupt |= corrupt;
+
+    // slow : checked tail
+    for(;i<count;i++)
+    {
+        uint32_t target = recip_arith_checked_decoder_peek(&ac,cdf_bits);
+        uint8_t sym = decode_table[target];
+        syms[i] = sym;
+        recip_arith_checked_decoder_remove(&ac,cdf[sym],cdf[sym+1] - cdf[sym]);
+        recip_arith_checked_decoder_renorm(&ac);
+
+        // stop early on a truncated stream rather than decoding zeros forever :
+        if ( ac.overread > RECIP_ARITH_DECODER_MAX_OVERREAD ) break;
+    }
+
+    return recip_arith_checked_decoder_status(&ac);
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_CHECKED_H
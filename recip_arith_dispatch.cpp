@@ -0,0 +1,344 @@
+/**
+recip_arith_dispatch.cpp
+runtime CPU feature dispatch for the block & interleaved coder kernels
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+
+#include "recip_arith_dispatch.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define RECIP_ARITH_DISPATCH_X86
+#endif
+
+// the target of each variant ; the vector levels also get lzcnt & BMI2 , which they require ,
+//  for their scalar tails :
+#ifdef RECIP_ARITH_DISPATCH_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define RECIP_ARITH_SIMD_AVX2_TARGET
+#define RECIP_ARITH_SIMD_AVX512_TARGET
+#else
+#include <cpuid.h>
+#define RECIP_ARITH_DISPATCH_LZCNT_BMI2
+#define RECIP_ARITH_LZCNT_BMI2_TARGET   __attribute__((target("lzcnt,bmi2")))
+#define RECIP_ARITH_SIMD_AVX2_TARGET    __attribute__((target("avx2,lzcnt,bmi2")))
+#define RECIP_ARITH_SIMD_AVX512_TARGET  __attribute__((target("avx512f,avx512cd,avx512bw,avx2,lzcnt,bmi2")))
+#endif
+#endif // RECIP_ARITH_DISPATCH_X86
+
+#include "recip_arith_unrolled.h"
+#include "recip_arith_interleaved.h"
+
+// GCC 12's avx512fintrin.h trips -Wmaybe-uninitialized on its own _mm512_undefined placeholders :
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include "recip_arith_simd.h"
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+//=========================================================================================
+// cpu detection
+
+#ifdef RECIP_ARITH_DISPATCH_X86
+
+static void recip_arith_cpuid(uint32_t leaf,uint32_t subleaf,uint32_t regs[4])
+{
+    #if defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuidex(r,(int)leaf,(int)subleaf);
+    for(int i=0;i<4;i++) regs[i] = (uint32_t) r[i];
+    #else
+    __cpuid_count(leaf,subleaf,regs[0],regs[1],regs[2],regs[3]);
+    #endif
+}
+
+// XCR0 : which register states the OS saves on a context switch
+static uint64_t recip_arith_xgetbv0()
+{
+    #if defined(_MSC_VER) && !defined(__clang__)
+    return _xgetbv(0);
+    #else
+    uint32_t lo,hi;
+    __asm__ __volatile__ ( "xgetbv" : "=a"(lo), "=d"(hi) : "c"(0) );
+    return ((uint64_t)hi<<32) | lo;
+    #endif
+}
+
+static uint32_t recip_arith_detect_cpu()
+{
+    uint32_t regs[4];
+    uint32_t features = 0;
+
+    recip_arith_cpuid(0,0,regs);
+    uint32_t max_leaf = regs[0];
+    recip_arith_cpuid(0x80000000,0,regs);
+    uint32_t max_ext_leaf = regs[0];
+
+    if ( max_ext_leaf >= 0x80000001 )
+    {
+        recip_arith_cpuid(0x80000001,0,regs);
+        if ( regs[2] & (1<<5) ) features |= RECIP_ARITH_CPU_LZCNT;  // ABM
+    }
+
+    if ( max_leaf < 7 ) return features;
+
+    // the vector states are only usable if the OS saves them (OSXSAVE , then XCR0) :
+    recip_arith_cpuid(1,0,regs);
+    bool os_ymm = false, os_zmm = false;
+    if ( (regs[2] & (1<<27)) && (regs[2] & (1<<28)) )
+    {
+        uint64_t xcr0 = recip_arith_xgetbv0();
+        os_ymm = (xcr0 & 0x06) == 0x06;     // xmm , ymm
+        os_zmm = (xcr0 & 0xE6) == 0xE6;     // + opmask , zmm hi256 , hi16 zmm
+    }
+
+    recip_arith_cpuid(7,0,regs);
+    uint32_t ebx = regs[1];
+    if ( ebx & (1<<8) ) features |= RECIP_ARITH_CPU_BMI2;
+    if ( os_ymm && (ebx & (1<<5)) ) features |= RECIP_ARITH_CPU_AVX2;
+    const uint32_t avx512_f_cd_bw = (1u<<16) | (1u<<28) | (1u<<30);
+    if ( os_zmm && (ebx & avx512_f_cd_bw) == avx512_f_cd_bw ) features |= RECIP_ARITH_CPU_AVX512;
+
+    return features;
+}
+
+#else
+
+static uint32_t recip_arith_detect_cpu()
+{
+    return 0;
+}
+
+#endif // RECIP_ARITH_DISPATCH_X86
+
+uint32_t recip_arith_cpu_features()
+{
+    static const uint32_t s_features = recip_arith_detect_cpu();
+    return s_features;
+}
+
+//=========================================================================================
+// the kernels ; recip_arith_encode_block / _decode_block and the interleaved decoder are force-inlined
+//  into each variant so they are compiled for its target
+
+// one set of scalar kernels per target :
+#define RECIP_ARITH_DISPATCH_SCALAR_KERNELS(name,target) \
+static target uint8_t * recip_arith_encode_block_##name(uint8_t * comp,const uint8_t * syms,size_t count,const uint32_t * cdf,uint32_t cdf_bits) \
+{ \
+    return recip_arith_encode_block(comp,syms,count,cdf,cdf_bits); \
+} \
+static target bool recip_arith_decode_block_##name(uint8_t * syms,size_t count,const uint8_t * comp, \
+                                            const uint32_t * cdf,const uint8_t * decode_table,uint32_t cdf_bits) \
+{ \
+    return recip_arith_decode_block(syms,count,comp,cdf,decode_table,cdf_bits); \
+} \
+static target void recip_arith_decode_x8_##name(uint8_t * syms,size_t count,const uint8_t * ptr, \
+                                            const uint32_t * cdf,const uint8_t * decode_table,uint32_t cdf_bits) \
+{ \
+    recip_arith_interleaved_decode_lanes(syms,count,ptr,8,cdf,decode_table,cdf_bits); \
+} \
+static target void recip_arith_decode_x16_##name(uint8_t * syms,size_t count,const uint8_t * ptr, \
+                                            const uint32_t * cdf,const uint8_t * decode_table,uint32_t cdf_bits) \
+{ \
+    recip_arith_interleaved_decode_lanes(syms,count,ptr,16,cdf,decode_table,cdf_bits); \
+}
+
+RECIP_ARITH_DISPATCH_SCALAR_KERNELS(scalar, )
+
+#ifdef RECIP_ARITH_DISPATCH_LZCNT_BMI2
+RECIP_ARITH_DISPATCH_SCALAR_KERNELS(lzcnt_bmi2,RECIP_ARITH_LZCNT_BMI2_TARGET)
+// the block kernels of the vector levels :
+#define recip_arith_encode_block_vector recip_arith_encode_block_lzcnt_bmi2
+#define recip_arith_decode_block_vector recip_arith_decode_block_lzcnt_bmi2
+#define recip_arith_decode_x16_vector   recip_arith_decode_x16_lzcnt_bmi2
+#else
+#define recip_arith_encode_block_vector recip_arith_encode_block_scalar
+#define recip_arith_decode_block_vector recip_arith_decode_block_scalar
+#define recip_arith_decode_x16_vector   recip_arith_decode_x16_scalar
+#endif
+
+//=========================================================================================
+// the levels
+
+#define RECIP_ARITH_LEVEL_LZCNT_BMI2_CPU    (RECIP_ARITH_CPU_LZCNT|RECIP_ARITH_CPU_BMI2)
+#define RECIP_ARITH_LEVEL_AVX2_CPU          (RECIP_ARITH_LEVEL_LZCNT_BMI2_CPU|RECIP_ARITH_CPU_AVX2)
+#define RECIP_ARITH_LEVEL_AVX512_CPU        (RECIP_ARITH_LEVEL_AVX2_CPU|RECIP_ARITH_CPU_AVX512)
+
+// entries with no kernels aren't compiled in :
+static const recip_arith_kernels c_recip_arith_kernels[RECIP_ARITH_KERNELS_COUNT] =
+{
+    { "scalar" , 0 ,
+        recip_arith_encode_block_scalar , recip_arith_decode_block_scalar ,
+        recip_arith_decode_x8_scalar , recip_arith_decode_x16_scalar },
+
+    #ifdef RECIP_ARITH_DISPATCH_LZCNT_BMI2
+    { "lzcnt+bmi2" , RECIP_ARITH_LEVEL_LZCNT_BMI2_CPU ,
+        recip_arith_encode_block_lzcnt_bmi2 , recip_arith_decode_block_lzcnt_bmi2 ,
+        recip_arith_decode_x8_lzcnt_bmi2 , recip_arith_decode_x16_lzcnt_bmi2 },
+    #else
+    { "lzcnt+bmi2" , RECIP_ARITH_LEVEL_LZCNT_BMI2_CPU , NULL , NULL , NULL , NULL },
+    #endif
+
+    #ifdef RECIP_ARITH_SIMD_AVX2
+    { "avx2" , RECIP_ARITH_LEVEL_AVX2_CPU ,
+        recip_arith_encode_block_vector , recip_arith_decode_block_vector ,
+        recip_arith_avx2_decode , recip_arith_decode_x16_vector },
+    #else
+    { "avx2" , RECIP_ARITH_LEVEL_AVX2_CPU , NULL , NULL , NULL , NULL },
+    #endif
+
+    #if defined(RECIP_ARITH_SIMD_AVX2) && defined(RECIP_ARITH_SIMD_AVX512)
+    { "avx512" , RECIP_ARITH_LEVEL_AVX512_CPU ,
+        recip_arith_encode_block_vector , recip_arith_decode_block_vector ,
+        recip_arith_avx2_decode , recip_arith_avx512_decode },
+    #else
+    { "avx512" , RECIP_ARITH_LEVEL_AVX512_CPU , NULL , NULL , NULL , NULL },
+    #endif
+};
+
+const recip_arith_kernels * recip_arith_get_kernels_level(int level)
+{
+    if ( level < 0 || level >= RECIP_ARITH_KERNELS_COUNT ) return NULL;
+    const recip_arith_kernels * k = &c_recip_arith_kernels[level];
+    if ( k->encode_block == NULL ) return NULL;
+    if ( (recip_arith_cpu_features() & k->required_cpu) != k->required_cpu ) return NULL;
+    return k;
+}
+
+//=========================================================================================
+// timing the lane decoders
+
+// the timing stream : 256 symbols , 32 of them common , about 5.5 bits per symbol
+#define RECIP_ARITH_DISPATCH_TIMING_COUNT       (1<<15)
+#define RECIP_ARITH_DISPATCH_TIMING_CDF_BITS    (12)
+#define RECIP_ARITH_DISPATCH_TIMING_REPEATS     (3)
+
+typedef void (*recip_arith_decode_lanes_func)(uint8_t * syms,size_t count,const uint8_t * ptr,
+                        const uint32_t * cdf,const uint8_t * decode_table,uint32_t cdf_bits);
+
+struct recip_arith_dispatch_timing
+{
+    uint32_t cdf[257];
+    std::vector<uint8_t> decode_table;
+    std::vector<uint8_t> syms;
+    std::vector<uint8_t> dec;
+    std::vector<uint8_t> stream;
+};
+
+static void recip_arith_dispatch_timing_init(recip_arith_dispatch_timing * t,int lanes)
+{
+    const uint32_t cdf_tot = 1u<<RECIP_ARITH_DISPATCH_TIMING_CDF_BITS;
+    t->decode_table.resize(cdf_tot + RECIP_ARITH_SIMD_DECODE_TABLE_PADDING);
+    t->cdf[0] = 0;
+    for(int s=0;s<256;s++)
+    {
+        uint32_t freq = 1 + ( s < 32 ? (cdf_tot-256)/32 : 0 );
+        t->cdf[s+1] = t->cdf[s] + freq;
+        for(uint32_t c=t->cdf[s];c<t->cdf[s+1];c++) t->decode_table[c] = (uint8_t) s;
+    }
+    recip_arith_assert( t->cdf[256] == cdf_tot );
+    for(uint32_t c=cdf_tot;c<t->decode_table.size();c++) t->decode_table[c] = 255;
+
+    // symbols drawn from the cdf with an LCG :
+    t->syms.resize(RECIP_ARITH_DISPATCH_TIMING_COUNT);
+    uint32_t seed = 12345;
+    for(size_t i=0;i<t->syms.size();i++)
+    {
+        seed = seed*1664525u + 1013904223u;
+        t->syms[i] = t->decode_table[ seed >> (32 - RECIP_ARITH_DISPATCH_TIMING_CDF_BITS) ];
+    }
+    t->dec.resize(RECIP_ARITH_DISPATCH_TIMING_COUNT);
+
+    t->stream.resize(2*RECIP_ARITH_DISPATCH_TIMING_COUNT + RECIP_ARITH_INTERLEAVE_TAIL_PADDING);
+    recip_arith_interleaved_encode(t->stream.data(),lanes,t->syms.data(),t->syms.size(),t->cdf,RECIP_ARITH_DISPATCH_TIMING_CDF_BITS);
+}
+
+// best of a few runs , in seconds
+static double recip_arith_dispatch_time_decode(recip_arith_dispatch_timing * t,recip_arith_decode_lanes_func decode)
+{
+    double best = 0;
+    for(int r=0;r<RECIP_ARITH_DISPATCH_TIMING_REPEATS;r++)
+    {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        decode(t->dec.data(),t->dec.size(),t->stream.data(),t->cdf,t->decode_table.data(),RECIP_ARITH_DISPATCH_TIMING_CDF_BITS);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if ( r == 0 || secs < best ) best = secs;
+    }
+    return best;
+}
+
+// the level whose decode_x8 or decode_x16 (slot) runs fastest on this CPU
+static int recip_arith_dispatch_fastest_level(recip_arith_decode_lanes_func recip_arith_kernels::* slot,int lanes)
+{
+    recip_arith_dispatch_timing t;
+    recip_arith_dispatch_timing_init(&t,lanes);
+
+    int best_level = RECIP_ARITH_KERNELS_SCALAR;
+    double best_secs = 0;
+    for(int level=0;level<RECIP_ARITH_KERNELS_COUNT;level++)
+    {
+        const recip_arith_kernels * k = recip_arith_get_kernels_level(level);
+        if ( k == NULL ) continue;
+        // the same kernel as the level below :
+        if ( level > 0 && k->*slot == c_recip_arith_kernels[level-1].*slot ) continue;
+
+        double secs = recip_arith_dispatch_time_decode(&t,k->*slot);
+        if ( level == 0 || secs < best_secs )
+        {
+            best_level = level;
+            best_secs = secs;
+        }
+    }
+    return best_level;
+}
+
+//=========================================================================================
+
+static const recip_arith_kernels * recip_arith_choose_kernels()
+{
+    int top = RECIP_ARITH_KERNELS_SCALAR;
+    for(int level=RECIP_ARITH_KERNELS_COUNT-1;level>0;level--)
+    {
+        if ( recip_arith_get_kernels_level(level) )
+        {
+            top = level;
+            break;
+        }
+    }
+
+    // the block kernels are the same at every level above scalar ; the lane decoders are timed :
+    static recip_arith_kernels s_chosen;
+    static char s_name[64];
+    int x8_level = recip_arith_dispatch_fastest_level(&recip_arith_kernels::decode_x8,8);
+    int x16_level = recip_arith_dispatch_fastest_level(&recip_arith_kernels::decode_x16,16);
+
+    s_chosen = c_recip_arith_kernels[top];
+    s_chosen.decode_x8 = c_recip_arith_kernels[x8_level].decode_x8;
+    s_chosen.decode_x16 = c_recip_arith_kernels[x16_level].decode_x16;
+    snprintf(s_name,sizeof(s_name),"%s (x8 %s , x16 %s)",c_recip_arith_kernels[top].name,
+        c_recip_arith_kernels[x8_level].name,c_recip_arith_kernels[x16_level].name);
+    s_chosen.name = s_name;
+    return &s_chosen;
+}
+
+const recip_arith_kernels * recip_arith_get_kernels()
+{
+    // static init is once & thread safe :
+    static const recip_arith_kernels * s_kernels = recip_arith_choose_kernels();
+    return s_kernels;
+}
+
+//=========================================================================================
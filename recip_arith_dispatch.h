@@ -0,0 +1,114 @@
+#pragma once
+/**
+recip_arith_dispatch.h
+runtime CPU feature dispatch for the block & interleaved coder kernels
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_DISPATCH_H
+#define RECIP_ARITH_DISPATCH_H
+
+#include "recip_arith.h"
+
+#include <stddef.h>
+
+//=========================================================================================
+
+/**
+
+clz.h and recip_arith_simd.h pick their instructions at compile time ,
+so a binary built for the oldest x86 in a fleet never uses lzcnt , BMI2 shifts or the vector decoders ,
+and one built with -mavx2 faults on a machine without it.
+
+recip_arith_dispatch.cpp compiles each kernel several times with per-function target attributes
+(GCC/clang __attribute__((target)) ; nothing else in the build needs -m flags) ,
+detects the CPU once (cpuid , and xgetbv for OS support of the ymm/zmm state)
+and hands out tables of function pointers , one per level :
+
+    RECIP_ARITH_KERNELS_SCALAR      baseline x86-64 (or whatever the build targets) , clz is BSR
+    RECIP_ARITH_KERNELS_LZCNT_BMI2  lzcnt for clz , shlx/shrx for the variable shifts
+    RECIP_ARITH_KERNELS_AVX2        + the 8-lane AVX2 decoder
+    RECIP_ARITH_KERNELS_AVX512      + the 16-lane AVX-512 (F,CD,BW) decoder
+
+each level includes the ones before it , and the block kernels are the same at every level above scalar.
+
+the vector decoders don't always win : gathers are slow on some cores , and the scalar lanes with
+lzcnt & BMI2 keep 8 or 16 independent states in flight too. On a Xeon with AVX-512
+(big.txt , cdf_bits 13 , default -O2 build , best of 3 runs , MB/s) :
+
+                    x8      x16
+    lzcnt+bmi2      336     346
+    avx2            195
+    avx512                  355
+
+so recip_arith_get_kernels times decode_x8 and decode_x16 of every level the CPU runs once ,
+on its first call (a 32k symbol stream , a few ms) , and takes the fastest of each ;
+its name says which level each came from.
+
+MSVC has no per-function target , so there the block kernels stay clz.h's compile time choice ,
+LZCNT_BMI2 is not compiled in and only the vector decoders are dispatched.
+off x86 there is only SCALAR.
+
+every level produces the same bitstream and the same decoded symbols :
+the streams are the recip_arith_unrolled.h block stream and the recip_arith_interleaved.h
+8 and 16 lane streams , whichever kernel wrote or reads them.
+test_recip_arith runs all the levels the CPU has against each other.
+
+the kernels have the argument & padding rules of the functions they wrap :
+    encode_block / decode_block : recip_arith_encode_block / recip_arith_decode_block
+    decode_x8 / decode_x16 : recip_arith_interleaved_decode with 8 / 16 lanes ,
+        decode_table needs RECIP_ARITH_SIMD_DECODE_TABLE_PADDING extra bytes
+encode_x8 / encode_x16 is recip_arith_interleaved_encode at any level.
+
+**/
+
+#define RECIP_ARITH_CPU_LZCNT       (1<<0)
+#define RECIP_ARITH_CPU_BMI2        (1<<1)
+#define RECIP_ARITH_CPU_AVX2        (1<<2)
+#define RECIP_ARITH_CPU_AVX512      (1<<3)  // F + CD + BW
+
+enum recip_arith_kernel_level
+{
+    RECIP_ARITH_KERNELS_SCALAR = 0,
+    RECIP_ARITH_KERNELS_LZCNT_BMI2,
+    RECIP_ARITH_KERNELS_AVX2,
+    RECIP_ARITH_KERNELS_AVX512,
+    RECIP_ARITH_KERNELS_COUNT
+};
+
+struct recip_arith_kernels
+{
+    const char * name;
+    uint32_t required_cpu;      // RECIP_ARITH_CPU_ bits
+
+    // returns the end of the stream , or NULL if cdf_bits is out of range
+    uint8_t * (*encode_block)(uint8_t * comp,const uint8_t * syms,size_t count,const uint32_t * cdf,uint32_t cdf_bits);
+    // returns false if cdf_bits is out of range
+    bool (*decode_block)(uint8_t * syms,size_t count,const uint8_t * comp,
+                        const uint32_t * cdf,const uint8_t * decode_table,uint32_t cdf_bits);
+
+    void (*decode_x8)(uint8_t * syms,size_t count,const uint8_t * ptr,
+                        const uint32_t * cdf,const uint8_t * decode_table,uint32_t cdf_bits);
+    void (*decode_x16)(uint8_t * syms,size_t count,const uint8_t * ptr,
+                        const uint32_t * cdf,const uint8_t * decode_table,uint32_t cdf_bits);
+};
+
+//=========================================================================================
+
+// RECIP_ARITH_CPU_ bits of the running CPU , detected on the first call
+uint32_t recip_arith_cpu_features();
+
+// the fastest kernels this CPU runs , timed on the first call (thread safe)
+//  recip_arith_table_init must be called before the first call
+const recip_arith_kernels * recip_arith_get_kernels();
+
+// the kernels for one level , or NULL if this CPU can't run them or they aren't compiled in
+const recip_arith_kernels * recip_arith_get_kernels_level(int level);
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_DISPATCH_H
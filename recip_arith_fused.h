@@ -0,0 +1,194 @@
+#pragma once
+/**
+recip_arith_fused.h
+fused decode table : symbol , cdf_low and freq in one load
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_FUSED_H
+#define RECIP_ARITH_FUSED_H
+
+#include "recip_arith.h"
+
+#include <stdlib.h>
+
+//=========================================================================================
+
+/**
+
+the decode loop in test_recip_arith does three dependent loads after peek :
+
+    sym = decode_table[target];  low = cdf[sym];  freq = cdf[sym+1] - low;
+
+recip_arith_fused_table packs what remove needs into the table entry , so it's one load :
+
+RECIP_ARITH_FUSED_SLOTS (cdf_bits <= 12) :
+    one u32 per cdf slot : [ freq-1 : 12 | cdf_low : 12 | sym : 8 ]
+    (1<<cdf_bits)+1 entries , 16k at cdf_bits = 12
+
+RECIP_ARITH_FUSED_BUCKETS (cdf_bits 13 - 16) :
+    a per-slot u32 can't hold two cdf_bits fields and a symbol , and per-slot u64 would be 512k at 16 bits ,
+    so the top 12 bits of target index a bucket table of u8 first symbols (4k) ,
+    and a u32 per symbol holds [ freq-1 : 16 | cdf_low : 16 ] (1k) ;
+    a short walk on the symbol entries finds the symbol , usually 0 or 1 steps.
+    that's the bucket load plus the symbol entry , vs. decode_table + 2 cdf loads.
+    the walk is a data-dependent branch , so this is not a win while the decode_table fits in L1 ;
+    it's for when it doesn't (cdf_bits 16 , or many tables live at once) , 5k vs (1<<cdf_bits) + 1k.
+
+symbols are bytes (num_syms <= 256) ; cdf[num_syms] must be (1<<cdf_bits)
+the decode_symbol functions expect a valid stream , like recip_arith_decoder_peek ;
+target == cdf total still stays in bounds (the padding slot / the sentinel symbol entry).
+for untrusted input see recip_arith_checked.h
+
+**/
+
+#define RECIP_ARITH_FUSED_SLOT_MAX_CDF_BITS     (12)
+#define RECIP_ARITH_FUSED_BUCKET_BITS           (12)
+#define RECIP_ARITH_FUSED_MAX_CDF_BITS          (16)
+
+enum recip_arith_fused_mode
+{
+    RECIP_ARITH_FUSED_SLOTS = 0,
+    RECIP_ARITH_FUSED_BUCKETS
+};
+
+struct recip_arith_fused_table
+{
+    int mode;
+    uint32_t cdf_bits;
+
+    uint32_t * slots;           // SLOTS : (1<<cdf_bits)+1 entries
+    uint8_t * buckets;          // BUCKETS : (1<<RECIP_ARITH_FUSED_BUCKET_BITS)+1 entries
+    uint32_t bucket_shift;
+    uint32_t * sym_entries;     // BUCKETS : num_syms+1 entries , the last a sentinel
+};
+
+static inline void recip_arith_fused_table_free(recip_arith_fused_table * ft)
+{
+    free(ft->slots);
+    free(ft->buckets);
+    free(ft->sym_entries);
+    ft->slots = NULL;
+    ft->buckets = NULL;
+    ft->sym_entries = NULL;
+}
+
+/**
+
+recip_arith_fused_table_init builds the table for cdf[num_syms+1] ; picks SLOTS or BUCKETS from cdf_bits
+returns false if cdf_bits > 16 , num_syms > 256 , or on allocation failure
+the cdf is not referenced after init
+
+**/
+static inline bool recip_arith_fused_table_init(recip_arith_fused_table * ft,const uint32_t * cdf,uint32_t num_syms,uint32_t cdf_bits)
+{
+    recip_arith_assert( num_syms >= 1 );
+    recip_arith_assert( cdf[0] == 0 && cdf[num_syms] == ((uint32_t)1<<cdf_bits) );
+
+    ft->cdf_bits = cdf_bits;
+    ft->slots = NULL;
+    ft->buckets = NULL;
+    ft->bucket_shift = 0;
+    ft->sym_entries = NULL;
+
+    if ( num_syms > 256 || cdf_bits > RECIP_ARITH_FUSED_MAX_CDF_BITS ) return false;
+
+    const uint32_t cdf_tot = (uint32_t)1<<cdf_bits;
+
+    if ( cdf_bits <= RECIP_ARITH_FUSED_SLOT_MAX_CDF_BITS )
+    {
+        ft->mode = RECIP_ARITH_FUSED_SLOTS;
+        ft->slots = (uint32_t *)malloc((cdf_tot+1)*sizeof(uint32_t));
+        if ( ft->slots == NULL ) return false;
+
+        for(uint32_t s=0;s<num_syms;s++)
+        {
+            uint32_t low = cdf[s];
+            uint32_t freq = cdf[s+1] - low;
+            if ( freq == 0 ) continue;
+            uint32_t entry = ((freq-1)<<20) | (low<<8) | s;
+            for(uint32_t c=low;c<low+freq;c++)
+                ft->slots[c] = entry;
+        }
+        // pad one extra slot at the end so that cdf target == cdf_tot is okay :
+        ft->slots[cdf_tot] = ft->slots[cdf_tot-1];
+        return true;
+    }
+
+    ft->mode = RECIP_ARITH_FUSED_BUCKETS;
+    ft->bucket_shift = cdf_bits - RECIP_ARITH_FUSED_BUCKET_BITS;
+
+    const uint32_t num_buckets = (uint32_t)1<<RECIP_ARITH_FUSED_BUCKET_BITS;
+    ft->buckets = (uint8_t *)malloc(num_buckets+1);
+    ft->sym_entries = (uint32_t *)malloc((num_syms+1)*sizeof(uint32_t));
+    if ( ft->buckets == NULL || ft->sym_entries == NULL )
+    {
+        recip_arith_fused_table_free(ft);
+        return false;
+    }
+
+    for(uint32_t s=0;s<num_syms;s++)
+    {
+        uint32_t low = cdf[s];
+        uint32_t freq = cdf[s+1] - low;
+        // zero-frequency symbols get entry 0 (low 0 , freq 1) so the walk always steps over them ;
+        //  the walk never starts at target 0 on one , bucket 0 holds the symbol containing 0
+        ft->sym_entries[s] = ( freq == 0 ) ? 0 : ( ((freq-1)<<16) | low );
+    }
+    // sentinel : low = 0xFFFF , freq = 0x10000 ; stops the walk for target == cdf_tot
+    ft->sym_entries[num_syms] = 0xFFFFFFFF;
+
+    // bucket b starts at target (b<<shift) ; store the symbol that contains it
+    uint32_t s = 0;
+    for(uint32_t b=0;b<num_buckets;b++)
+    {
+        uint32_t t = b << ft->bucket_shift;
+        while ( cdf[s+1] <= t ) s++;
+        ft->buckets[b] = (uint8_t) s;
+    }
+    ft->buckets[num_buckets] = ft->buckets[num_buckets-1];
+
+    return true;
+}
+
+//=========================================================================================
+// decode_symbol : peek + lookup + remove , returns the symbol
+
+static recip_arith_inline uint32_t recip_arith_decoder_decode_symbol_slots(recip_arith_decoder * ac,const recip_arith_fused_table * ft)
+{
+    uint32_t target = recip_arith_decoder_peek(ac,ft->cdf_bits);
+    uint32_t entry = ft->slots[target];
+    recip_arith_decoder_remove(ac,(entry>>8) & 0xFFF,(entry>>20) + 1);
+    return entry & 0xFF;
+}
+
+static recip_arith_inline uint32_t recip_arith_decoder_decode_symbol_buckets(recip_arith_decoder * ac,const recip_arith_fused_table * ft)
+{
+    uint32_t target = recip_arith_decoder_peek(ac,ft->cdf_bits);
+    uint32_t sym = ft->buckets[target >> ft->bucket_shift];
+    uint32_t entry = ft->sym_entries[sym];
+    // walk while target is past this symbol's interval ; low + freq > target once we're there
+    while ( (entry & 0xFFFF) + (entry>>16) < target )
+    {
+        entry = ft->sym_entries[++sym];
+    }
+    recip_arith_decoder_remove(ac,entry & 0xFFFF,(entry>>16) + 1);
+    return sym;
+}
+
+// generic ; the mode switch is perfectly predicted
+static recip_arith_inline uint32_t recip_arith_decoder_decode_symbol(recip_arith_decoder * ac,const recip_arith_fused_table * ft)
+{
+    if ( ft->mode == RECIP_ARITH_FUSED_SLOTS )
+        return recip_arith_decoder_decode_symbol_slots(ac,ft);
+    else
+        return recip_arith_decoder_decode_symbol_buckets(ac,ft);
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_FUSED_H
@@ -0,0 +1,203 @@
+#pragma once
+/**
+recip_arith_lj.h
+recip_arith with range kept left-justified , so r_top is a fixed shift
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_LJ_H
+#define RECIP_ARITH_LJ_H
+
+#include "recip_arith.h"
+
+//=========================================================================================
+
+/**
+
+recip_arith_encoder_put & recip_arith_decoder_peek start with clz32(range) to find r_top ,
+so the reciprocal table load waits on a clz (or a BSR on MSVC without CLZ_PROCESSOR_HAS_LZCNT ,
+and on GCC/clang without -mlzcnt).
+
+the lj coder keeps the same range as two parts :
+
+    range : always left-justified , top bit on
+    range_shift : the leading zeros of the true range ; true range = range >> range_shift
+
+so r_top is just (range >> (32 - RECIP_ARITH_TABLE_BITS)) , and the cdf scale shift is
+(32 - RECIP_ARITH_TABLE_BITS - range_shift - cdf_bits) , no clz on the way to the table.
+
+The clz moves to the end of put / remove , where the new range (freq * r_norm) is left-justified again ;
+that's one clz per symbol , off the peek -> table -> multiply path.
+The renorms don't need one at all : the number of bytes is range_shift >> 3 ,
+and the branchless decoder renorm is just shifts.
+
+measured in bench_recip_arith (big.txt , Xeon where BSR and LZCNT are both fast) , with and without -mlzcnt :
+within noise of recip_arith , often a few % slower ; the encoder still does one clz per symbol , it only moved.
+It pays where clz is slow or emulated , not on current x86.
+
+BITSTREAM : the true range , low and code are exactly those of recip_arith_encoder / recip_arith_decoder ,
+so the bitstream is the same ; either encoder can be decoded by either decoder.
+
+like the base coder , _put/_peek need (true range) >= (1<<cdf_bits) , range_shift <= 32 - RECIP_ARITH_TABLE_BITS - cdf_bits ;
+after a _renorm range_shift is 0-7.
+
+**/
+
+//=========================================================================================
+
+struct recip_arith_lj_encoder
+{
+    uint32_t low,range;     // range is left-justified
+    uint32_t range_shift;   // true range = range >> range_shift
+    uint8_t * ptr;
+};
+
+static recip_arith_inline void recip_arith_lj_encoder_start(recip_arith_lj_encoder * ac,uint8_t * ptr)
+{
+    ac->low = 0;
+    ac->range = ~(uint32_t)0;
+    ac->range_shift = 0;
+    ac->ptr = ptr;
+}
+
+static recip_arith_inline void recip_arith_lj_encoder_renorm(recip_arith_lj_encoder * ac)
+{
+    RECIP_ARITH_COUNT_RENORM(encoder,ac->range_shift >> 3);
+
+    // true range < (1<<24) is range_shift >= 8 ; range itself stays left-justified
+    while ( ac->range_shift >= 8 )
+    {
+        *(ac->ptr)++ = (uint8_t)(ac->low>>24);
+        ac->low <<= 8;
+        ac->range_shift -= 8;
+    }
+}
+
+static recip_arith_inline void recip_arith_lj_encoder_carry(recip_arith_lj_encoder * ac)
+{
+    // propagate carry into the previous streamed bytes :
+    uint8_t * p = ac->ptr;
+    do {
+        --p;
+        *p += 1;
+    } while( *p == 0 );
+
+    RECIP_ARITH_COUNT_CARRY(ac->ptr - p);
+}
+
+// encode a symbol with a given cdf range
+static recip_arith_inline void recip_arith_lj_encoder_put(recip_arith_lj_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits)
+{
+    recip_arith_assert( (cdf_low + cdf_freq) <= ((uint32_t)1<<cdf_bits) );
+    recip_arith_assert( cdf_freq > 0 );
+    recip_arith_assert( ac->range_shift + RECIP_ARITH_TABLE_BITS + cdf_bits <= 32 );
+    recip_arith_assert( ac->range >= ((uint32_t)1<<31) );
+
+    uint32_t r_top = ac->range >> (32 - RECIP_ARITH_TABLE_BITS);
+    uint32_t r_norm = r_top << (32 - RECIP_ARITH_TABLE_BITS - ac->range_shift - cdf_bits);
+
+    uint32_t save_low = ac->low;
+    ac->low += cdf_low * r_norm;
+
+    uint32_t range = cdf_freq * r_norm;
+    int range_clz = clz32(range);
+    ac->range = range << range_clz;
+    ac->range_shift = range_clz;
+
+    if ( ac->low < save_low ) recip_arith_lj_encoder_carry(ac);
+}
+
+// _finish returns the end pointer
+static recip_arith_inline uint8_t * recip_arith_lj_encoder_finish(recip_arith_lj_encoder * ac)
+{
+    // after _renorm this is exactly the state of a recip_arith_encoder :
+    recip_arith_assert( ac->range_shift < 8 );
+    recip_arith_encoder enc;
+    enc.low = ac->low;
+    enc.range = ac->range >> ac->range_shift;
+    enc.ptr = ac->ptr;
+    return recip_arith_encoder_finish(&enc);
+}
+
+//=========================================================================================
+
+struct recip_arith_lj_decoder
+{
+    uint32_t code,range;    // range is left-justified , except between _peek and _remove where it holds r_norm
+    uint32_t range_shift;
+    uint8_t const * ptr;
+};
+
+static recip_arith_inline void recip_arith_lj_decoder_start(recip_arith_lj_decoder * ac,uint8_t const * ptr)
+{
+    ac->range = ~(uint32_t)0;
+    ac->range_shift = 0;
+    ac->code = recip_arith_get_be32(ptr);
+    ac->ptr = ptr + 4;
+}
+
+static recip_arith_inline void recip_arith_lj_decoder_renorm(recip_arith_lj_decoder * ac)
+{
+    RECIP_ARITH_COUNT_RENORM(decoder,ac->range_shift >> 3);
+
+    while ( ac->range_shift >= 8 )
+    {
+        ac->code <<= 8;
+        ac->code |= *(ac->ptr)++;
+        ac->range_shift -= 8;
+    }
+}
+
+// like recip_arith_decoder_renorm_branchless , but the byte count is range_shift , no clz
+//  needs RECIP_ARITH_DECODER_TAIL_PADDING readable bytes after the end of the stream
+static recip_arith_inline void recip_arith_lj_decoder_renorm_branchless(recip_arith_lj_decoder * ac)
+{
+    recip_arith_assert( ac->range_shift < 32 );
+    uint32_t nbytes = ac->range_shift >> 3;
+    uint32_t shift = nbytes*8;
+    RECIP_ARITH_COUNT_RENORM(decoder,nbytes);
+
+    uint64_t code_and_next = ((uint64_t)ac->code << 32) | recip_arith_get_be32(ac->ptr);
+    ac->code = (uint32_t)((code_and_next << shift) >> 32);
+    ac->range_shift -= shift;
+    ac->ptr += nbytes;
+}
+
+// peek finds the target cdf currently specified (mutates decoder)
+static recip_arith_inline uint32_t recip_arith_lj_decoder_peek(recip_arith_lj_decoder * ac,uint32_t cdf_bits)
+{
+    recip_arith_assert( ac->range_shift + RECIP_ARITH_TABLE_BITS + cdf_bits <= 32 );
+    recip_arith_assert( recip_arith_table[(1<<RECIP_ARITH_TABLE_BITS)-1] != 0 ); // call recip_arith_table_init
+
+    uint32_t r_top = ac->range >> (32 - RECIP_ARITH_TABLE_BITS);
+    uint32_t shift = 32 - RECIP_ARITH_TABLE_BITS - ac->range_shift - cdf_bits;
+
+    // save r_norm for the "remove" step later :
+    ac->range = r_top << shift;
+
+    uint32_t code_necessary_bits = ac->code >> shift;
+    uint32_t target = (uint32_t)( ( code_necessary_bits * (uint64_t)recip_arith_table[r_top] ) >> RECIP_ARITH_NUMERATOR_BITS );
+
+    recip_arith_assert( target <= ((uint32_t)1<<cdf_bits) );
+    return target;
+}
+
+// remove the symbol found by the previous call to peek
+static recip_arith_inline void recip_arith_lj_decoder_remove(recip_arith_lj_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq)
+{
+    uint32_t r_norm = ac->range;
+    ac->code -= cdf_low * r_norm;
+
+    uint32_t range = cdf_freq * r_norm;
+    int range_clz = clz32(range);
+    ac->range = range << range_clz;
+    ac->range_shift = range_clz;
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_LJ_H
@@ -0,0 +1,278 @@
+#pragma once
+/**
+recip_arith_loss.h
+expected coding loss of the recip_arith map , and a table_bits / cdf_bits tuner
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_LOSS_H
+#define RECIP_ARITH_LOSS_H
+
+#include "recip_arith.h"
+#include "recip_arith_static_model.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//=========================================================================================
+
+/**
+
+where the loss comes from :
+
+range = v * 2^k , with v in [2^(b-1),2^b) ; r_top is the top table_bits of v
+the ideal map gives a symbol range * f / 2^cdf_bits
+recip_arith gives it f * (r_top << (b - table_bits - cdf_bits))
+
+so every symbol loses  log2( v / (r_top << (b - table_bits)) )  bits , whatever the symbol ;
+the loss only depends on the bits of range below r_top.
+
+after coding a symbol of freq f from r_top , the new range is exactly f * r_top times a power of two
+(renorm shifts by whole bytes) , so the next v is f * r_top , and the next r_top is its top table_bits.
+
+That makes r_top a Markov chain on [2^(table_bits-1),2^table_bits) , stepping with the symbol
+probabilities , and the expected loss per symbol is exact for symbols drawn independently from them :
+
+    map loss = sum over r_top of  pi(r_top) * sum over symbols of  p(s) * loss( f(s) * r_top )
+
+pi is found by power iteration from the r_top of the starting range (0xFFFFFFFF) , damped so
+periodic chains converge.  Real data isn't i.i.d. , so that's an estimate of what it will actually see.
+
+The other loss is normalizing the histogram to cdf_bits : the KL divergence from the counts to freqs / 2^cdf_bits.
+
+**/
+
+// bits lost to normalizing counts to freqs (which sum to 1<<cdf_bits) , per symbol
+static inline double recip_arith_normalization_loss(const uint32_t * counts,const uint32_t * freqs,int num_syms,uint32_t cdf_bits)
+{
+    double total = 0;
+    for(int s=0;s<num_syms;s++) total += counts[s];
+    if ( total <= 0 ) return 0.0;
+
+    double loss = 0;
+    for(int s=0;s<num_syms;s++)
+    {
+        if ( counts[s] == 0 ) continue;
+        double p = counts[s] / total;
+        double q = freqs[s] / (double)((uint32_t)1<<cdf_bits);
+        loss += p * log2(p / q);
+    }
+    return loss;
+}
+
+// loss of one symbol coded from a range whose mantissa is v (any v >= 1<<(table_bits-1))
+static inline double recip_arith_map_step_loss(uint32_t v,int table_bits,uint32_t * p_next_r_top)
+{
+    int v_bits = 32 - clz32(v);
+    int shift = v_bits - table_bits;
+    uint32_t r_top = v >> shift;
+    *p_next_r_top = r_top;
+    return log2( (double)v / (double)r_top ) - shift;
+}
+
+#define RECIP_ARITH_LOSS_MAX_ITERATIONS     (4096)
+#define RECIP_ARITH_LOSS_TOLERANCE          (1e-12)
+
+/**
+
+recip_arith_map_loss : expected bits per symbol lost by the recip_arith map at table_bits ,
+for symbols with probabilities counts[] coded with freqs[] that sum to 1<<cdf_bits
+
+needs cdf_bits + table_bits <= 32 ; cost is about (2^table_bits * distinct freqs) per iteration
+
+**/
+static inline double recip_arith_map_loss(const uint32_t * counts,const uint32_t * freqs,int num_syms,uint32_t cdf_bits,int table_bits)
+{
+    recip_arith_assert( table_bits >= 2 && cdf_bits + table_bits <= 32 );
+    (void)cdf_bits;
+
+    // symbols with the same freq step the chain the same way , merge them :
+    int num_groups = 0;
+    uint32_t * group_freq = (uint32_t *) malloc(num_syms*sizeof(uint32_t));
+    double * group_p = (double *) malloc(num_syms*sizeof(double));
+
+    double total = 0;
+    for(int s=0;s<num_syms;s++) total += counts[s];
+
+    for(int s=0;s<num_syms;s++)
+    {
+        if ( counts[s] == 0 ) continue;
+        recip_arith_assert( freqs[s] > 0 );
+        int g = 0;
+        while ( g < num_groups && group_freq[g] != freqs[s] ) g++;
+        if ( g == num_groups ) { group_freq[g] = freqs[s]; group_p[g] = 0; num_groups++; }
+        group_p[g] += counts[s] / total;
+    }
+
+    const uint32_t r_lo = (uint32_t)1<<(table_bits-1);
+    const uint32_t num_states = r_lo;
+
+    double * pi = (double *) calloc(num_states,sizeof(double));
+    double * next = (double *) malloc(num_states*sizeof(double));
+    double * state_loss = (double *) malloc(num_states*sizeof(double));
+
+    // state transitions are recomputed each iteration rather than stored ,
+    //  (2^table_bits * groups) of them would be big at high table_bits
+    for(uint32_t r=0;r<num_states;r++)
+    {
+        double loss = 0;
+        uint32_t r_next;
+        for(int g=0;g<num_groups;g++)
+            loss += group_p[g] * recip_arith_map_step_loss(group_freq[g] * (r_lo + r),table_bits,&r_next);
+        state_loss[r] = loss;
+    }
+
+    // start from the initial range , ~0 :
+    pi[num_states-1] = 1.0;
+
+    for(int iter=0;iter<RECIP_ARITH_LOSS_MAX_ITERATIONS && num_groups>0;iter++)
+    {
+        // damped step , pi = (pi + pi*P)/2 , has the same fixed point and converges on periodic chains
+        for(uint32_t r=0;r<num_states;r++) next[r] = 0.5 * pi[r];
+
+        for(uint32_t r=0;r<num_states;r++)
+        {
+            double w = 0.5 * pi[r];
+            if ( w == 0 ) continue;
+            for(int g=0;g<num_groups;g++)
+            {
+                uint32_t r_next;
+                recip_arith_map_step_loss(group_freq[g] * (r_lo + r),table_bits,&r_next);
+                next[r_next - r_lo] += w * group_p[g];
+            }
+        }
+
+        double delta = 0;
+        for(uint32_t r=0;r<num_states;r++) delta += fabs(next[r] - pi[r]);
+
+        double * t = pi; pi = next; next = t;
+
+        if ( delta < RECIP_ARITH_LOSS_TOLERANCE ) break;
+    }
+
+    double loss = 0;
+    for(uint32_t r=0;r<num_states;r++) loss += pi[r] * state_loss[r];
+
+    free(group_freq);
+    free(group_p);
+    free(pi);
+    free(next);
+    free(state_loss);
+
+    return loss;
+}
+
+//=========================================================================================
+
+/**
+
+recip_arith_tune : the cheapest table_bits & cdf_bits whose expected loss stays under target_loss
+
+loss is map loss + normalization loss , in bits per symbol , relative to the order-0 entropy of counts
+cost is the L1 footprint of decoding :
+    the used half of the reciprocal table , 4 << (table_bits-1) bytes
+    a byte decode_table of 1<<cdf_bits entries
+(the cdf is the same size for every config , so it's left out)
+
+only configs that recip_arith_coder_t<table_bits,numerator_bits,cdf_bits> accepts are tried :
+    cdf_bits + table_bits - 1 <= 24 (32-bit coder range)
+    cdf_bits + 2*table_bits <= numerator_bits <= table_bits + 30 (exact u32 reciprocals)
+so cdf_bits <= 25 - table_bits ; numerator_bits = max(32, cdf_bits + 2*table_bits)
+
+returns false if nothing in [min,max] table_bits and [min,max] cdf_bits meets the target ;
+  *result is then the lowest loss config found , or all zero if no config was valid
+
+**/
+
+struct recip_arith_tune_result
+{
+    int table_bits;
+    uint32_t cdf_bits;
+    int numerator_bits;
+    double map_loss;            // bits per symbol
+    double normalization_loss;  // bits per symbol
+    uint32_t footprint;         // bytes
+};
+
+static inline uint32_t recip_arith_tune_footprint(int table_bits,uint32_t cdf_bits)
+{
+    return ((uint32_t)4<<(table_bits-1)) + ((uint32_t)1<<cdf_bits);
+}
+
+static inline int recip_arith_tune_numerator_bits(int table_bits,uint32_t cdf_bits)
+{
+    int n = (int)cdf_bits + 2*table_bits;
+    return ( n > 32 ) ? n : 32;
+}
+
+static inline bool recip_arith_tune_valid(int table_bits,uint32_t cdf_bits)
+{
+    return table_bits >= 2 && table_bits <= 16 && cdf_bits >= 1 && (int)cdf_bits + table_bits <= 25;
+}
+
+// evaluate one config ; false if the counts can't be normalized to cdf_bits
+static inline bool recip_arith_tune_evaluate(recip_arith_tune_result * result,const uint32_t * counts,int num_syms,
+                                            int table_bits,uint32_t cdf_bits)
+{
+    uint32_t * freqs = (uint32_t *) malloc(num_syms*sizeof(uint32_t));
+    bool ok = recip_arith_normalize_counts(freqs,counts,num_syms,cdf_bits);
+    if ( ok )
+    {
+        result->table_bits = table_bits;
+        result->cdf_bits = cdf_bits;
+        result->numerator_bits = recip_arith_tune_numerator_bits(table_bits,cdf_bits);
+        result->normalization_loss = recip_arith_normalization_loss(counts,freqs,num_syms,cdf_bits);
+        result->map_loss = recip_arith_map_loss(counts,freqs,num_syms,cdf_bits,table_bits);
+        result->footprint = recip_arith_tune_footprint(table_bits,cdf_bits);
+    }
+    free(freqs);
+    return ok;
+}
+
+static inline bool recip_arith_tune(recip_arith_tune_result * result,const uint32_t * counts,int num_syms,double target_loss,
+                                    int min_table_bits,int max_table_bits,uint32_t min_cdf_bits,uint32_t max_cdf_bits)
+{
+    bool found = false;
+    bool have_any = false;
+    recip_arith_tune_result best_loss = { };
+    *result = best_loss;
+
+    for(int tb=min_table_bits;tb<=max_table_bits;tb++)
+    {
+        for(uint32_t cb=min_cdf_bits;cb<=max_cdf_bits;cb++)
+        {
+            if ( ! recip_arith_tune_valid(tb,cb) ) continue;
+
+            // can't beat what we have on cost , don't bother computing it :
+            uint32_t footprint = recip_arith_tune_footprint(tb,cb);
+            if ( found && footprint >= result->footprint ) continue;
+
+            recip_arith_tune_result r;
+            if ( ! recip_arith_tune_evaluate(&r,counts,num_syms,tb,cb) ) continue;
+
+            double loss = r.map_loss + r.normalization_loss;
+            if ( ! have_any || loss < best_loss.map_loss + best_loss.normalization_loss )
+            {
+                best_loss = r;
+                have_any = true;
+            }
+            if ( loss <= target_loss )
+            {
+                *result = r;
+                found = true;
+            }
+        }
+    }
+
+    if ( ! found && have_any ) *result = best_loss;
+    return found;
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_LOSS_H
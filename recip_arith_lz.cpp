@@ -0,0 +1,586 @@
+/**
+recip_arith_lz.cpp
+LZ77 codec with recip_arith as the entropy backend
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+
+#include "recip_arith_lz.h"
+#include "recip_arith_model_send.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+//=========================================================================================
+
+// the encoder checks for expansion every CHECK_INTERVAL tokens , and after the models ;
+//  a token puts at most 4 symbols of 3 bytes , the models well under 4k , _finish at most 2
+#define RECIP_ARITH_LZ_CHECK_INTERVAL       (256)
+#define RECIP_ARITH_LZ_SLACK                (4096 + 12*RECIP_ARITH_LZ_CHECK_INTERVAL + 8)
+
+// a token is at most 4 symbols (length , length extra , offset , offset extra) for the decoder's safe count
+#define RECIP_ARITH_LZ_MAX_BYTES_PER_TOKEN  (4*RECIP_ARITH_DECODER_MAX_BYTES_PER_SYMBOL)
+
+#define RECIP_ARITH_LZ_HASH_BITS            (17)
+
+// a MIN_MATCH match further back than this costs more than its literals
+#define RECIP_ARITH_LZ_FAR_OFFSET           (1<<14)
+
+// matches at least this long are taken without looking one byte ahead
+#define RECIP_ARITH_LZ_LAZY_CUTOFF          (32)
+
+enum
+{
+    RECIP_ARITH_LZ_LITERALS = 0,
+    RECIP_ARITH_LZ_LENGTHS,
+    RECIP_ARITH_LZ_OFFSETS,
+    RECIP_ARITH_LZ_NUM_ALPHABETS
+};
+
+static const uint32_t c_recip_arith_lz_num_syms[RECIP_ARITH_LZ_NUM_ALPHABETS] =
+    { 256, RECIP_ARITH_LZ_NUM_LENGTH_SYMS, RECIP_ARITH_LZ_NUM_OFFSET_SYMS };
+
+// v < 4 is its own slot , above that the top two bits pick the slot and the rest are extra bits
+static recip_arith_inline uint32_t recip_arith_lz_slot(uint32_t v,uint32_t * p_nextra)
+{
+    if ( v < 4 )
+    {
+        *p_nextra = 0;
+        return v;
+    }
+    uint32_t nb = 32 - clz32(v);
+    *p_nextra = nb - 2;
+    return 2*nb - 2 + ((v >> (nb-2)) & 1);
+}
+
+// the first v of a slot
+static recip_arith_inline uint32_t recip_arith_lz_slot_base(uint32_t slot,uint32_t * p_nextra)
+{
+    if ( slot < 4 )
+    {
+        *p_nextra = 0;
+        return slot;
+    }
+    uint32_t nextra = (slot>>1) - 1;
+    *p_nextra = nextra;
+    return (2 | (slot&1)) << nextra;
+}
+
+// the adaptive models for the alphabet headers :
+struct recip_arith_lz_header_models
+{
+    recip_arith_nibble_model cdf_bits;
+    recip_arith_nibble_model freq_len;
+};
+
+static void recip_arith_lz_header_models_init(recip_arith_lz_header_models * m)
+{
+    recip_arith_nibble_model_init(&m->cdf_bits);
+    recip_arith_nibble_model_init(&m->freq_len);
+}
+
+//=========================================================================================
+// match finder
+
+struct recip_arith_lz_token
+{
+    uint32_t len;       // 0 for a literal
+    uint32_t value;     // the literal byte , or the match offset
+};
+
+struct recip_arith_lz_matcher
+{
+    const uint8_t * raw;
+    uint32_t raw_len;
+    uint32_t max_chain;
+    uint32_t chain_mask;
+    std::vector<uint32_t> head;     // pos+1 of the last position with each hash , 0 for none
+    std::vector<uint32_t> chain;    // pos+1 of the previous position with the same hash , by pos & chain_mask
+};
+
+static recip_arith_inline uint32_t recip_arith_lz_hash(const uint8_t * ptr)
+{
+    uint32_t v;
+    memcpy(&v,ptr,4);
+    return (v * 2654435761u) >> (32 - RECIP_ARITH_LZ_HASH_BITS);
+}
+
+static void recip_arith_lz_matcher_init(recip_arith_lz_matcher * m,const uint8_t * raw,uint32_t raw_len,uint32_t max_chain)
+{
+    m->raw = raw;
+    m->raw_len = raw_len;
+    m->max_chain = max_chain;
+
+    // the chain only needs to cover the window , or the whole input if that's smaller :
+    uint32_t chain_size = 1;
+    while ( chain_size < raw_len && chain_size < RECIP_ARITH_LZ_MAX_OFFSET ) chain_size <<= 1;
+    m->chain_mask = chain_size - 1;
+
+    m->head.assign((size_t)1<<RECIP_ARITH_LZ_HASH_BITS,0);
+    m->chain.assign(chain_size,0);
+}
+
+static recip_arith_inline void recip_arith_lz_matcher_insert(recip_arith_lz_matcher * m,uint32_t pos)
+{
+    if ( pos + RECIP_ARITH_LZ_MIN_MATCH > m->raw_len ) return;
+    uint32_t h = recip_arith_lz_hash(m->raw + pos);
+    m->chain[pos & m->chain_mask] = m->head[h];
+    m->head[h] = pos + 1;
+}
+
+static recip_arith_inline uint32_t recip_arith_lz_match_length(const uint8_t * a,const uint8_t * b,uint32_t max_len)
+{
+    uint32_t len = 0;
+    while ( len + 8 <= max_len )
+    {
+        uint64_t x,y;
+        memcpy(&x,a+len,8);
+        memcpy(&y,b+len,8);
+        if ( x != y ) break;
+        len += 8;
+    }
+    while ( len < max_len && a[len] == b[len] ) len++;
+    return len;
+}
+
+// longest match at pos among the previous positions on its hash chain ; 0 if none is worth sending
+static uint32_t recip_arith_lz_find_match(const recip_arith_lz_matcher * m,uint32_t pos,uint32_t * p_offset)
+{
+    uint32_t max_len = m->raw_len - pos;
+    if ( max_len > RECIP_ARITH_LZ_MAX_MATCH ) max_len = RECIP_ARITH_LZ_MAX_MATCH;
+    if ( max_len < RECIP_ARITH_LZ_MIN_MATCH ) return 0;
+
+    const uint8_t * cur = m->raw + pos;
+    uint32_t best_len = RECIP_ARITH_LZ_MIN_MATCH - 1;
+    uint32_t best_offset = 0;
+
+    uint32_t next = m->head[ recip_arith_lz_hash(cur) ];
+    for(uint32_t steps=m->max_chain;next != 0 && steps != 0;steps--)
+    {
+        uint32_t cand = next - 1;
+        uint32_t offset = pos - cand;
+        if ( offset > RECIP_ARITH_LZ_MAX_OFFSET ) break;
+        next = m->chain[cand & m->chain_mask];
+
+        // can't beat best_len unless it matches at best_len :
+        const uint8_t * prev = m->raw + cand;
+        if ( prev[best_len] != cur[best_len] ) continue;
+
+        uint32_t len = recip_arith_lz_match_length(prev,cur,max_len);
+        if ( len <= best_len ) continue;
+        if ( len == RECIP_ARITH_LZ_MIN_MATCH && offset > RECIP_ARITH_LZ_FAR_OFFSET ) continue;
+
+        best_len = len;
+        best_offset = offset;
+        if ( len == max_len ) break;
+    }
+
+    if ( best_offset == 0 ) return 0;
+    *p_offset = best_offset;
+    return best_len;
+}
+
+// greedy with one step of lazy matching
+static void recip_arith_lz_parse(std::vector<recip_arith_lz_token> * tokens,const uint8_t * raw,uint32_t raw_len,uint32_t max_chain)
+{
+    recip_arith_lz_matcher m;
+    recip_arith_lz_matcher_init(&m,raw,raw_len,max_chain);
+
+    for(uint32_t pos=0;pos<raw_len;)
+    {
+        uint32_t offset = 0;
+        uint32_t len = recip_arith_lz_find_match(&m,pos,&offset);
+        recip_arith_lz_matcher_insert(&m,pos);
+
+        // a longer match at pos+1 is worth a literal :
+        while ( len != 0 && len < RECIP_ARITH_LZ_LAZY_CUTOFF )
+        {
+            uint32_t next_offset = 0;
+            uint32_t next_len = recip_arith_lz_find_match(&m,pos+1,&next_offset);
+            if ( next_len <= len ) break;
+
+            recip_arith_lz_token lit = { 0, raw[pos] };
+            tokens->push_back(lit);
+            pos++;
+            recip_arith_lz_matcher_insert(&m,pos);
+            len = next_len;
+            offset = next_offset;
+        }
+
+        if ( len == 0 )
+        {
+            recip_arith_lz_token lit = { 0, raw[pos] };
+            tokens->push_back(lit);
+            pos++;
+            continue;
+        }
+
+        recip_arith_lz_token match = { len, offset };
+        tokens->push_back(match);
+        for(uint32_t i=1;i<len;i++)
+            recip_arith_lz_matcher_insert(&m,pos+i);
+        pos += len;
+    }
+}
+
+//=========================================================================================
+// encoder
+
+uint64_t recip_arith_lz_compress_bound(uint64_t raw_len)
+{
+    return RECIP_ARITH_LZ_HEADER_SIZE + raw_len + RECIP_ARITH_LZ_SLACK;
+}
+
+// the CODED payload after the mode byte ; 0 if it doesn't beat raw_len
+static uint64_t recip_arith_lz_encode(uint8_t * comp,const uint8_t * raw,uint32_t raw_len,
+                                    uint32_t max_cdf_bits,uint32_t max_chain,recip_arith_lz_stats * stats)
+{
+    std::vector<recip_arith_lz_token> tokens;
+    recip_arith_lz_parse(&tokens,raw,raw_len,max_chain);
+
+    recip_arith_lz_stats st = { };
+
+    uint32_t counts[RECIP_ARITH_LZ_NUM_ALPHABETS][256] = { };
+    for(size_t i=0;i<tokens.size();i++)
+    {
+        const recip_arith_lz_token & t = tokens[i];
+        uint32_t nextra;
+        if ( t.len == 0 )
+        {
+            counts[RECIP_ARITH_LZ_LENGTHS][0] += 1;
+            counts[RECIP_ARITH_LZ_LITERALS][t.value] += 1;
+            st.num_literals++;
+            continue;
+        }
+        counts[RECIP_ARITH_LZ_LENGTHS][1 + recip_arith_lz_slot(t.len - RECIP_ARITH_LZ_MIN_MATCH,&nextra)] += 1;
+        st.extra_bits += nextra;
+        counts[RECIP_ARITH_LZ_OFFSETS][recip_arith_lz_slot(t.value - 1,&nextra)] += 1;
+        st.extra_bits += nextra;
+        st.num_matches++;
+        st.match_bytes += t.len;
+    }
+
+    // cdf[sym] , cdf[sym+1] per alphabet :
+    uint32_t cdf_bits[RECIP_ARITH_LZ_NUM_ALPHABETS];
+    uint32_t cdf[RECIP_ARITH_LZ_NUM_ALPHABETS][257];
+    uint32_t freqs[RECIP_ARITH_LZ_NUM_ALPHABETS][256];
+    for(int a=0;a<RECIP_ARITH_LZ_NUM_ALPHABETS;a++)
+    {
+        uint32_t num_syms = c_recip_arith_lz_num_syms[a];
+        cdf_bits[a] = recip_arith_choose_cdf_bits(freqs[a],counts[a],num_syms,max_cdf_bits);
+        cdf[a][0] = 0;
+        for(uint32_t s=0;s<num_syms;s++)
+            cdf[a][s+1] = cdf[a][s] + ( cdf_bits[a] ? freqs[a][s] : 0 );
+    }
+    // every stream starts with a literal :
+    if ( cdf_bits[RECIP_ARITH_LZ_LITERALS] == 0 || cdf_bits[RECIP_ARITH_LZ_LENGTHS] == 0 ) return 0;
+
+    st.literal_cdf_bits = cdf_bits[RECIP_ARITH_LZ_LITERALS];
+    st.length_cdf_bits = cdf_bits[RECIP_ARITH_LZ_LENGTHS];
+    st.offset_cdf_bits = cdf_bits[RECIP_ARITH_LZ_OFFSETS];
+
+    uint8_t * limit = comp + raw_len;
+
+    recip_arith_encoder enc;
+    recip_arith_encoder_start(&enc,comp);
+
+    recip_arith_lz_header_models models;
+    recip_arith_lz_header_models_init(&models);
+
+    for(int a=0;a<RECIP_ARITH_LZ_NUM_ALPHABETS;a++)
+    {
+        recip_arith_encoder_put_nibble(&enc,&models.cdf_bits,(int)cdf_bits[a]);
+        if ( cdf_bits[a] == 0 ) continue;
+        // the last freq is implied :
+        for(uint32_t s=0;s+1<c_recip_arith_lz_num_syms[a];s++)
+            recip_arith_encoder_put_number(&enc,&models.freq_len,freqs[a][s]);
+    }
+    if ( enc.ptr >= limit ) return 0;
+
+    const uint32_t * lit_cdf = cdf[RECIP_ARITH_LZ_LITERALS];
+    const uint32_t * len_cdf = cdf[RECIP_ARITH_LZ_LENGTHS];
+    const uint32_t * off_cdf = cdf[RECIP_ARITH_LZ_OFFSETS];
+    const uint32_t lit_cdf_bits = cdf_bits[RECIP_ARITH_LZ_LITERALS];
+    const uint32_t len_cdf_bits = cdf_bits[RECIP_ARITH_LZ_LENGTHS];
+    const uint32_t off_cdf_bits = cdf_bits[RECIP_ARITH_LZ_OFFSETS];
+
+    for(size_t i=0;i<tokens.size();)
+    {
+        size_t chunk_end = i + RECIP_ARITH_LZ_CHECK_INTERVAL;
+        if ( chunk_end > tokens.size() ) chunk_end = tokens.size();
+
+        for(;i<chunk_end;i++)
+        {
+            const recip_arith_lz_token & t = tokens[i];
+            if ( t.len == 0 )
+            {
+                recip_arith_encoder_put(&enc,len_cdf[0],len_cdf[1] - len_cdf[0],len_cdf_bits);
+                recip_arith_encoder_renorm(&enc);
+                recip_arith_encoder_put(&enc,lit_cdf[t.value],lit_cdf[t.value+1] - lit_cdf[t.value],lit_cdf_bits);
+                recip_arith_encoder_renorm(&enc);
+                continue;
+            }
+
+            uint32_t v = t.len - RECIP_ARITH_LZ_MIN_MATCH;
+            uint32_t nextra;
+            uint32_t sym = 1 + recip_arith_lz_slot(v,&nextra);
+            recip_arith_encoder_put(&enc,len_cdf[sym],len_cdf[sym+1] - len_cdf[sym],len_cdf_bits);
+            recip_arith_encoder_renorm(&enc);
+            if ( nextra )
+            {
+                recip_arith_encoder_put_bits(&enc,v & ((1u<<nextra)-1),nextra);
+                recip_arith_encoder_renorm(&enc);
+            }
+
+            v = t.value - 1;
+            sym = recip_arith_lz_slot(v,&nextra);
+            recip_arith_encoder_put(&enc,off_cdf[sym],off_cdf[sym+1] - off_cdf[sym],off_cdf_bits);
+            recip_arith_encoder_renorm(&enc);
+            if ( nextra )
+            {
+                recip_arith_encoder_put_bits(&enc,v & ((1u<<nextra)-1),nextra);
+                recip_arith_encoder_renorm(&enc);
+            }
+        }
+
+        if ( enc.ptr >= limit ) return 0;
+    }
+
+    uint8_t * end = recip_arith_encoder_finish(&enc);
+    if ( end >= limit ) return 0;
+
+    if ( stats ) *stats = st;
+    return (uint64_t)(end - comp);
+}
+
+uint64_t recip_arith_lz_compress(uint8_t * comp,uint64_t comp_capacity,const uint8_t * raw,uint64_t raw_len,
+                                uint32_t max_cdf_bits,uint32_t max_chain,recip_arith_lz_stats * stats)
+{
+    if ( max_cdf_bits < 1 || max_cdf_bits > RECIP_ARITH_LZ_MAX_CDF_BITS ) return 0;
+    if ( max_chain < 1 ) return 0;
+    if ( raw_len >= ((uint64_t)1<<32) ) return 0;
+    if ( comp_capacity < recip_arith_lz_compress_bound(raw_len) ) return 0;
+
+    if ( stats ) memset(stats,0,sizeof(*stats));
+
+    recip_arith_put_be32(comp,RECIP_ARITH_LZ_MAGIC);
+    recip_arith_put_be64(comp+4,raw_len);
+    uint8_t * mode = comp + 12;
+
+    uint64_t payload_len = 0;
+    if ( raw_len > 0 )
+        payload_len = recip_arith_lz_encode(mode+1,raw,(uint32_t)raw_len,max_cdf_bits,max_chain,stats);
+
+    if ( payload_len != 0 )
+    {
+        *mode = RECIP_ARITH_LZ_MODE_CODED;
+    }
+    else
+    {
+        *mode = RECIP_ARITH_LZ_MODE_RAW;
+        memcpy(mode+1,raw,(size_t)raw_len);
+        payload_len = raw_len;
+    }
+
+    return RECIP_ARITH_LZ_HEADER_SIZE + payload_len;
+}
+
+//=========================================================================================
+// decoder
+
+struct recip_arith_lz_decode_model
+{
+    uint32_t cdf_bits;          // 0 if the alphabet is unused
+    uint32_t cdf[257];
+    const uint8_t * decode;     // target -> symbol , (1<<cdf_bits) entries
+};
+
+// t_checked selects the bounds-checked renorm for the tail , else the plain one
+template <bool t_checked>
+static recip_arith_inline void recip_arith_lz_renorm(recip_arith_checked_decoder * ac)
+{
+    if ( t_checked )
+        recip_arith_checked_decoder_renorm(ac);
+    else
+        recip_arith_decoder_renorm(&ac->dec);
+}
+
+template <bool t_checked>
+static recip_arith_inline uint32_t recip_arith_lz_get_bits(recip_arith_checked_decoder * ac,uint32_t nbits)
+{
+    if ( t_checked )
+        return recip_arith_checked_decoder_get_bits(ac,nbits);
+
+    // same code < range check as the checked version , with the plain renorm
+    if ( ac->dec.code >= ac->dec.range )
+    {
+        ac->corrupt = 1;
+        return 0;
+    }
+    uint32_t v = recip_arith_decoder_get_bits(&ac->dec,nbits);
+    recip_arith_decoder_renorm(&ac->dec);
+    return v;
+}
+
+template <bool t_checked>
+static recip_arith_inline uint32_t recip_arith_lz_get_symbol(recip_arith_checked_decoder * ac,const recip_arith_lz_decode_model * m)
+{
+    uint32_t target = recip_arith_decoder_peek_masked(&ac->dec,m->cdf_bits,&ac->corrupt);
+    uint32_t sym = m->decode[target];
+    uint32_t low = m->cdf[sym];
+    recip_arith_decoder_remove(&ac->dec,low,m->cdf[sym+1] - low);
+    recip_arith_lz_renorm<t_checked>(ac);
+    return sym;
+}
+
+// decode up to max_tokens tokens into raw from pos ; returns the new pos
+//  stops early on a bad match , or (checked) when the stream is overread
+template <bool t_checked>
+static recip_arith_inline uint32_t recip_arith_lz_decode_tokens(recip_arith_checked_decoder * ac,const recip_arith_lz_decode_model * models,
+                                            uint8_t * raw,uint32_t pos,uint32_t raw_len,size_t max_tokens)
+{
+    const recip_arith_lz_decode_model * lits = &models[RECIP_ARITH_LZ_LITERALS];
+    const recip_arith_lz_decode_model * lens = &models[RECIP_ARITH_LZ_LENGTHS];
+    const recip_arith_lz_decode_model * offs = &models[RECIP_ARITH_LZ_OFFSETS];
+
+    for(;max_tokens != 0 && pos < raw_len;max_tokens--)
+    {
+        uint32_t len_sym = recip_arith_lz_get_symbol<t_checked>(ac,lens);
+        if ( len_sym == 0 )
+        {
+            raw[pos++] = (uint8_t) recip_arith_lz_get_symbol<t_checked>(ac,lits);
+        }
+        else
+        {
+            uint32_t nextra;
+            uint32_t len = recip_arith_lz_slot_base(len_sym-1,&nextra);
+            if ( nextra ) len += recip_arith_lz_get_bits<t_checked>(ac,nextra);
+            len += RECIP_ARITH_LZ_MIN_MATCH;
+
+            // a match needs the offset alphabet :
+            if ( offs->cdf_bits == 0 )
+            {
+                ac->corrupt = 1;
+                break;
+            }
+            uint32_t off_sym = recip_arith_lz_get_symbol<t_checked>(ac,offs);
+            uint32_t offset = recip_arith_lz_slot_base(off_sym,&nextra);
+            if ( nextra ) offset += recip_arith_lz_get_bits<t_checked>(ac,nextra);
+            offset += 1;
+
+            if ( offset > pos || len > raw_len - pos )
+            {
+                ac->corrupt = 1;
+                break;
+            }
+
+            uint8_t * dst = raw + pos;
+            const uint8_t * src = dst - offset;
+            if ( offset >= 8 && len + 8 <= raw_len - pos )
+            {
+                // 8 bytes at a time , may write up to 7 past the match (inside raw , rewritten later)
+                for(uint32_t i=0;i<len;i+=8)
+                    memcpy(dst+i,src+i,8);
+            }
+            else
+            {
+                for(uint32_t i=0;i<len;i++)
+                    dst[i] = src[i];
+            }
+            pos += len;
+        }
+
+        if ( t_checked && ac->overread > RECIP_ARITH_DECODER_MAX_OVERREAD ) break;
+    }
+
+    return pos;
+}
+
+bool recip_arith_lz_get_raw_len(const uint8_t * comp,uint64_t comp_len,uint64_t * p_raw_len)
+{
+    if ( comp_len < RECIP_ARITH_LZ_HEADER_SIZE ) return false;
+    if ( recip_arith_get_be32(comp) != RECIP_ARITH_LZ_MAGIC ) return false;
+    *p_raw_len = recip_arith_get_be64(comp+4);
+    return true;
+}
+
+bool recip_arith_lz_decompress(uint8_t * raw,uint64_t raw_capacity,const uint8_t * comp,uint64_t comp_len)
+{
+    uint64_t raw_len;
+    if ( ! recip_arith_lz_get_raw_len(comp,comp_len,&raw_len) ) return false;
+    if ( raw_capacity < raw_len || raw_len >= ((uint64_t)1<<32) ) return false;
+
+    const uint8_t * payload = comp + RECIP_ARITH_LZ_HEADER_SIZE;
+    uint64_t payload_len = comp_len - RECIP_ARITH_LZ_HEADER_SIZE;
+    uint8_t mode = comp[12];
+
+    if ( mode == RECIP_ARITH_LZ_MODE_RAW )
+    {
+        if ( payload_len != raw_len ) return false;
+        memcpy(raw,payload,(size_t)raw_len);
+        return true;
+    }
+    if ( mode != RECIP_ARITH_LZ_MODE_CODED || raw_len == 0 ) return false;
+
+    recip_arith_checked_decoder dec;
+    recip_arith_checked_decoder_start(&dec,payload,(size_t)payload_len);
+
+    recip_arith_lz_header_models header_models;
+    recip_arith_lz_header_models_init(&header_models);
+
+    recip_arith_lz_decode_model models[RECIP_ARITH_LZ_NUM_ALPHABETS];
+    std::vector<uint8_t> decode_tables((size_t)RECIP_ARITH_LZ_NUM_ALPHABETS<<RECIP_ARITH_LZ_MAX_CDF_BITS);
+
+    for(int a=0;a<RECIP_ARITH_LZ_NUM_ALPHABETS;a++)
+    {
+        recip_arith_lz_decode_model & m = models[a];
+        uint32_t num_syms = c_recip_arith_lz_num_syms[a];
+        uint8_t * decode = decode_tables.data() + ((size_t)a<<RECIP_ARITH_LZ_MAX_CDF_BITS);
+        m.decode = decode;
+
+        m.cdf_bits = (uint32_t) recip_arith_checked_decoder_get_nibble(&dec,&header_models.cdf_bits);
+        if ( m.cdf_bits > RECIP_ARITH_LZ_MAX_CDF_BITS ) return false;
+        memset(m.cdf,0,sizeof(m.cdf));
+        if ( m.cdf_bits == 0 ) continue;
+        const uint32_t cdf_tot = 1u<<m.cdf_bits;
+
+        // the freqs sum to cdf_tot , the last one implied :
+        for(uint32_t s=0;s+1<num_syms;s++)
+        {
+            uint32_t freq = recip_arith_checked_decoder_get_number(&dec,&header_models.freq_len);
+            if ( freq > cdf_tot - m.cdf[s] ) return false;
+            m.cdf[s+1] = m.cdf[s] + freq;
+        }
+        m.cdf[num_syms] = cdf_tot;
+
+        for(uint32_t s=0;s<num_syms;s++)
+            memset(decode + m.cdf[s],(int)s,m.cdf[s+1] - m.cdf[s]);
+    }
+
+    if ( recip_arith_checked_decoder_status(&dec) != RECIP_ARITH_DECODE_OK ) return false;
+    if ( models[RECIP_ARITH_LZ_LITERALS].cdf_bits == 0 || models[RECIP_ARITH_LZ_LENGTHS].cdf_bits == 0 ) return false;
+
+    uint32_t pos = 0;
+
+    // unchecked renorm while far from the end , like recip_arith_checked_decode ;
+    //  the decoder is copied to a local so it stays in registers
+    recip_arith_checked_decoder fast = dec;
+    for(;;)
+    {
+        size_t n = ( fast.dec.ptr < fast.end ) ? (size_t)(fast.end - fast.dec.ptr) / RECIP_ARITH_LZ_MAX_BYTES_PER_TOKEN : 0;
+        if ( n == 0 || pos >= raw_len || fast.corrupt ) break;
+
+        pos = recip_arith_lz_decode_tokens<false>(&fast,models,raw,pos,(uint32_t)raw_len,n);
+    }
+    dec = fast;
+
+    if ( ! dec.corrupt )
+        pos = recip_arith_lz_decode_tokens<true>(&dec,models,raw,pos,(uint32_t)raw_len,(size_t)raw_len);
+
+    return ( pos == raw_len && recip_arith_checked_decoder_status(&dec) == RECIP_ARITH_DECODE_OK );
+}
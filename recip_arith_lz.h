@@ -0,0 +1,112 @@
+#pragma once
+/**
+recip_arith_lz.h
+LZ77 codec with recip_arith as the entropy backend :
+hash-chain match finder , static literal / length / offset models , bypass-coded extra bits
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_LZ_H
+#define RECIP_ARITH_LZ_H
+
+#include "recip_arith.h"
+
+//=========================================================================================
+
+/**
+
+The parse is greedy with one step of lazy matching ; matches are found with a hash chain
+over 4-byte hashes , walking at most max_chain candidates per position , within a 4 MB window.
+
+Each token is coded in one recip_arith stream with three static models , each with its own cdf_bits :
+
+    length alphabet : 0 = literal , else 1 + slot(match_len - RECIP_ARITH_LZ_MIN_MATCH)
+    literal alphabet : the byte , after a length symbol 0
+    offset alphabet : slot(offset - 1) , after a length symbol != 0
+
+slot(v) is v for v < 4 , else 2 slots per power of two : the top two bits of v pick the slot
+and the bits under them are extra bits , sent raw with recip_arith_encoder_put_bits (recip_arith_bypass.h).
+the extra bits are close to uniform , so modeling them buys little ; the bypass costs no table or multiply.
+
+each alphabet picks the cdf_bits (1 - max_cdf_bits) that minimizes its normalization loss plus the bits
+to send its freqs (recip_arith_choose_cdf_bits in recip_arith_model_send.h , as the order-1 contexts do) ;
+the literal alphabet usually wants the most , the length alphabet the fewest.
+
+the models are sent at the start of the stream : per alphabet cdf_bits (0 if unused) then the freqs ,
+all but the last (it's implied) , as a bit length on an adaptive nibble model plus the bits under the top one raw.
+
+container layout , integers big endian :
+
+    u32 magic       RECIP_ARITH_LZ_MAGIC
+    u64 raw_len
+    u8 mode
+    RECIP_ARITH_LZ_MODE_RAW :   the raw bytes
+    RECIP_ARITH_LZ_MODE_CODED : recip_arith stream (models then tokens)
+
+data that doesn't get smaller is stored RAW.
+
+raw_len must be < 4 GB ; the encoder holds the token list (8 bytes per token) and a chain entry per
+window position.
+
+recip_arith_table_init must be called before decompressing.
+
+decompress validates the header , the models and every match (offset within the output so far ,
+length within raw_len) , and decodes with recip_arith_checked_decoder , so corrupt or truncated input
+is reported and never read or written outside the buffers.
+
+**/
+
+#define RECIP_ARITH_LZ_MAGIC                (0x52414C5A)    // "RALZ"
+#define RECIP_ARITH_LZ_HEADER_SIZE          (13)
+
+#define RECIP_ARITH_LZ_MODE_RAW             (0)
+#define RECIP_ARITH_LZ_MODE_CODED           (1)
+
+#define RECIP_ARITH_LZ_MIN_MATCH            (4)
+#define RECIP_ARITH_LZ_MAX_MATCH            (RECIP_ARITH_LZ_MIN_MATCH + 65535)
+#define RECIP_ARITH_LZ_WINDOW_BITS          (22)
+#define RECIP_ARITH_LZ_MAX_OFFSET           (1<<RECIP_ARITH_LZ_WINDOW_BITS)
+
+// 2 slots per bit of the value range :
+#define RECIP_ARITH_LZ_NUM_LENGTH_SYMS      (1 + 2*16)
+#define RECIP_ARITH_LZ_NUM_OFFSET_SYMS      (2*RECIP_ARITH_LZ_WINDOW_BITS)
+
+// freqs are sent as a bit length nibble , so they must fit in 15 bits :
+#define RECIP_ARITH_LZ_MAX_CDF_BITS         (14)
+#define RECIP_ARITH_LZ_DEFAULT_CDF_BITS     (13)
+#define RECIP_ARITH_LZ_DEFAULT_CHAIN        (32)
+
+struct recip_arith_lz_stats
+{
+    uint64_t num_literals;
+    uint64_t num_matches;
+    uint64_t match_bytes;           // raw bytes covered by matches
+    uint64_t extra_bits;            // length & offset bits sent with put_bits
+    uint32_t literal_cdf_bits;      // 0 if the alphabet is unused
+    uint32_t length_cdf_bits;
+    uint32_t offset_cdf_bits;
+};
+
+//=========================================================================================
+
+// bytes of comp that recip_arith_lz_compress needs , for any data
+uint64_t recip_arith_lz_compress_bound(uint64_t raw_len);
+
+// returns the container size , or 0 on bad arguments
+//  max_cdf_bits is 1 - RECIP_ARITH_LZ_MAX_CDF_BITS ; max_chain >= 1 is the match finder effort ; stats may be NULL
+uint64_t recip_arith_lz_compress(uint8_t * comp,uint64_t comp_capacity,const uint8_t * raw,uint64_t raw_len,
+                                uint32_t max_cdf_bits,uint32_t max_chain,recip_arith_lz_stats * stats);
+
+// reads raw_len from the container header ; false if it isn't a valid header
+bool recip_arith_lz_get_raw_len(const uint8_t * comp,uint64_t comp_len,uint64_t * p_raw_len);
+
+// raw must have raw_len bytes ; returns false on a malformed container
+bool recip_arith_lz_decompress(uint8_t * raw,uint64_t raw_capacity,const uint8_t * comp,uint64_t comp_len);
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_LZ_H
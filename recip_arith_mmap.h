@@ -0,0 +1,248 @@
+#pragma once
+/**
+recip_arith_mmap.h
+windowed memory-mapped file access , POSIX mmap or Win32 file mappings
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_MMAP_H
+#define RECIP_ARITH_MMAP_H
+
+#include "recip_arith.h"
+
+#include <stddef.h>
+
+//=========================================================================================
+
+/**
+
+recip_arith_mmap_file is an open file with a 64-bit size ;
+recip_arith_mmap_window maps one [offset,offset+len) view of it at a time ,
+so a file of any size is walked with only a window's worth of pages mapped.
+
+window offsets must be multiples of recip_arith_mmap_granularity()
+(the page size on POSIX , the 64k allocation granularity on Windows).
+
+files opened for writing are grown (or cut) with recip_arith_mmap_resize ;
+resize with no window mapped (Windows can't change the size of a file with a live view).
+a window past the end of the file is an error , not a grow.
+
+usage , reading :
+
+    recip_arith_mmap_file f;
+    recip_arith_mmap_window w = { };
+    recip_arith_mmap_open_read(&f,name);
+    for(uint64_t off=0;off<f.size;off+=win)
+    {
+        const uint8_t * p = recip_arith_mmap_map(&f,&w,off,min(win,f.size-off));
+        ..
+    }
+    recip_arith_mmap_unmap(&w);
+    recip_arith_mmap_close(&f);
+
+**/
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+struct recip_arith_mmap_file
+{
+    HANDLE file;
+    uint64_t size;
+    bool writable;
+};
+
+struct recip_arith_mmap_window
+{
+    HANDLE mapping;
+    uint8_t * base;
+    size_t len;
+};
+
+static inline uint32_t recip_arith_mmap_granularity()
+{
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (uint32_t) si.dwAllocationGranularity;
+}
+
+static inline bool recip_arith_mmap_open_common(recip_arith_mmap_file * f,const char * name,bool writable)
+{
+    f->writable = writable;
+    f->size = 0;
+    if ( writable )
+        f->file = CreateFileA(name,GENERIC_READ|GENERIC_WRITE,0,NULL,CREATE_ALWAYS,FILE_ATTRIBUTE_NORMAL,NULL);
+    else
+        f->file = CreateFileA(name,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+    if ( f->file == INVALID_HANDLE_VALUE ) return false;
+
+    LARGE_INTEGER size;
+    if ( ! GetFileSizeEx(f->file,&size) )
+    {
+        CloseHandle(f->file);
+        f->file = INVALID_HANDLE_VALUE;
+        return false;
+    }
+    f->size = (uint64_t) size.QuadPart;
+    return true;
+}
+
+static inline bool recip_arith_mmap_resize(recip_arith_mmap_file * f,uint64_t size)
+{
+    recip_arith_assert( f->writable );
+    LARGE_INTEGER pos;
+    pos.QuadPart = (LONGLONG) size;
+    if ( ! SetFilePointerEx(f->file,pos,NULL,FILE_BEGIN) || ! SetEndOfFile(f->file) )
+        return false;
+    f->size = size;
+    return true;
+}
+
+static inline void recip_arith_mmap_close(recip_arith_mmap_file * f)
+{
+    if ( f->file != INVALID_HANDLE_VALUE ) CloseHandle(f->file);
+    f->file = INVALID_HANDLE_VALUE;
+}
+
+static inline void recip_arith_mmap_unmap(recip_arith_mmap_window * w)
+{
+    if ( w->base ) UnmapViewOfFile(w->base);
+    if ( w->mapping ) CloseHandle(w->mapping);
+    w->base = NULL;
+    w->mapping = NULL;
+    w->len = 0;
+}
+
+// unmaps whatever w had , maps [offset,offset+len) ; NULL on failure
+static inline uint8_t * recip_arith_mmap_map(recip_arith_mmap_file * f,recip_arith_mmap_window * w,uint64_t offset,size_t len)
+{
+    recip_arith_mmap_unmap(w);
+    if ( len == 0 || offset + len > f->size ) return NULL;
+
+    // a mapping object per window , sized to the window end , so it never holds more of the file than that :
+    uint64_t end = offset + len;
+    w->mapping = CreateFileMappingA(f->file,NULL,f->writable ? PAGE_READWRITE : PAGE_READONLY,
+                                    (DWORD)(end>>32),(DWORD)end,NULL);
+    if ( w->mapping == NULL ) return NULL;
+
+    w->base = (uint8_t *) MapViewOfFile(w->mapping,f->writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+                                    (DWORD)(offset>>32),(DWORD)offset,len);
+    if ( w->base == NULL )
+    {
+        recip_arith_mmap_unmap(w);
+        return NULL;
+    }
+    w->len = len;
+    return w->base;
+}
+
+#else // POSIX
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+struct recip_arith_mmap_file
+{
+    int fd;
+    uint64_t size;
+    bool writable;
+};
+
+struct recip_arith_mmap_window
+{
+    uint8_t * base;
+    size_t len;
+};
+
+static inline uint32_t recip_arith_mmap_granularity()
+{
+    return (uint32_t) sysconf(_SC_PAGESIZE);
+}
+
+static inline bool recip_arith_mmap_open_common(recip_arith_mmap_file * f,const char * name,bool writable)
+{
+    f->writable = writable;
+    f->size = 0;
+    if ( writable )
+        f->fd = open(name,O_RDWR|O_CREAT|O_TRUNC,0644);
+    else
+        f->fd = open(name,O_RDONLY);
+    if ( f->fd < 0 ) return false;
+
+    struct stat st;
+    if ( fstat(f->fd,&st) != 0 )
+    {
+        close(f->fd);
+        f->fd = -1;
+        return false;
+    }
+    f->size = (uint64_t) st.st_size;
+    return true;
+}
+
+static inline bool recip_arith_mmap_resize(recip_arith_mmap_file * f,uint64_t size)
+{
+    recip_arith_assert( f->writable );
+    if ( ftruncate(f->fd,(off_t)size) != 0 ) return false;
+    f->size = size;
+    return true;
+}
+
+static inline void recip_arith_mmap_close(recip_arith_mmap_file * f)
+{
+    if ( f->fd >= 0 ) close(f->fd);
+    f->fd = -1;
+}
+
+static inline void recip_arith_mmap_unmap(recip_arith_mmap_window * w)
+{
+    if ( w->base ) munmap(w->base,w->len);
+    w->base = NULL;
+    w->len = 0;
+}
+
+// unmaps whatever w had , maps [offset,offset+len) ; NULL on failure
+static inline uint8_t * recip_arith_mmap_map(recip_arith_mmap_file * f,recip_arith_mmap_window * w,uint64_t offset,size_t len)
+{
+    recip_arith_mmap_unmap(w);
+    if ( len == 0 || offset + len > f->size ) return NULL;
+
+    void * p = mmap(NULL,len,f->writable ? (PROT_READ|PROT_WRITE) : PROT_READ,MAP_SHARED,f->fd,(off_t)offset);
+    if ( p == MAP_FAILED ) return NULL;
+
+    #ifdef MADV_SEQUENTIAL
+    // read-ahead for input , early reclaim of pages behind us :
+    madvise(p,len,MADV_SEQUENTIAL);
+    #endif
+
+    w->base = (uint8_t *) p;
+    w->len = len;
+    return w->base;
+}
+
+#endif // _WIN32
+
+static inline bool recip_arith_mmap_open_read(recip_arith_mmap_file * f,const char * name)
+{
+    return recip_arith_mmap_open_common(f,name,false);
+}
+
+// creates (or truncates) name , size 0
+static inline bool recip_arith_mmap_create(recip_arith_mmap_file * f,const char * name)
+{
+    return recip_arith_mmap_open_common(f,name,true);
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_MMAP_H
@@ -0,0 +1,151 @@
+#pragma once
+/**
+recip_arith_model_send.h
+sending static models in the recip_arith stream : numbers , the cdf_bits choice , and the checked readers
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_MODEL_SEND_H
+#define RECIP_ARITH_MODEL_SEND_H
+
+#include "recip_arith.h"
+#include "recip_arith_static_model.h"
+#include "recip_arith_adaptive.h"
+#include "recip_arith_bypass.h"
+#include "recip_arith_checked.h"
+#include "recip_arith_loss.h"
+
+#include <string.h>
+
+//=========================================================================================
+
+/**
+
+recip_arith_order1 and recip_arith_lz send their normalized freqs at the start of the stream they code.
+
+a number v (< 1<<15) is its bit length on an adaptive nibble model , then the bits under the top one raw
+with recip_arith_encoder_put_bits ; small numbers are cheap and the nibble model learns the typical size.
+
+recip_arith_choose_cdf_bits picks the cdf_bits for one histogram that minimizes the normalization loss
+over its symbols plus the estimated bits to send its freqs ; sparse histograms end up with small cdf_bits.
+
+the readers are on recip_arith_checked_decoder : a corrupt stream sets the corrupt flag and returns
+an in-range value , so check recip_arith_checked_decoder_status after reading the model.
+
+**/
+
+static recip_arith_inline uint32_t recip_arith_bit_length(uint32_t v)
+{
+    return v ? (uint32_t)(32 - clz32(v)) : 0;
+}
+
+//=========================================================================================
+// encoder
+
+// v with a bit length on an adaptive nibble model , then the bits under the top bit raw
+static inline void recip_arith_encoder_put_number(recip_arith_encoder * ac,recip_arith_nibble_model * m,uint32_t v)
+{
+    uint32_t len = recip_arith_bit_length(v);
+    recip_arith_assert( len < 16 );
+    recip_arith_encoder_put_nibble(ac,m,(int)len);
+    if ( len > 1 )
+    {
+        recip_arith_encoder_put_bits(ac,v & ((1u<<(len-1))-1),len-1);
+        recip_arith_encoder_renorm(ac);
+    }
+}
+
+// estimated bits to send v with _put_number (the nibble is about 2 bits on typical tables)
+static inline uint32_t recip_arith_number_cost(uint32_t v)
+{
+    uint32_t len = recip_arith_bit_length(v);
+    return 2 + ( len > 1 ? len-1 : 0 );
+}
+
+// pick the cdf_bits (up to max_cdf_bits) for counts[num_syms] : least normalization loss plus freq transmission ;
+//  fills freqs[num_syms] , returns 0 if there are no counts
+static inline uint32_t recip_arith_choose_cdf_bits(uint32_t * freqs,const uint32_t * counts,uint32_t num_syms,uint32_t max_cdf_bits)
+{
+    recip_arith_assert( num_syms <= 256 );
+
+    uint64_t total = 0;
+    uint32_t num_used = 0;
+    for(uint32_t s=0;s<num_syms;s++)
+    {
+        total += counts[s];
+        num_used += ( counts[s] != 0 );
+    }
+    if ( total == 0 ) return 0;
+
+    uint32_t min_cdf_bits = recip_arith_bit_length(num_used-1);
+    if ( min_cdf_bits < 1 ) min_cdf_bits = 1;
+    if ( min_cdf_bits > max_cdf_bits ) min_cdf_bits = max_cdf_bits;
+
+    double best_cost = 0;
+    uint32_t best_cdf_bits = 0;
+    uint32_t try_freqs[256];
+    for(uint32_t cdf_bits=min_cdf_bits;cdf_bits<=max_cdf_bits;cdf_bits++)
+    {
+        if ( ! recip_arith_normalize_counts(try_freqs,counts,(int)num_syms,cdf_bits) ) continue;
+
+        double cost = total * recip_arith_normalization_loss(counts,try_freqs,(int)num_syms,cdf_bits);
+        for(uint32_t s=0;s<num_syms;s++)
+            if ( try_freqs[s] ) cost += recip_arith_number_cost(try_freqs[s]-1);
+
+        if ( best_cdf_bits == 0 || cost < best_cost )
+        {
+            best_cost = cost;
+            best_cdf_bits = cdf_bits;
+            memcpy(freqs,try_freqs,num_syms*sizeof(uint32_t));
+        }
+    }
+
+    return best_cdf_bits;
+}
+
+//=========================================================================================
+// checked decoder
+
+// recip_arith_decoder_get_nibble on the checked decoder
+static recip_arith_inline int recip_arith_checked_decoder_get_nibble(recip_arith_checked_decoder * ac,recip_arith_nibble_model * m)
+{
+    uint32_t target = recip_arith_decoder_peek_masked(&ac->dec,RECIP_ARITH_NIBBLE_CDF_BITS,&ac->corrupt);
+    int sym = recip_arith_nibble_model_find(m,target);
+    uint32_t low = recip_arith_nibble_model_low(m,sym);
+    uint32_t high = recip_arith_nibble_model_high(m,sym);
+    recip_arith_checked_decoder_remove(ac,low,high-low);
+    recip_arith_checked_decoder_renorm(ac);
+    recip_arith_nibble_model_update(m,sym);
+    return sym;
+}
+
+// recip_arith_decoder_get_bits on the checked decoder
+static recip_arith_inline uint32_t recip_arith_checked_decoder_get_bits(recip_arith_checked_decoder * ac,uint32_t nbits)
+{
+    // get_bits needs code < range , which only a corrupt stream breaks
+    if ( ac->dec.code >= ac->dec.range )
+    {
+        ac->corrupt = 1;
+        return 0;
+    }
+    uint32_t v = recip_arith_decoder_get_bits(&ac->dec,nbits);
+    recip_arith_checked_decoder_renorm(ac);
+    return v;
+}
+
+static inline uint32_t recip_arith_checked_decoder_get_number(recip_arith_checked_decoder * ac,recip_arith_nibble_model * m)
+{
+    uint32_t len = (uint32_t) recip_arith_checked_decoder_get_nibble(ac,m);
+    if ( len == 0 ) return 0;
+    uint32_t v = 1u<<(len-1);
+    if ( len > 1 ) v |= recip_arith_checked_decoder_get_bits(ac,len-1);
+    return v;
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_MODEL_SEND_H
@@ -0,0 +1,418 @@
+/**
+recip_arith_order1.cpp
+static order-1 (previous byte context) recip_arith codec with compact per-context tables
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+
+#include "recip_arith_order1.h"
+#include "recip_arith_model_send.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+//=========================================================================================
+
+// the encoder checks for expansion every CHECK_INTERVAL symbols , and after each context's table ;
+//  a symbol puts at most 3 bytes , a context's table well under 4k , _finish at most 2
+#define RECIP_ARITH_ORDER1_CHECK_INTERVAL   (256)
+#define RECIP_ARITH_ORDER1_SLACK            (4096 + 3*RECIP_ARITH_ORDER1_CHECK_INTERVAL + 8)
+
+// the adaptive models for the table numbers :
+struct recip_arith_order1_table_models
+{
+    recip_arith_nibble_model cdf_bits;
+    recip_arith_nibble_model gap_len;
+    recip_arith_nibble_model freq_len;
+};
+
+static void recip_arith_order1_table_models_init(recip_arith_order1_table_models * m)
+{
+    recip_arith_nibble_model_init(&m->cdf_bits);
+    recip_arith_nibble_model_init(&m->gap_len);
+    recip_arith_nibble_model_init(&m->freq_len);
+}
+
+// decoder table arena layout , shared by encoder (for stats) and decoder :
+//  u32 entries[num_used+1] then u8 decode[1<<cdf_bits] , 4-aligned
+static uint64_t recip_arith_order1_table_size(uint32_t num_used,uint32_t cdf_bits)
+{
+    uint64_t size = 4*(uint64_t)(num_used+1) + ((uint64_t)1<<cdf_bits);
+    return (size + 3) & ~(uint64_t)3;
+}
+
+//=========================================================================================
+// encoder
+
+uint64_t recip_arith_order1_compress_bound(uint64_t raw_len)
+{
+    return RECIP_ARITH_ORDER1_HEADER_SIZE + 1 + raw_len + RECIP_ARITH_ORDER1_SLACK;
+}
+
+// the CODED payload after the mode byte ; 0 if it doesn't beat raw_len
+static uint64_t recip_arith_order1_encode(uint8_t * comp,const uint8_t * raw,uint32_t raw_len,
+                                        uint32_t max_cdf_bits,recip_arith_order1_stats * stats)
+{
+    std::vector<uint32_t> counts(256*256,0);
+    uint32_t ctx = 0;
+    for(uint32_t i=0;i<raw_len;i++)
+    {
+        counts[ctx*256 + raw[i]] += 1;
+        ctx = raw[i];
+    }
+
+    // contexts that occur , hottest first :
+    uint64_t ctx_total[256];
+    uint32_t order[256];
+    uint32_t num_contexts = 0;
+    for(int c=0;c<256;c++)
+    {
+        ctx_total[c] = 0;
+        for(int s=0;s<256;s++) ctx_total[c] += counts[c*256+s];
+        if ( ctx_total[c] ) order[num_contexts++] = c;
+    }
+    std::stable_sort(order,order+num_contexts,[&](uint32_t a,uint32_t b) { return ctx_total[a] > ctx_total[b]; });
+
+    // entries [ freq : 16 | cdf_low : 16 ] per (ctx,sym) , cdf_bits 0 for one-symbol contexts :
+    std::vector<uint32_t> entries(256*256,0);
+    uint8_t ctx_cdf_bits[256] = { };
+
+    uint8_t * ptr = comp;
+    *ptr++ = (uint8_t) max_cdf_bits;
+    uint8_t * limit = comp + raw_len;
+
+    recip_arith_encoder enc;
+    recip_arith_encoder_start(&enc,ptr);
+
+    recip_arith_order1_table_models models;
+    recip_arith_order1_table_models_init(&models);
+
+    recip_arith_order1_stats st = { };
+    st.num_contexts = num_contexts;
+
+    recip_arith_encoder_put_bits(&enc,num_contexts-1,8);
+    recip_arith_encoder_renorm(&enc);
+    for(uint32_t i=0;i<num_contexts;i++)
+    {
+        recip_arith_encoder_put_bits(&enc,order[i],8);
+        recip_arith_encoder_renorm(&enc);
+    }
+
+    for(uint32_t i=0;i<num_contexts;i++)
+    {
+        uint32_t c = order[i];
+        const uint32_t * ctx_counts = &counts[c*256];
+
+        uint32_t num_used = 0;
+        for(int s=0;s<256;s++) num_used += ( ctx_counts[s] != 0 );
+
+        recip_arith_encoder_put_bits(&enc,num_used-1,8);
+        recip_arith_encoder_renorm(&enc);
+
+        // the symbol set as gaps , unless it's all of them :
+        if ( num_used < 256 )
+        {
+            int prev = -1;
+            for(int s=0;s<256;s++)
+            {
+                if ( ctx_counts[s] == 0 ) continue;
+                recip_arith_encoder_put_number(&enc,&models.gap_len,(uint32_t)(s - prev - 1));
+                prev = s;
+            }
+        }
+
+        if ( num_used == 1 ) continue;
+
+        uint32_t freqs[256];
+        uint32_t cdf_bits = recip_arith_choose_cdf_bits(freqs,ctx_counts,256,max_cdf_bits);
+        if ( cdf_bits == 0 ) return 0;
+        ctx_cdf_bits[c] = (uint8_t) cdf_bits;
+        recip_arith_encoder_put_nibble(&enc,&models.cdf_bits,(int)cdf_bits);
+
+        uint32_t low = 0;
+        uint32_t sent = 0;
+        for(int s=0;s<256;s++)
+        {
+            if ( freqs[s] == 0 ) continue;
+            entries[c*256+s] = (freqs[s]<<16) | low;
+            low += freqs[s];
+            // the last freq is implied :
+            if ( ++sent < num_used )
+                recip_arith_encoder_put_number(&enc,&models.freq_len,freqs[s]-1);
+        }
+
+        st.num_coded_contexts++;
+        st.table_bytes += recip_arith_order1_table_size(num_used,cdf_bits);
+
+        if ( enc.ptr >= limit ) return 0;
+    }
+
+    st.header_bytes = (uint64_t)(enc.ptr - ptr);
+
+    ctx = 0;
+    for(uint32_t i=0;i<raw_len;)
+    {
+        uint32_t chunk_end = i + RECIP_ARITH_ORDER1_CHECK_INTERVAL;
+        if ( chunk_end > raw_len ) chunk_end = raw_len;
+
+        for(;i<chunk_end;i++)
+        {
+            uint32_t sym = raw[i];
+            uint32_t cdf_bits = ctx_cdf_bits[ctx];
+            if ( cdf_bits )
+            {
+                uint32_t e = entries[ctx*256+sym];
+                recip_arith_encoder_put(&enc,e & 0xFFFF,e>>16,cdf_bits);
+                recip_arith_encoder_renorm(&enc);
+            }
+            ctx = sym;
+        }
+
+        if ( enc.ptr >= limit ) return 0;
+    }
+
+    uint8_t * end = recip_arith_encoder_finish(&enc);
+    if ( end >= limit ) return 0;
+
+    if ( stats ) *stats = st;
+    return (uint64_t)(end - comp);
+}
+
+uint64_t recip_arith_order1_compress(uint8_t * comp,uint64_t comp_capacity,const uint8_t * raw,uint64_t raw_len,
+                                    uint32_t max_cdf_bits,recip_arith_order1_stats * stats)
+{
+    if ( max_cdf_bits < 1 || max_cdf_bits > RECIP_ARITH_ORDER1_MAX_CDF_BITS ) return 0;
+    if ( raw_len >= ((uint64_t)1<<32) ) return 0;
+    if ( comp_capacity < recip_arith_order1_compress_bound(raw_len) ) return 0;
+
+    if ( stats ) memset(stats,0,sizeof(*stats));
+
+    recip_arith_put_be32(comp,RECIP_ARITH_ORDER1_MAGIC);
+    recip_arith_put_be64(comp+4,raw_len);
+    uint8_t * mode = comp + 12;
+
+    uint64_t payload_len = 0;
+    if ( raw_len > 0 )
+        payload_len = recip_arith_order1_encode(mode+1,raw,(uint32_t)raw_len,max_cdf_bits,stats);
+
+    if ( payload_len != 0 )
+    {
+        *mode = RECIP_ARITH_ORDER1_MODE_CODED;
+    }
+    else
+    {
+        *mode = RECIP_ARITH_ORDER1_MODE_RAW;
+        memcpy(mode+1,raw,(size_t)raw_len);
+        payload_len = raw_len;
+    }
+
+    return RECIP_ARITH_ORDER1_HEADER_SIZE + payload_len;
+}
+
+//=========================================================================================
+// decoder
+
+// one context's decode tables ; cdf_bits 0 means only sym occurs
+struct recip_arith_order1_context
+{
+    uint32_t cdf_bits;
+    uint32_t sym;
+    const uint32_t * entries;   // [ sym : 16 | cdf_low : 16 ] , num_used+1 of them
+    const uint8_t * decode;     // target -> entry index
+};
+
+bool recip_arith_order1_get_raw_len(const uint8_t * comp,uint64_t comp_len,uint64_t * p_raw_len)
+{
+    if ( comp_len < RECIP_ARITH_ORDER1_HEADER_SIZE ) return false;
+    if ( recip_arith_get_be32(comp) != RECIP_ARITH_ORDER1_MAGIC ) return false;
+    *p_raw_len = recip_arith_get_be64(comp+4);
+    return true;
+}
+
+bool recip_arith_order1_decompress(uint8_t * raw,uint64_t raw_capacity,const uint8_t * comp,uint64_t comp_len)
+{
+    uint64_t raw_len;
+    if ( ! recip_arith_order1_get_raw_len(comp,comp_len,&raw_len) ) return false;
+    if ( raw_capacity < raw_len || raw_len >= ((uint64_t)1<<32) ) return false;
+
+    const uint8_t * payload = comp + RECIP_ARITH_ORDER1_HEADER_SIZE;
+    uint64_t payload_len = comp_len - RECIP_ARITH_ORDER1_HEADER_SIZE;
+    uint8_t mode = comp[12];
+
+    if ( mode == RECIP_ARITH_ORDER1_MODE_RAW )
+    {
+        if ( payload_len != raw_len ) return false;
+        memcpy(raw,payload,(size_t)raw_len);
+        return true;
+    }
+    if ( mode != RECIP_ARITH_ORDER1_MODE_CODED || payload_len < 1 ) return false;
+
+    uint32_t max_cdf_bits = payload[0];
+    if ( max_cdf_bits < 1 || max_cdf_bits > RECIP_ARITH_ORDER1_MAX_CDF_BITS ) return false;
+
+    recip_arith_checked_decoder dec;
+    recip_arith_checked_decoder_start(&dec,payload+1,(size_t)(payload_len-1));
+
+    recip_arith_order1_table_models models;
+    recip_arith_order1_table_models_init(&models);
+
+    // read all the tables first , then lay them out in the arena in the order sent (hottest first)
+    struct context_table
+    {
+        uint32_t num_used;
+        uint32_t cdf_bits;
+        uint8_t syms[256];
+        uint32_t freqs[256];
+    };
+    std::vector<context_table> tables;
+
+    uint32_t num_contexts = recip_arith_checked_decoder_get_bits(&dec,8) + 1;
+    uint32_t order[256];
+    bool seen[256] = { };
+    for(uint32_t i=0;i<num_contexts;i++)
+    {
+        order[i] = recip_arith_checked_decoder_get_bits(&dec,8);
+        if ( seen[order[i]] ) return false;
+        seen[order[i]] = true;
+    }
+
+    tables.resize(num_contexts);
+    uint64_t arena_size = 0;
+    for(uint32_t i=0;i<num_contexts;i++)
+    {
+        context_table & t = tables[i];
+        t.num_used = recip_arith_checked_decoder_get_bits(&dec,8) + 1;
+
+        if ( t.num_used < 256 )
+        {
+            int prev = -1;
+            for(uint32_t j=0;j<t.num_used;j++)
+            {
+                int s = prev + 1 + (int) recip_arith_checked_decoder_get_number(&dec,&models.gap_len);
+                if ( s > 255 ) return false;
+                t.syms[j] = (uint8_t) s;
+                prev = s;
+            }
+        }
+        else
+        {
+            for(uint32_t j=0;j<256;j++) t.syms[j] = (uint8_t) j;
+        }
+
+        t.cdf_bits = 0;
+        if ( t.num_used == 1 ) continue;
+
+        t.cdf_bits = (uint32_t) recip_arith_checked_decoder_get_nibble(&dec,&models.cdf_bits);
+        if ( t.cdf_bits < 1 || t.cdf_bits > max_cdf_bits ) return false;
+        const uint32_t cdf_tot = 1u<<t.cdf_bits;
+
+        // each freq >= 1 , and they sum to cdf_tot with room for the rest :
+        uint32_t sum = 0;
+        for(uint32_t j=0;j+1<t.num_used;j++)
+        {
+            uint32_t freq = recip_arith_checked_decoder_get_number(&dec,&models.freq_len) + 1;
+            if ( freq >= cdf_tot || sum + freq > cdf_tot - (t.num_used - 1 - j) ) return false;
+            t.freqs[j] = freq;
+            sum += freq;
+        }
+        t.freqs[t.num_used-1] = cdf_tot - sum;
+
+        arena_size += recip_arith_order1_table_size(t.num_used,t.cdf_bits);
+    }
+
+    if ( recip_arith_checked_decoder_status(&dec) != RECIP_ARITH_DECODE_OK ) return false;
+
+    std::vector<uint32_t> arena((size_t)(arena_size/4));
+    recip_arith_order1_context contexts[256];
+    for(int c=0;c<256;c++)
+    {
+        // never occurs (or it's only the last byte) : decodes as sym 0 , a valid stream never asks
+        contexts[c].cdf_bits = 0;
+        contexts[c].sym = 0;
+        contexts[c].entries = NULL;
+        contexts[c].decode = NULL;
+    }
+
+    uint8_t * arena_ptr = (uint8_t *) arena.data();
+    for(uint32_t i=0;i<num_contexts;i++)
+    {
+        const context_table & t = tables[i];
+        recip_arith_order1_context & ctx = contexts[order[i]];
+        ctx.cdf_bits = t.cdf_bits;
+        ctx.sym = t.syms[0];
+        if ( t.num_used == 1 ) continue;
+
+        uint32_t * entries = (uint32_t *) arena_ptr;
+        uint8_t * decode = arena_ptr + 4*(t.num_used+1);
+        uint32_t low = 0;
+        for(uint32_t j=0;j<t.num_used;j++)
+        {
+            entries[j] = ((uint32_t)t.syms[j]<<16) | low;
+            memset(decode+low,(int)j,t.freqs[j]);
+            low += t.freqs[j];
+        }
+        entries[t.num_used] = low;
+
+        ctx.entries = entries;
+        ctx.decode = decode;
+        arena_ptr += recip_arith_order1_table_size(t.num_used,t.cdf_bits);
+    }
+
+    uint32_t i = 0;
+    uint32_t prev = 0;
+
+    // unchecked renorm while far from the end , like recip_arith_checked_decode :
+    recip_arith_decoder fast = dec.dec;
+    uint32_t corrupt = 0;
+    for(;;)
+    {
+        size_t n = ( fast.ptr < dec.end ) ? (size_t)(dec.end - fast.ptr) / RECIP_ARITH_DECODER_MAX_BYTES_PER_SYMBOL : 0;
+        if ( n > raw_len - i ) n = (size_t)(raw_len - i);
+        if ( n == 0 ) break;
+
+        for(uint32_t e=i+(uint32_t)n;i<e;i++)
+        {
+            const recip_arith_order1_context * ctx = &contexts[prev];
+            uint32_t sym = ctx->sym;
+            if ( ctx->cdf_bits )
+            {
+                uint32_t target = recip_arith_decoder_peek_masked(&fast,ctx->cdf_bits,&corrupt);
+                const uint32_t * entry = ctx->entries + ctx->decode[target];
+                uint32_t low = entry[0] & 0xFFFF;
+                recip_arith_decoder_remove(&fast,low,(entry[1] & 0xFFFF) - low);
+                recip_arith_decoder_renorm(&fast);
+                sym = entry[0] >> 16;
+            }
+            raw[i] = (uint8_t) sym;
+            prev = sym;
+        }
+    }
+    dec.dec = fast;
+    dec.corrupt |= corrupt;
+
+    for(;i<raw_len;i++)
+    {
+        const recip_arith_order1_context * ctx = &contexts[prev];
+        uint32_t sym = ctx->sym;
+        if ( ctx->cdf_bits )
+        {
+            uint32_t target = recip_arith_checked_decoder_peek(&dec,ctx->cdf_bits);
+            const uint32_t * entry = ctx->entries + ctx->decode[target];
+            uint32_t low = entry[0] & 0xFFFF;
+            recip_arith_checked_decoder_remove(&dec,low,(entry[1] & 0xFFFF) - low);
+            recip_arith_checked_decoder_renorm(&dec);
+            sym = entry[0] >> 16;
+        }
+        raw[i] = (uint8_t) sym;
+        prev = sym;
+        if ( dec.overread > RECIP_ARITH_DECODER_MAX_OVERREAD ) break;
+    }
+
+    return ( recip_arith_checked_decoder_status(&dec) == RECIP_ARITH_DECODE_OK );
+}
@@ -0,0 +1,101 @@
+#pragma once
+/**
+recip_arith_order1.h
+static order-1 (previous byte context) recip_arith codec with compact per-context tables
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_ORDER1_H
+#define RECIP_ARITH_ORDER1_H
+
+#include "recip_arith.h"
+
+//=========================================================================================
+
+/**
+
+Each byte is coded with the static histogram of the byte before it (the first with context 0).
+256 contexts with a full cdf[257] + (1<<cdf_bits) decode_table each is 2.3 MB at cdf_bits 13 ,
+so the decoder tables are built to be small :
+
+    cdf_bits per context : each context picks the cdf_bits (1 - max_cdf_bits) that minimizes
+        its normalization loss (bits lost over all its symbols) plus the bits to send its freqs ;
+        sparse contexts end up with small cdf_bits and small tables
+    only the symbols that occur are in a context's table : u32 entries [ sym : 16 | cdf_low : 16 ]
+        for num_used+1 symbols , and a (1<<cdf_bits) u8 decode table of entry indices
+    contexts with one symbol are not coded at all
+    the tables are laid out in one arena , hottest context first , so the contexts that
+        are used most share cache lines and pages and unused contexts take nothing
+
+the tables are sent in the same recip_arith stream , before the data :
+    num_contexts-1 : 8 raw bits
+    the id of each context that occurs , hottest first : 8 raw bits each
+    then per context , in that order :
+        num_used-1 : 8 raw bits
+        the symbol set as gaps (sym - prev_sym - 1) , unless num_used == 256
+        if num_used > 1 : cdf_bits on an adaptive nibble model ,
+            then freq-1 of each symbol but the last (it's implied)
+    raw bits are recip_arith_encoder_put_bits (recip_arith_bypass.h) ;
+    gaps and freqs are numbers : a bit length on an adaptive nibble model plus the bits under the top one raw
+
+container layout , integers big endian :
+
+    u32 magic       RECIP_ARITH_ORDER1_MAGIC
+    u64 raw_len
+    u8 mode
+    RECIP_ARITH_ORDER1_MODE_RAW :   the raw bytes
+    RECIP_ARITH_ORDER1_MODE_CODED : u8 max_cdf_bits , recip_arith stream (tables then data)
+
+data that doesn't get smaller is stored RAW.
+
+raw_len must be < 4 GB ; for bigger data cut it into pieces (recip_arith_block does that for order-0).
+
+recip_arith_table_init must be called before decompressing.
+
+decompress validates the header and the tables ,
+and decodes with recip_arith_checked_decoder , so corrupt or truncated input
+is reported and never read outside the container.
+
+**/
+
+#define RECIP_ARITH_ORDER1_MAGIC                (0x52414F31)    // "RAO1"
+#define RECIP_ARITH_ORDER1_HEADER_SIZE          (13)
+
+#define RECIP_ARITH_ORDER1_MODE_RAW             (0)
+#define RECIP_ARITH_ORDER1_MODE_CODED           (1)
+
+// cdf_low & the entry index must fit in the table entries :
+#define RECIP_ARITH_ORDER1_MAX_CDF_BITS         (15)
+#define RECIP_ARITH_ORDER1_DEFAULT_CDF_BITS     (12)
+
+struct recip_arith_order1_stats
+{
+    uint32_t num_contexts;          // contexts that occur
+    uint32_t num_coded_contexts;    // .. with more than one symbol
+    uint64_t table_bytes;           // decoder table arena
+    uint64_t header_bytes;          // bytes of the stream taken by the tables
+};
+
+//=========================================================================================
+
+// bytes of comp that recip_arith_order1_compress needs , for any data
+uint64_t recip_arith_order1_compress_bound(uint64_t raw_len);
+
+// returns the container size , or 0 on bad arguments
+//  max_cdf_bits is 1 - RECIP_ARITH_ORDER1_MAX_CDF_BITS ; stats may be NULL
+uint64_t recip_arith_order1_compress(uint8_t * comp,uint64_t comp_capacity,const uint8_t * raw,uint64_t raw_len,
+                                    uint32_t max_cdf_bits,recip_arith_order1_stats * stats);
+
+// reads raw_len from the container header ; false if it isn't a valid header
+bool recip_arith_order1_get_raw_len(const uint8_t * comp,uint64_t comp_len,uint64_t * p_raw_len);
+
+// raw must have raw_len bytes ; returns false on a malformed container
+bool recip_arith_order1_decompress(uint8_t * raw,uint64_t raw_capacity,const uint8_t * comp,uint64_t comp_len);
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_ORDER1_H
@@ -0,0 +1,160 @@
+#pragma once
+/**
+recip_arith_perf.h
+hardware performance counters around a block of coding , through Linux perf_event_open
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_PERF_H
+#define RECIP_ARITH_PERF_H
+
+#include "recip_arith.h"
+
+//=========================================================================================
+
+/**
+
+recip_arith_perf counts cycles , instructions , branch misses and L1D read misses
+for the calling thread , user mode only , between _start and _stop.
+
+the counters are opened as one group so they are scheduled together.
+any counter the kernel or CPU refuses (no PMU in a VM , perf_event_paranoid) reads as 0 ;
+_open returns false if none could be opened.  On other platforms it always returns false.
+
+usage :
+
+    recip_arith_perf perf;
+    if ( recip_arith_perf_open(&perf) )
+    {
+        uint64_t values[RECIP_ARITH_PERF_COUNT];
+        recip_arith_perf_start(&perf);
+        .. decode a block ..
+        recip_arith_perf_stop(&perf,values);
+        recip_arith_perf_close(&perf);
+    }
+
+**/
+
+enum
+{
+    RECIP_ARITH_PERF_CYCLES,
+    RECIP_ARITH_PERF_INSTRUCTIONS,
+    RECIP_ARITH_PERF_BRANCH_MISSES,
+    RECIP_ARITH_PERF_L1D_MISSES,
+    RECIP_ARITH_PERF_COUNT
+};
+
+struct recip_arith_perf
+{
+    int fd[RECIP_ARITH_PERF_COUNT];     // -1 if not available
+    int leader;                         // fd of the group leader , -1 if none
+};
+
+static inline const char * recip_arith_perf_name(int counter)
+{
+    static const char * c_names[RECIP_ARITH_PERF_COUNT] = { "cycles" , "instructions" , "branch_misses" , "l1d_misses" };
+    return ( counter >= 0 && counter < RECIP_ARITH_PERF_COUNT ) ? c_names[counter] : "?";
+}
+
+//=========================================================================================
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+
+static inline bool recip_arith_perf_open(recip_arith_perf * perf)
+{
+    static const uint32_t c_types[RECIP_ARITH_PERF_COUNT] =
+        { PERF_TYPE_HARDWARE , PERF_TYPE_HARDWARE , PERF_TYPE_HARDWARE , PERF_TYPE_HW_CACHE };
+    static const uint64_t c_configs[RECIP_ARITH_PERF_COUNT] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES ,
+        PERF_COUNT_HW_INSTRUCTIONS ,
+        PERF_COUNT_HW_BRANCH_MISSES ,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+    };
+
+    perf->leader = -1;
+    for(int i=0;i<RECIP_ARITH_PERF_COUNT;i++)
+    {
+        struct perf_event_attr attr;
+        memset(&attr,0,sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = c_types[i];
+        attr.config = c_configs[i];
+        attr.disabled = ( perf->leader == -1 ) ? 1 : 0; // members follow the leader
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        // this thread , any cpu :
+        perf->fd[i] = (int) syscall(SYS_perf_event_open,&attr,0,-1,perf->leader,0);
+        if ( perf->fd[i] >= 0 && perf->leader == -1 )
+            perf->leader = perf->fd[i];
+    }
+
+    return ( perf->leader != -1 );
+}
+
+static inline void recip_arith_perf_close(recip_arith_perf * perf)
+{
+    for(int i=0;i<RECIP_ARITH_PERF_COUNT;i++)
+    {
+        if ( perf->fd[i] >= 0 ) close(perf->fd[i]);
+        perf->fd[i] = -1;
+    }
+    perf->leader = -1;
+}
+
+static inline void recip_arith_perf_start(recip_arith_perf * perf)
+{
+    if ( perf->leader < 0 ) return;
+    ioctl(perf->leader,PERF_EVENT_IOC_RESET,PERF_IOC_FLAG_GROUP);
+    ioctl(perf->leader,PERF_EVENT_IOC_ENABLE,PERF_IOC_FLAG_GROUP);
+}
+
+static inline void recip_arith_perf_stop(recip_arith_perf * perf,uint64_t * values)
+{
+    if ( perf->leader >= 0 )
+        ioctl(perf->leader,PERF_EVENT_IOC_DISABLE,PERF_IOC_FLAG_GROUP);
+
+    for(int i=0;i<RECIP_ARITH_PERF_COUNT;i++)
+    {
+        values[i] = 0;
+        if ( perf->fd[i] < 0 ) continue;
+        uint64_t value = 0;
+        if ( read(perf->fd[i],&value,sizeof(value)) == (ssize_t)sizeof(value) )
+            values[i] = value;
+    }
+}
+
+#else // __linux__
+
+static inline bool recip_arith_perf_open(recip_arith_perf * perf)
+{
+    for(int i=0;i<RECIP_ARITH_PERF_COUNT;i++) perf->fd[i] = -1;
+    perf->leader = -1;
+    return false;
+}
+
+static inline void recip_arith_perf_close(recip_arith_perf * perf) { (void)perf; }
+static inline void recip_arith_perf_start(recip_arith_perf * perf) { (void)perf; }
+
+static inline void recip_arith_perf_stop(recip_arith_perf * perf,uint64_t * values)
+{
+    (void)perf;
+    for(int i=0;i<RECIP_ARITH_PERF_COUNT;i++) values[i] = 0;
+}
+
+#endif // __linux__
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_PERF_H
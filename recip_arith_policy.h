@@ -0,0 +1,208 @@
+#pragma once
+/**
+recip_arith_policy.h
+one coder template over every cdf->range map and state width
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_POLICY_H
+#define RECIP_ARITH_POLICY_H
+
+#include "recip_arith.h"
+#include "recip_arith_reference_maps.h"
+
+#include <stddef.h>
+
+//=========================================================================================
+
+/**
+
+recip_arith_policy_coder_t< map , state >
+
+map is how a cdf interval becomes a sub-range of range (and back , in the decoder) :
+
+    recip_arith_map_recip       recip_arith : top RECIP_ARITH_TABLE_BITS of range , reciprocal table in the decoder
+                                    (call recip_arith_table_init)
+    recip_arith_map_rangecoder  range >> cdf_bits , the decoder divides
+    recip_arith_map_cacm87      the exact map (cdf * range) >> cdf_bits , the decoder divides
+    recip_arith_map_sm98        range rounded down to a power of two , the excess doubles the top of the cdf ;
+                                    shifts only , no multiply or divide either way
+
+state is the encoder & decoder state and its renorms :
+
+    recip_arith_state32         recip_arith_encoder / recip_arith_decoder , range >= (1<<24) , byte renorms
+    recip_arith_state64         recip_arith64_encoder / recip_arith64_decoder , range >= (1<<32) , word renorms
+                                    (recip_arith64_decoder_renorm32 ; only the recip map can mix it with the
+                                    byte renorm , the others see the low bits of range , so both sides must renorm alike)
+
+the policies are structs of static recip_arith_inline functions that call the map & state functions
+in recip_arith.h and recip_arith_reference_maps.h , so a coder compiles to the same code as calling them directly ;
+the surrounding loop (models , symbol lookup , I/O) is written once against the coder :
+
+    typedef recip_arith_policy_coder_t<recip_arith_map_sm98,recip_arith_state64> coder;
+    coder::encoder enc;
+    coder::encoder_start(&enc,ptr);
+    coder::put(&enc,cdf_low,cdf_freq,cdf_bits);
+    coder::encoder_renorm(&enc);
+    ..
+    coder::decoder dec;
+    coder::decoder_start(&dec,ptr);
+    uint32_t target = coder::peek(&dec,cdf_bits);
+    .. find the symbol ..
+    coder::remove(&dec,cdf_low,cdf_freq,cdf_bits);
+    coder::decoder_renorm(&dec);
+
+renorm after every symbol ; cdf_bits is up to RECIP_ARITH_MAX_CDF_BITS for every map & state.
+
+bitstreams :
+    on state32 each map writes the stream of its plain functions (recip_arith_encoder_put , _put_rangecoder ,
+        _put_cacm87 , _put_sm98)
+    recip on state64 writes the same stream as on state32 (see recip_arith64_encoder)
+    the other maps on state64 see all 64 bits of range , so their streams are their own
+
+bench_recip_arith times every map on both states. On big.txt at cdf_bits 12 the map loss over the cdf is about
+0.0003 bpb for cacm87 & rangecoder , 0.004 for recip , 0.047 for sm98.
+Where the divider is fast (a recent Xeon) the decoders are within 20% of each other , recip64 ahead ;
+on older cores the divide costs 20-40 cycles per symbol and recip pulls well ahead.
+
+**/
+
+//=========================================================================================
+// states
+
+struct recip_arith_state32
+{
+    typedef recip_arith_encoder encoder;
+    typedef recip_arith_decoder decoder;
+
+    static recip_arith_inline void encoder_start(encoder * ac,uint8_t * ptr) { recip_arith_encoder_start(ac,ptr); }
+    static recip_arith_inline void encoder_renorm(encoder * ac) { recip_arith_encoder_renorm(ac); }
+    static recip_arith_inline uint8_t * encoder_finish(encoder * ac) { return recip_arith_encoder_finish(ac); }
+
+    static recip_arith_inline void decoder_start(decoder * ac,const uint8_t * ptr) { recip_arith_decoder_start(ac,ptr); }
+    static recip_arith_inline void decoder_renorm(decoder * ac) { recip_arith_decoder_renorm(ac); }
+};
+
+struct recip_arith_state64
+{
+    typedef recip_arith64_encoder encoder;
+    typedef recip_arith64_decoder decoder;
+
+    static recip_arith_inline void encoder_start(encoder * ac,uint8_t * ptr) { recip_arith64_encoder_start(ac,ptr); }
+    static recip_arith_inline void encoder_renorm(encoder * ac) { recip_arith64_encoder_renorm(ac); }
+    static recip_arith_inline uint8_t * encoder_finish(encoder * ac) { return recip_arith64_encoder_finish(ac); }
+
+    static recip_arith_inline void decoder_start(decoder * ac,const uint8_t * ptr) { recip_arith64_decoder_start(ac,ptr); }
+    static recip_arith_inline void decoder_renorm(decoder * ac) { recip_arith64_decoder_renorm32(ac); }
+};
+
+//=========================================================================================
+// maps , overloaded on the state
+
+struct recip_arith_map_recip
+{
+    static recip_arith_inline void put(recip_arith_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits) { recip_arith_encoder_put(ac,cdf_low,cdf_freq,cdf_bits); }
+    static recip_arith_inline uint32_t peek(recip_arith_decoder * ac,uint32_t cdf_bits) { return recip_arith_decoder_peek(ac,cdf_bits); }
+    static recip_arith_inline void remove(recip_arith_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t) { recip_arith_decoder_remove(ac,cdf_low,cdf_freq); }
+
+    static recip_arith_inline void put(recip_arith64_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits) { recip_arith64_encoder_put(ac,cdf_low,cdf_freq,cdf_bits); }
+    static recip_arith_inline uint32_t peek(recip_arith64_decoder * ac,uint32_t cdf_bits) { return recip_arith64_decoder_peek(ac,cdf_bits); }
+    static recip_arith_inline void remove(recip_arith64_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t) { recip_arith64_decoder_remove(ac,cdf_low,cdf_freq); }
+};
+
+struct recip_arith_map_rangecoder
+{
+    static recip_arith_inline void put(recip_arith_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits) { recip_arith_encoder_put_rangecoder(ac,cdf_low,cdf_freq,cdf_bits); }
+    static recip_arith_inline uint32_t peek(recip_arith_decoder * ac,uint32_t cdf_bits) { return recip_arith_decoder_peek_rangecoder(ac,cdf_bits); }
+    static recip_arith_inline void remove(recip_arith_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t) { recip_arith_decoder_remove_rangecoder(ac,cdf_low,cdf_freq); }
+
+    static recip_arith_inline void put(recip_arith64_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits) { recip_arith64_encoder_put_rangecoder(ac,cdf_low,cdf_freq,cdf_bits); }
+    static recip_arith_inline uint32_t peek(recip_arith64_decoder * ac,uint32_t cdf_bits) { return recip_arith64_decoder_peek_rangecoder(ac,cdf_bits); }
+    static recip_arith_inline void remove(recip_arith64_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t) { recip_arith64_decoder_remove_rangecoder(ac,cdf_low,cdf_freq); }
+};
+
+struct recip_arith_map_cacm87
+{
+    static recip_arith_inline void put(recip_arith_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits) { recip_arith_encoder_put_cacm87(ac,cdf_low,cdf_freq,cdf_bits); }
+    static recip_arith_inline uint32_t peek(recip_arith_decoder * ac,uint32_t cdf_bits) { return recip_arith_decoder_peek_cacm87(ac,cdf_bits); }
+    static recip_arith_inline void remove(recip_arith_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits) { recip_arith_decoder_remove_cacm87(ac,cdf_low,cdf_freq,cdf_bits); }
+
+    static recip_arith_inline void put(recip_arith64_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits) { recip_arith64_encoder_put_cacm87(ac,cdf_low,cdf_freq,cdf_bits); }
+    static recip_arith_inline uint32_t peek(recip_arith64_decoder * ac,uint32_t cdf_bits) { return recip_arith64_decoder_peek_cacm87(ac,cdf_bits); }
+    static recip_arith_inline void remove(recip_arith64_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits) { recip_arith64_decoder_remove_cacm87(ac,cdf_low,cdf_freq,cdf_bits); }
+};
+
+struct recip_arith_map_sm98
+{
+    static recip_arith_inline void put(recip_arith_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits) { recip_arith_encoder_put_sm98(ac,cdf_low,cdf_freq,cdf_bits); }
+    static recip_arith_inline uint32_t peek(recip_arith_decoder * ac,uint32_t cdf_bits) { return recip_arith_decoder_peek_sm98(ac,cdf_bits); }
+    static recip_arith_inline void remove(recip_arith_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits) { recip_arith_decoder_remove_sm98(ac,cdf_low,cdf_freq,cdf_bits); }
+
+    static recip_arith_inline void put(recip_arith64_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits) { recip_arith64_encoder_put_sm98(ac,cdf_low,cdf_freq,cdf_bits); }
+    static recip_arith_inline uint32_t peek(recip_arith64_decoder * ac,uint32_t cdf_bits) { return recip_arith64_decoder_peek_sm98(ac,cdf_bits); }
+    static recip_arith_inline void remove(recip_arith64_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits) { recip_arith64_decoder_remove_sm98(ac,cdf_low,cdf_freq,cdf_bits); }
+};
+
+//=========================================================================================
+
+template <typename t_map,typename t_state>
+struct recip_arith_policy_coder_t : public t_state
+{
+    typedef t_map map;
+    typedef t_state state;
+    typedef typename t_state::encoder encoder;
+    typedef typename t_state::decoder decoder;
+
+    // encode a symbol with a given cdf range
+    static recip_arith_inline void put(encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits) { t_map::put(ac,cdf_low,cdf_freq,cdf_bits); }
+
+    // peek finds the target cdf currently specified (may mutate the decoder , call once)
+    static recip_arith_inline uint32_t peek(decoder * ac,uint32_t cdf_bits) { return t_map::peek(ac,cdf_bits); }
+
+    // remove the symbol found by the previous call to peek
+    static recip_arith_inline void remove(decoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits) { t_map::remove(ac,cdf_low,cdf_freq,cdf_bits); }
+
+    //-------------------------------------------------------------
+    // whole arrays of byte symbols with a static cdf[257] , and a (1<<cdf_bits)+1 decode_table for decoding
+
+    // returns the end of the stream
+    static uint8_t * encode(uint8_t * comp,const uint8_t * syms,size_t count,const uint32_t * cdf,uint32_t cdf_bits)
+    {
+        encoder enc;
+        t_state::encoder_start(&enc,comp);
+
+        for(size_t i=0;i<count;i++)
+        {
+            uint32_t sym = syms[i];
+            uint32_t low = cdf[sym];
+            put(&enc,low,cdf[sym+1] - low,cdf_bits);
+            t_state::encoder_renorm(&enc);
+        }
+
+        return t_state::encoder_finish(&enc);
+    }
+
+    static void decode(uint8_t * syms,size_t count,const uint8_t * comp,const uint32_t * cdf,const uint8_t * decode_table,uint32_t cdf_bits)
+    {
+        decoder dec;
+        t_state::decoder_start(&dec,comp);
+
+        for(size_t i=0;i<count;i++)
+        {
+            uint32_t target = peek(&dec,cdf_bits);
+            uint32_t sym = decode_table[target];
+            syms[i] = (uint8_t) sym;
+            uint32_t low = cdf[sym];
+            remove(&dec,low,cdf[sym+1] - low,cdf_bits);
+            t_state::decoder_renorm(&dec);
+        }
+    }
+};
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_POLICY_H
@@ -0,0 +1,321 @@
+#pragma once
+/**
+recip_arith_reference_maps.h
+other cdf->range maps on the recip_arith encoder & decoder states , for comparison
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_REFERENCE_MAPS_H
+#define RECIP_ARITH_REFERENCE_MAPS_H
+
+#include "recip_arith.h"
+
+/**
+
+the range coder map is in recip_arith.h (recip_arith_encoder_put_rangecoder)
+these are the other maps that test_recip_arith and bench_recip_arith compare against ;
+they use the same recip_arith_encoder / recip_arith_decoder states & renorms
+
+at the bottom are all three on the recip_arith64_encoder / recip_arith64_decoder states ;
+recip_arith_policy.h puts every map on either state behind one interface
+
+**/
+
+#define RECIP_ARITH_MAX(a,b)    (((a) > (b)) ? (a) : (b))
+#define RECIP_ARITH_MIN(a,b)    (((a) < (b)) ? (a) : (b))
+
+//=========================================================================================
+
+// cacm87 : the exact map , lo = (cdf_low * range) >> cdf_bits , decoder needs a divide
+
+// encode a symbol with a given cdf range
+static recip_arith_inline void recip_arith_encoder_put_cacm87(recip_arith_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits)
+{
+    recip_arith_assert( (cdf_low + cdf_freq) <= ((uint32_t)1<<cdf_bits) );
+    recip_arith_assert( cdf_freq > 0 );
+    recip_arith_assert( ac->range >= ((uint32_t)1<<cdf_bits) );
+    
+    uint32_t lo = (uint32_t)( ((uint64_t)cdf_low * ac->range) >> cdf_bits);
+    uint32_t hi = (uint32_t)( ((uint64_t)(cdf_low + cdf_freq) * ac->range) >> cdf_bits);
+    
+    uint32_t save_low = ac->low;
+    ac->low += lo;
+    ac->range = hi - lo;    
+    if ( ac->low < save_low ) recip_arith_encoder_carry(ac);
+}
+
+// peek finds the target cdf currently specified (mutates decoder)
+static recip_arith_inline uint32_t recip_arith_decoder_peek_cacm87(recip_arith_decoder * ac,uint32_t cdf_bits)
+{
+    recip_arith_assert( ac->range >= ((uint32_t)1<<cdf_bits) );
+    
+    uint32_t target = (uint32_t)( ((((uint64_t)ac->code) << cdf_bits) + ((uint64_t)1<<cdf_bits) - 1 ) / ac->range );
+    recip_arith_assert( target <= ((uint32_t)1<<cdf_bits) );
+    return target;
+}
+
+// remove the symbol found by the previous call to peek
+static recip_arith_inline void recip_arith_decoder_remove_cacm87(recip_arith_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq,int cdf_bits)
+{
+    uint32_t lo = (uint32_t)( ((uint64_t)cdf_low * ac->range) >> cdf_bits);
+    uint32_t hi = (uint32_t)( ((uint64_t)(cdf_low + cdf_freq) * ac->range) >> cdf_bits);
+    ac->code -= lo;
+    ac->range = hi - lo;
+}
+
+//=========================================================================================
+
+// sm98 : Stuiver & Moffat 1998 , the bottom of range gets 1X and the top 2X , no multiply or divide
+
+// encode a symbol with a given cdf range
+static recip_arith_inline void recip_arith_encoder_put_sm98(recip_arith_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits)
+{
+    recip_arith_assert( (cdf_low + cdf_freq) <= ((uint32_t)1<<cdf_bits) );
+    recip_arith_assert( cdf_freq > 0 );
+    recip_arith_assert( ac->range >= ((uint32_t)1<<cdf_bits) );
+    
+    // need to find the top bit position of range
+    // an alternative implementation is to keep range left-justified
+    //  so that r_bits is always 31 and bits free varies in [0-7] at the bottom
+    uint32_t range = ac->range;
+    int range_clz = clz32(range);
+    int r_bits = 31-range_clz;
+    int cdf_to_r_shift = r_bits - cdf_bits;
+    
+    // 2<<r_bits can be 2^32 , be careful of 32 bit vars
+    //  and we need that to be compared with sign (eg. not wrapping in 32-bit)
+    //  so bump up to signed S64
+        
+    int64_t threshold = ((int64_t)2<<r_bits) - range;
+    
+    uint32_t lo = cdf_low << cdf_to_r_shift;
+    uint32_t hi = (cdf_low + cdf_freq) << cdf_to_r_shift;
+    
+    // use MAX of two mappings; 1X from the bottom or 2X down from the top :
+    //  MAX( lo , range - 2*(cdf_tot - low) )
+    // some algebra can factor that into just a satsub and add :
+    
+    lo += (uint32_t) RECIP_ARITH_MAX(0, (int64_t)lo - threshold);
+    hi += (uint32_t) RECIP_ARITH_MAX(0, (int64_t)hi - threshold);
+    
+    recip_arith_assert( hi > lo && hi <= range );
+    
+    uint32_t save_low = ac->low;
+    ac->low += lo;
+    ac->range = hi - lo;    
+    if ( ac->low < save_low ) recip_arith_encoder_carry(ac);
+}
+
+/**
+
+sm98 decoder
+
+with v = cdf << cdf_to_r_shift the map is f(v) = v + MAX(0 , v - threshold) = MAX( v , 2v - threshold ) ,
+which is monotone , so the target is the largest cdf with f(v) <= code :
+
+    f(v) <= x  <=>  v <= x  and  v <= (x + threshold)/2
+    target = MIN( x >> cdf_to_r_shift , ((x + threshold)>>1) >> cdf_to_r_shift )
+
+still no multiply or divide ; peek does not change the decoder , remove recomputes the map from range
+
+**/
+
+// peek finds the target cdf currently specified
+static recip_arith_inline uint32_t recip_arith_decoder_peek_sm98(recip_arith_decoder * ac,uint32_t cdf_bits)
+{
+    recip_arith_assert( ac->range >= ((uint32_t)1<<cdf_bits) );
+    
+    uint32_t range = ac->range;
+    int r_bits = 31-clz32(range);
+    int cdf_to_r_shift = r_bits - cdf_bits;
+    
+    // code + threshold can pass 2^32 :
+    uint64_t threshold = ((uint64_t)2<<r_bits) - range;
+    uint64_t code = ac->code;
+    
+    uint32_t target = (uint32_t) RECIP_ARITH_MIN( code >> cdf_to_r_shift , ((code + threshold)>>1) >> cdf_to_r_shift );
+    recip_arith_assert( target < ((uint32_t)1<<cdf_bits) );
+    return target;
+}
+
+// remove the symbol found by the previous call to peek
+static recip_arith_inline void recip_arith_decoder_remove_sm98(recip_arith_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits)
+{
+    uint32_t range = ac->range;
+    int r_bits = 31-clz32(range);
+    int cdf_to_r_shift = r_bits - cdf_bits;
+    int64_t threshold = ((int64_t)2<<r_bits) - range;
+    
+    uint32_t lo = cdf_low << cdf_to_r_shift;
+    uint32_t hi = (cdf_low + cdf_freq) << cdf_to_r_shift;
+    lo += (uint32_t) RECIP_ARITH_MAX(0, (int64_t)lo - threshold);
+    hi += (uint32_t) RECIP_ARITH_MAX(0, (int64_t)hi - threshold);
+    
+    ac->code -= lo;
+    ac->range = hi - lo;
+}
+
+//=========================================================================================
+
+/**
+
+64-bit state versions : recip_arith64_encoder / recip_arith64_decoder , range >= (1<<32) after any of their renorms.
+
+these are not the 32-bit bitstreams (the maps see all 64 bits of range) ,
+unlike recip_arith64_encoder_put , whose map only looks at the top bits of range.
+for the same reason the decoder must renorm like the encoder : recip_arith64_decoder_renorm32 .
+
+the 64-bit products need more than 64 bits , so :
+    cacm87 splits range into (range >> cdf_bits) and the low cdf_bits ,
+        and the decoder's divide is a 64-bit divide by (range >> cdf_bits) , which can only overshoot ,
+        followed by stepping down while the encoder's lo is past code (at most a step or two)
+    sm98 computes threshold mod 2^64 (2<<63 wraps to 0 , the true value fits)
+        and halves code + threshold without forming the 65-bit sum
+
+**/
+
+// rangecoder
+
+static recip_arith_inline void recip_arith64_encoder_put_rangecoder(recip_arith64_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits)
+{
+    recip_arith_assert( (cdf_low + cdf_freq) <= ((uint32_t)1<<cdf_bits) );
+    recip_arith_assert( cdf_freq > 0 );
+    recip_arith_assert( ac->range >= ((uint64_t)1<<cdf_bits) );
+
+    uint64_t save_low = ac->low;
+    
+    uint64_t r_norm = ac->range >> cdf_bits;
+    ac->low += cdf_low * r_norm;
+    ac->range = cdf_freq * r_norm;
+    
+    if ( ac->low < save_low ) recip_arith64_encoder_carry(ac);
+}
+
+static recip_arith_inline uint32_t recip_arith64_decoder_peek_rangecoder(recip_arith64_decoder * ac,uint32_t cdf_bits)
+{
+    recip_arith_assert( ac->range >= ((uint64_t)1<<cdf_bits) );
+    
+    uint64_t r_norm = ac->range >> cdf_bits;
+    uint32_t target = (uint32_t)( ac->code / r_norm );
+    ac->range = r_norm; // store for "remove" stage
+    recip_arith_assert( target <= ((uint32_t)1<<cdf_bits) );
+    return target;
+}
+
+static recip_arith_inline void recip_arith64_decoder_remove_rangecoder(recip_arith64_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq)
+{
+    uint64_t r_norm = ac->range; // == range >> cdf_bits
+    ac->code -= cdf_low * r_norm;
+    ac->range = cdf_freq * r_norm;
+}
+
+// cacm87
+
+// floor( cdf * range / 2^cdf_bits ) without a 128-bit product
+static recip_arith_inline uint64_t recip_arith64_cacm87_scale(uint64_t range,uint32_t cdf,uint32_t cdf_bits)
+{
+    uint64_t range_mask = ((uint64_t)1<<cdf_bits) - 1;
+    return cdf * (range >> cdf_bits) + ((cdf * (range & range_mask)) >> cdf_bits);
+}
+
+static recip_arith_inline void recip_arith64_encoder_put_cacm87(recip_arith64_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits)
+{
+    recip_arith_assert( (cdf_low + cdf_freq) <= ((uint32_t)1<<cdf_bits) );
+    recip_arith_assert( cdf_freq > 0 );
+    recip_arith_assert( ac->range >= ((uint64_t)1<<cdf_bits) );
+    
+    uint64_t lo = recip_arith64_cacm87_scale(ac->range,cdf_low,cdf_bits);
+    uint64_t hi = recip_arith64_cacm87_scale(ac->range,cdf_low + cdf_freq,cdf_bits);
+    
+    uint64_t save_low = ac->low;
+    ac->low += lo;
+    ac->range = hi - lo;    
+    if ( ac->low < save_low ) recip_arith64_encoder_carry(ac);
+}
+
+static recip_arith_inline uint32_t recip_arith64_decoder_peek_cacm87(recip_arith64_decoder * ac,uint32_t cdf_bits)
+{
+    recip_arith_assert( ac->range >= ((uint64_t)1<<32) );
+    
+    // (range >> cdf_bits) <= range / 2^cdf_bits , so this is >= the exact target :
+    uint64_t estimate = ac->code / (ac->range >> cdf_bits);
+    uint32_t target = (uint32_t) RECIP_ARITH_MIN( estimate , ((uint64_t)1<<cdf_bits) - 1 );
+    while ( recip_arith64_cacm87_scale(ac->range,target,cdf_bits) > ac->code )
+        target--;
+    
+    return target;
+}
+
+static recip_arith_inline void recip_arith64_decoder_remove_cacm87(recip_arith64_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits)
+{
+    uint64_t lo = recip_arith64_cacm87_scale(ac->range,cdf_low,cdf_bits);
+    uint64_t hi = recip_arith64_cacm87_scale(ac->range,cdf_low + cdf_freq,cdf_bits);
+    ac->code -= lo;
+    ac->range = hi - lo;
+}
+
+// sm98
+
+static recip_arith_inline void recip_arith64_encoder_put_sm98(recip_arith64_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits)
+{
+    recip_arith_assert( (cdf_low + cdf_freq) <= ((uint32_t)1<<cdf_bits) );
+    recip_arith_assert( cdf_freq > 0 );
+    recip_arith_assert( ac->range >= ((uint64_t)1<<cdf_bits) );
+    
+    uint64_t range = ac->range;
+    int r_bits = 63-clz64(range);
+    int cdf_to_r_shift = r_bits - cdf_bits;
+    uint64_t threshold = ((uint64_t)2<<r_bits) - range;
+    
+    uint64_t lo = (uint64_t)cdf_low << cdf_to_r_shift;
+    uint64_t hi = (uint64_t)(cdf_low + cdf_freq) << cdf_to_r_shift;
+    lo += ( lo > threshold ) ? lo - threshold : 0;
+    hi += ( hi > threshold ) ? hi - threshold : 0;
+    
+    recip_arith_assert( hi > lo && hi <= range );
+    
+    uint64_t save_low = ac->low;
+    ac->low += lo;
+    ac->range = hi - lo;    
+    if ( ac->low < save_low ) recip_arith64_encoder_carry(ac);
+}
+
+static recip_arith_inline uint32_t recip_arith64_decoder_peek_sm98(recip_arith64_decoder * ac,uint32_t cdf_bits)
+{
+    recip_arith_assert( ac->range >= ((uint64_t)1<<cdf_bits) );
+    
+    uint64_t range = ac->range;
+    int r_bits = 63-clz64(range);
+    int cdf_to_r_shift = r_bits - cdf_bits;
+    uint64_t threshold = ((uint64_t)2<<r_bits) - range;
+    uint64_t code = ac->code;
+    
+    uint64_t half_sum = (code>>1) + (threshold>>1) + (code & threshold & 1);
+    uint32_t target = (uint32_t) RECIP_ARITH_MIN( code >> cdf_to_r_shift , half_sum >> cdf_to_r_shift );
+    recip_arith_assert( target < ((uint32_t)1<<cdf_bits) );
+    return target;
+}
+
+static recip_arith_inline void recip_arith64_decoder_remove_sm98(recip_arith64_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits)
+{
+    uint64_t range = ac->range;
+    int r_bits = 63-clz64(range);
+    int cdf_to_r_shift = r_bits - cdf_bits;
+    uint64_t threshold = ((uint64_t)2<<r_bits) - range;
+    
+    uint64_t lo = (uint64_t)cdf_low << cdf_to_r_shift;
+    uint64_t hi = (uint64_t)(cdf_low + cdf_freq) << cdf_to_r_shift;
+    lo += ( lo > threshold ) ? lo - threshold : 0;
+    hi += ( hi > threshold ) ? hi - threshold : 0;
+    
+    ac->code -= lo;
+    ac->range = hi - lo;
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_REFERENCE_MAPS_H
@@ -0,0 +1,311 @@
+#pragma once
+/**
+recip_arith_simd.h
+8-lane AVX2 and 16-lane AVX-512 recip_arith decoders
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_SIMD_H
+#define RECIP_ARITH_SIMD_H
+
+#include "recip_arith_interleaved.h"
+
+//=========================================================================================
+
+/**
+
+recip_arith_decoder_peek has no divide , only clz , shifts , a table lookup and a 32x32->64 multiply ,
+so unlike the range coder it can be run on all SIMD lanes at once.
+
+The SIMD decoders read the recip_arith_interleaved.h stream layout with 8 (AVX2) or 16 (AVX-512) lanes ,
+one coder state per vector lane.  The encoder is recip_arith_interleaved_encode with the same lane count ,
+and recip_arith_interleaved_decode with the same lane count is the scalar reference.
+
+per symbol each lane does :
+    clz of range (float exponent on AVX2 , vplzcntd on AVX-512)
+    gather from recip_arith_table , multiply-high
+    gather from decode_table , gather cdf[sym] and cdf[sym+1]
+    remove , then branchless renorm with a gather of the next 4 stream bytes
+
+decode_table is gathered 4 bytes at a time, so it needs RECIP_ARITH_SIMD_DECODE_TABLE_PADDING
+readable bytes past the last entry : allocate (1<<cdf_bits) + RECIP_ARITH_SIMD_DECODE_TABLE_PADDING
+the stream needs RECIP_ARITH_INTERLEAVE_TAIL_PADDING readable bytes past its end
+stream offsets are gathered with 32-bit indices , so streams must be under 2 GB
+
+these are compiled in when the target supports them (eg. -mavx2 , -mavx512f -mavx512cd -mavx512bw) ,
+or when RECIP_ARITH_SIMD_AVX2_TARGET / RECIP_ARITH_SIMD_AVX512_TARGET are defined before including ;
+those are put on each function (eg. __attribute__((target("avx2")))) so one translation unit
+can carry the vector decoders without the whole build assuming the instruction set ,
+see recip_arith_dispatch.cpp
+
+**/
+
+#define RECIP_ARITH_SIMD_DECODE_TABLE_PADDING   (4)
+
+#if defined(RECIP_ARITH_SIMD_AVX2_TARGET)
+#define RECIP_ARITH_SIMD_AVX2
+#elif defined(__AVX2__)
+#define RECIP_ARITH_SIMD_AVX2
+#define RECIP_ARITH_SIMD_AVX2_TARGET
+#endif
+
+#if defined(RECIP_ARITH_SIMD_AVX512_TARGET)
+#define RECIP_ARITH_SIMD_AVX512
+#elif defined(__AVX512F__) && defined(__AVX512CD__) && defined(__AVX512BW__)
+#define RECIP_ARITH_SIMD_AVX512
+#define RECIP_ARITH_SIMD_AVX512_TARGET
+#endif
+
+#if defined(RECIP_ARITH_SIMD_AVX2) || defined(RECIP_ARITH_SIMD_AVX512)
+#include <immintrin.h>
+#endif
+
+//=========================================================================================
+
+#ifdef RECIP_ARITH_SIMD_AVX2
+
+#define RECIP_ARITH_AVX2_LANES  (8)
+
+static RECIP_ARITH_SIMD_AVX2_TARGET recip_arith_inline __m256i recip_arith_avx2_bswap32(__m256i v)
+{
+    const __m256i shuf = _mm256_setr_epi8(
+        3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12,
+        3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12 );
+    return _mm256_shuffle_epi8(v,shuf);
+}
+
+// high 32 bits of the 32x32->64 product in each lane
+static RECIP_ARITH_SIMD_AVX2_TARGET recip_arith_inline __m256i recip_arith_avx2_mulhi_epu32(__m256i a,__m256i b)
+{
+    __m256i even = _mm256_srli_epi64( _mm256_mul_epu32(a,b) , 32 );
+    __m256i odd = _mm256_mul_epu32( _mm256_srli_epi64(a,32) , _mm256_srli_epi64(b,32) );
+    return _mm256_blend_epi32(even,odd,0xAA);
+}
+
+// unsigned a < b in each lane , as 0 / -1
+static RECIP_ARITH_SIMD_AVX2_TARGET recip_arith_inline __m256i recip_arith_avx2_cmplt_epu32(__m256i a,__m256i b)
+{
+    const __m256i sign = _mm256_set1_epi32((int)0x80000000);
+    return _mm256_cmpgt_epi32( _mm256_xor_si256(b,sign) , _mm256_xor_si256(a,sign) );
+}
+
+// decode count symbols from a stream made by recip_arith_interleaved_encode with 8 lanes
+static RECIP_ARITH_SIMD_AVX2_TARGET inline void recip_arith_avx2_decode(uint8_t * syms,size_t count,
+        const uint8_t * ptr,
+        const uint32_t * cdf,const uint8_t * decode_table,uint32_t cdf_bits)
+{
+    recip_arith_assert( recip_arith_table[(1<<RECIP_ARITH_TABLE_BITS)-1] != 0 ); // call recip_arith_table_init
+
+    recip_arith_decoder dec[RECIP_ARITH_AVX2_LANES];
+    recip_arith_interleaved_decoder_start(dec,RECIP_ARITH_AVX2_LANES,ptr);
+
+    uint32_t lane_code[RECIP_ARITH_AVX2_LANES];
+    uint32_t lane_range[RECIP_ARITH_AVX2_LANES];
+    int32_t lane_offset[RECIP_ARITH_AVX2_LANES];
+    for(int lane=0;lane<RECIP_ARITH_AVX2_LANES;lane++)
+    {
+        lane_code[lane] = dec[lane].code;
+        lane_range[lane] = dec[lane].range;
+        lane_offset[lane] = (int32_t)(dec[lane].ptr - ptr);
+    }
+
+    __m256i code = _mm256_loadu_si256((const __m256i *)lane_code);
+    __m256i range = _mm256_loadu_si256((const __m256i *)lane_range);
+    __m256i offset = _mm256_loadu_si256((const __m256i *)lane_offset);
+
+    // range >= (1<<24) at peek , so (range>>8) converts to float exactly
+    //  and its exponent gives the top bit position of range
+    // shift_r = top bit + 1 - RECIP_ARITH_TABLE_BITS = exponent field - (118 + RECIP_ARITH_TABLE_BITS)
+    const __m256i exponent_bias = _mm256_set1_epi32(118 + RECIP_ARITH_TABLE_BITS);
+    const __m256i v_cdf_bits = _mm256_set1_epi32((int)cdf_bits);
+    const __m256i v_32 = _mm256_set1_epi32(32);
+    const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+    const __m256i renorm_1 = _mm256_set1_epi32(1<<24);
+    const __m256i renorm_2 = _mm256_set1_epi32(1<<16);
+    const __m256i renorm_3 = _mm256_set1_epi32(1<<8);
+    // low byte of each 32-bit lane to the bottom 8 bytes :
+    const __m256i pack_shuf = _mm256_setr_epi8(
+        0,4,8,12, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1,
+        0,4,8,12, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1 );
+    const __m256i pack_perm = _mm256_setr_epi32(0,4,1,1,1,1,1,1);
+
+    const int * recip_base = (const int *)recip_arith_table;
+    const int * decode_base = (const int *)decode_table;
+    const int * cdf_low_base = (const int *)cdf;
+    const int * cdf_high_base = (const int *)(cdf+1);
+    const int * stream_base = (const int *)ptr;
+
+    size_t i = 0;
+    for(;i+RECIP_ARITH_AVX2_LANES<=count;i+=RECIP_ARITH_AVX2_LANES)
+    {
+        // peek :
+        __m256i exponent = _mm256_srli_epi32( _mm256_castps_si256( _mm256_cvtepi32_ps( _mm256_srli_epi32(range,8) ) ) , 23 );
+        __m256i shift_r = _mm256_sub_epi32(exponent,exponent_bias);
+        __m256i r_top = _mm256_srlv_epi32(range,shift_r);
+        __m256i shift_cdf = _mm256_sub_epi32(shift_r,v_cdf_bits);
+        __m256i r_norm = _mm256_sllv_epi32(r_top,shift_cdf);
+        __m256i code_necessary_bits = _mm256_srlv_epi32(code,shift_cdf);
+
+        __m256i recip = _mm256_i32gather_epi32(recip_base,r_top,4);
+        __m256i target = recip_arith_avx2_mulhi_epu32(code_necessary_bits,recip);
+
+        // symbol lookup :
+        __m256i sym = _mm256_and_si256( _mm256_i32gather_epi32(decode_base,target,1) , byte_mask );
+        __m256i cdf_low = _mm256_i32gather_epi32(cdf_low_base,sym,4);
+        __m256i cdf_high = _mm256_i32gather_epi32(cdf_high_base,sym,4);
+
+        // remove :
+        code = _mm256_sub_epi32(code, _mm256_mullo_epi32(cdf_low,r_norm) );
+        range = _mm256_mullo_epi32( _mm256_sub_epi32(cdf_high,cdf_low) , r_norm );
+
+        // renorm : number of bytes needed to get range back >= (1<<24)
+        __m256i neg_nbytes = _mm256_add_epi32(
+            _mm256_add_epi32( recip_arith_avx2_cmplt_epu32(range,renorm_1) , recip_arith_avx2_cmplt_epu32(range,renorm_2) ) ,
+            recip_arith_avx2_cmplt_epu32(range,renorm_3) );
+        __m256i nbytes = _mm256_sub_epi32(_mm256_setzero_si256(),neg_nbytes);
+        __m256i shift = _mm256_slli_epi32(nbytes,3);
+
+        __m256i next_word = recip_arith_avx2_bswap32( _mm256_i32gather_epi32(stream_base,offset,1) );
+        // srlv by 32 gives 0 , so nbytes == 0 is fine :
+        code = _mm256_or_si256( _mm256_sllv_epi32(code,shift) , _mm256_srlv_epi32(next_word, _mm256_sub_epi32(v_32,shift) ) );
+        range = _mm256_sllv_epi32(range,shift);
+        offset = _mm256_add_epi32(offset,nbytes);
+
+        // output :
+        __m256i packed = _mm256_permutevar8x32_epi32( _mm256_shuffle_epi8(sym,pack_shuf) , pack_perm );
+        _mm_storel_epi64((__m128i *)(syms+i), _mm256_castsi256_si128(packed) );
+    }
+
+    // tail : back to the scalar lane decoders
+    _mm256_storeu_si256((__m256i *)lane_code,code);
+    _mm256_storeu_si256((__m256i *)lane_range,range);
+    _mm256_storeu_si256((__m256i *)lane_offset,offset);
+
+    for(int lane=0;i<count;i++,lane++)
+    {
+        recip_arith_decoder * ac = &dec[lane];
+        ac->code = lane_code[lane];
+        ac->range = lane_range[lane];
+        ac->ptr = ptr + lane_offset[lane];
+
+        uint32_t target = recip_arith_decoder_peek(ac,cdf_bits);
+        uint8_t sym = decode_table[target];
+        syms[i] = sym;
+        uint32_t low = cdf[sym];
+        uint32_t freq = cdf[sym+1] - low;
+        recip_arith_decoder_remove(ac,low,freq);
+    }
+}
+
+#endif // RECIP_ARITH_SIMD_AVX2
+
+//=========================================================================================
+
+#ifdef RECIP_ARITH_SIMD_AVX512
+
+#define RECIP_ARITH_AVX512_LANES    (16)
+
+// high 32 bits of the 32x32->64 product in each lane
+static RECIP_ARITH_SIMD_AVX512_TARGET recip_arith_inline __m512i recip_arith_avx512_mulhi_epu32(__m512i a,__m512i b)
+{
+    __m512i even = _mm512_srli_epi64( _mm512_mul_epu32(a,b) , 32 );
+    __m512i odd = _mm512_mul_epu32( _mm512_srli_epi64(a,32) , _mm512_srli_epi64(b,32) );
+    return _mm512_mask_blend_epi32(0xAAAA,even,odd);
+}
+
+// decode count symbols from a stream made by recip_arith_interleaved_encode with 16 lanes
+static RECIP_ARITH_SIMD_AVX512_TARGET inline void recip_arith_avx512_decode(uint8_t * syms,size_t count,
+        const uint8_t * ptr,
+        const uint32_t * cdf,const uint8_t * decode_table,uint32_t cdf_bits)
+{
+    recip_arith_assert( recip_arith_table[(1<<RECIP_ARITH_TABLE_BITS)-1] != 0 ); // call recip_arith_table_init
+
+    recip_arith_decoder dec[RECIP_ARITH_AVX512_LANES];
+    recip_arith_interleaved_decoder_start(dec,RECIP_ARITH_AVX512_LANES,ptr);
+
+    uint32_t lane_code[RECIP_ARITH_AVX512_LANES];
+    uint32_t lane_range[RECIP_ARITH_AVX512_LANES];
+    int32_t lane_offset[RECIP_ARITH_AVX512_LANES];
+    for(int lane=0;lane<RECIP_ARITH_AVX512_LANES;lane++)
+    {
+        lane_code[lane] = dec[lane].code;
+        lane_range[lane] = dec[lane].range;
+        lane_offset[lane] = (int32_t)(dec[lane].ptr - ptr);
+    }
+
+    __m512i code = _mm512_loadu_si512(lane_code);
+    __m512i range = _mm512_loadu_si512(lane_range);
+    __m512i offset = _mm512_loadu_si512(lane_offset);
+
+    const __m512i shift_r_base = _mm512_set1_epi32(32 - RECIP_ARITH_TABLE_BITS);
+    const __m512i v_cdf_bits = _mm512_set1_epi32((int)cdf_bits);
+    const __m512i v_32 = _mm512_set1_epi32(32);
+    const __m512i byte_mask = _mm512_set1_epi32(0xFF);
+    const __m512i bswap_shuf = _mm512_broadcast_i32x4( _mm_setr_epi8(3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12) );
+
+    size_t i = 0;
+    for(;i+RECIP_ARITH_AVX512_LANES<=count;i+=RECIP_ARITH_AVX512_LANES)
+    {
+        // peek :
+        __m512i shift_r = _mm512_sub_epi32(shift_r_base, _mm512_lzcnt_epi32(range) );
+        __m512i r_top = _mm512_srlv_epi32(range,shift_r);
+        __m512i shift_cdf = _mm512_sub_epi32(shift_r,v_cdf_bits);
+        __m512i r_norm = _mm512_sllv_epi32(r_top,shift_cdf);
+        __m512i code_necessary_bits = _mm512_srlv_epi32(code,shift_cdf);
+
+        __m512i recip = _mm512_i32gather_epi32(r_top,recip_arith_table,4);
+        __m512i target = recip_arith_avx512_mulhi_epu32(code_necessary_bits,recip);
+
+        // symbol lookup :
+        __m512i sym = _mm512_and_si512( _mm512_i32gather_epi32(target,decode_table,1) , byte_mask );
+        __m512i cdf_low = _mm512_i32gather_epi32(sym,cdf,4);
+        __m512i cdf_high = _mm512_i32gather_epi32(sym,cdf+1,4);
+
+        // remove :
+        code = _mm512_sub_epi32(code, _mm512_mullo_epi32(cdf_low,r_norm) );
+        range = _mm512_mullo_epi32( _mm512_sub_epi32(cdf_high,cdf_low) , r_norm );
+
+        // renorm :
+        __m512i nbytes = _mm512_srli_epi32( _mm512_lzcnt_epi32(range) , 3 );
+        __m512i shift = _mm512_slli_epi32(nbytes,3);
+
+        __m512i next_word = _mm512_shuffle_epi8( _mm512_i32gather_epi32(offset,ptr,1) , bswap_shuf );
+        // srlv by 32 gives 0 , so nbytes == 0 is fine :
+        code = _mm512_or_si512( _mm512_sllv_epi32(code,shift) , _mm512_srlv_epi32(next_word, _mm512_sub_epi32(v_32,shift) ) );
+        range = _mm512_sllv_epi32(range,shift);
+        offset = _mm512_add_epi32(offset,nbytes);
+
+        // output :
+        _mm_storeu_si128((__m128i *)(syms+i), _mm512_cvtepi32_epi8(sym) );
+    }
+
+    // tail : back to the scalar lane decoders
+    _mm512_storeu_si512(lane_code,code);
+    _mm512_storeu_si512(lane_range,range);
+    _mm512_storeu_si512(lane_offset,offset);
+
+    for(int lane=0;i<count;i++,lane++)
+    {
+        recip_arith_decoder * ac = &dec[lane];
+        ac->code = lane_code[lane];
+        ac->range = lane_range[lane];
+        ac->ptr = ptr + lane_offset[lane];
+
+        uint32_t target = recip_arith_decoder_peek(ac,cdf_bits);
+        uint8_t sym = decode_table[target];
+        syms[i] = sym;
+        uint32_t low = cdf[sym];
+        uint32_t freq = cdf[sym+1] - low;
+        recip_arith_decoder_remove(ac,low,freq);
+    }
+}
+
+#endif // RECIP_ARITH_SIMD_AVX512
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_SIMD_H
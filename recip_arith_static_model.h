@@ -0,0 +1,92 @@
+#pragma once
+/**
+recip_arith_static_model.h
+normalizing symbol counts to a static cdf for recip_arith
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_STATIC_MODEL_H
+#define RECIP_ARITH_STATIC_MODEL_H
+
+#include "recip_arith.h"
+
+//=========================================================================================
+
+/**
+
+recip_arith_normalize_counts scales counts[num_syms] to freqs that sum to exactly (1<<cdf_bits) ,
+keeping every symbol with a nonzero count at freq >= 1.
+
+counts are scaled with rounding , then the leftover error is taken from (or given to) the largest freqs.
+for correct normalization see : http://cbloomrants.blogspot.com/2014/02/02-11-14-understanding-ans-10.html
+this is the simple version ; it costs a little vs. optimal on very sparse histograms.
+
+returns false if it can't be done (no counts , or more used symbols than 1<<cdf_bits)
+
+**/
+
+static inline bool recip_arith_normalize_counts(uint32_t * freqs,const uint32_t * counts,int num_syms,uint32_t cdf_bits)
+{
+    const uint32_t cdf_tot = (uint32_t)1<<cdf_bits;
+
+    uint64_t count_tot = 0;
+    uint32_t num_used = 0;
+    for(int i=0;i<num_syms;i++)
+    {
+        count_tot += counts[i];
+        num_used += ( counts[i] != 0 );
+    }
+    if ( count_tot == 0 || num_used > cdf_tot ) return false;
+
+    int64_t sum = 0;
+    for(int i=0;i<num_syms;i++)
+    {
+        uint32_t c = counts[i];
+        if ( c == 0 ) { freqs[i] = 0; continue; }
+        uint64_t f = ( ((uint64_t)c << cdf_bits) + (count_tot/2) ) / count_tot;
+        if ( f == 0 ) f = 1;
+        freqs[i] = (uint32_t)f;
+        sum += f;
+    }
+
+    int64_t err = sum - cdf_tot;
+    while ( err != 0 )
+    {
+        int max_i = 0;
+        for(int i=1;i<num_syms;i++)
+            if ( freqs[i] > freqs[max_i] ) max_i = i;
+
+        if ( err < 0 )
+        {
+            freqs[max_i] += (uint32_t)(-err);
+            err = 0;
+        }
+        else
+        {
+            // take as much as we can from the largest ; if it's not enough go around again
+            int64_t take = freqs[max_i] - 1;
+            if ( take > err ) take = err;
+            if ( take == 0 ) return false;
+            freqs[max_i] -= (uint32_t)take;
+            err -= take;
+        }
+    }
+
+    return true;
+}
+
+// cdf[num_syms+1] from freqs ; cdf[num_syms] is the total
+static inline void recip_arith_cdf_from_freqs(uint32_t * cdf,const uint32_t * freqs,int num_syms)
+{
+    cdf[0] = 0;
+    for(int i=0;i<num_syms;i++)
+        cdf[i+1] = cdf[i] + freqs[i];
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_STATIC_MODEL_H
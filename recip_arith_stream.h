@@ -0,0 +1,259 @@
+#pragma once
+/**
+recip_arith_stream.h
+recip_arith over bounded buffers , with flush/refill callbacks
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_STREAM_H
+#define RECIP_ARITH_STREAM_H
+
+#include "recip_arith.h"
+
+#include <stddef.h>
+
+//=========================================================================================
+
+/**
+
+recip_arith_encoder needs the whole output in memory because carries walk back into written bytes ,
+and recip_arith_decoder reads past the end of whatever it's given.
+
+The stream encoder writes into a caller buffer of any size ; when it's full it hands the buffer
+to the flush callback , which returns the next buffer to fill.
+Flush can return the same buffer after consuming it , or rotate several buffers so that
+writing one out overlaps encoding the next.  Bytes are written in place , never copied.
+
+Carries can't reach bytes that have been flushed , so the encoder is a recip_arith_carryless_encoder ,
+which never changes a byte once it's written.
+While the buffer has room for everything a renorm can write , it runs the plain carryless renorm ;
+otherwise it goes byte by byte and flushes when the buffer fills.
+
+The decoder reads from chunks returned by the refill callback , in place.
+While the current chunk has 4 bytes left it uses the plain recip_arith_decoder_renorm ;
+only near the end of a chunk does it go byte by byte.
+Past the end of the input it reads zeros , so no tail padding is needed ;
+they're counted in overread , and a valid stream is read at most RECIP_ARITH_DECODER_MAX_OVERREAD
+(recip_arith_checked.h) bytes past its end , so more than that means the input was truncated.
+
+The bitstream is identical to recip_arith_encoder's.
+
+**/
+
+// hand off [buf,buf+len) ; return the next buffer to fill and its size in *p_capacity ,
+//  or NULL to abort the encode
+// on the last call from _finish the returned buffer is not used
+typedef uint8_t * (*recip_arith_stream_flush_func)(void * user,uint8_t * buf,size_t len,size_t * p_capacity);
+
+// return the next chunk of input and its size in *p_len , *p_len = 0 at the end of input
+//  the chunk must stay valid until the next refill
+typedef const uint8_t * (*recip_arith_stream_refill_func)(void * user,size_t * p_len);
+
+//=========================================================================================
+
+struct recip_arith_stream_encoder
+{
+    recip_arith_carryless_encoder enc;  // enc.ptr is the write position in buf
+
+    uint8_t * buf;
+    uint8_t * end;
+    recip_arith_stream_flush_func flush;
+    void * user;
+    bool error;
+};
+
+static inline void recip_arith_stream_encoder_start(recip_arith_stream_encoder * ac,uint8_t * buf,size_t capacity,
+                                                    recip_arith_stream_flush_func flush,void * user)
+{
+    recip_arith_assert( buf != NULL && capacity > 0 );
+
+    recip_arith_carryless_encoder_start(&ac->enc,buf);
+
+    ac->buf = buf;
+    ac->end = buf + capacity;
+    ac->flush = flush;
+    ac->user = user;
+    ac->error = false;
+}
+
+static inline void recip_arith_stream_encoder_flush(recip_arith_stream_encoder * ac)
+{
+    size_t capacity = 0;
+    uint8_t * next = ac->flush(ac->user,ac->buf,(size_t)(ac->enc.ptr - ac->buf),&capacity);
+    if ( next == NULL || capacity == 0 )
+    {
+        // keep going into the old buffer , but nothing more is handed off :
+        ac->error = true;
+        next = ac->buf;
+        capacity = (size_t)(ac->end - ac->buf);
+    }
+    ac->buf = next;
+    ac->enc.ptr = next;
+    ac->end = next + capacity;
+}
+
+static inline void recip_arith_stream_encoder_put_byte(recip_arith_stream_encoder * ac,uint32_t byte)
+{
+    if ( ac->enc.ptr == ac->end ) recip_arith_stream_encoder_flush(ac);
+    *(ac->enc.ptr)++ = (uint8_t)byte;
+}
+
+// recip_arith_carryless_encoder_shift_low , but writing through _put_byte
+static inline void recip_arith_stream_encoder_shift_low(recip_arith_stream_encoder * ac)
+{
+    recip_arith_carryless_encoder * enc = &ac->enc;
+    uint32_t carry = (uint32_t)(enc->low >> 32);
+    uint32_t top = (uint32_t)(enc->low >> 24) & 0xFF;
+
+    if ( top != 0xFF || carry )
+    {
+        if ( enc->have_cache )
+            recip_arith_stream_encoder_put_byte(ac,enc->cache + carry);
+        for(;enc->ff_count>0;enc->ff_count--)
+            recip_arith_stream_encoder_put_byte(ac,0xFF + carry);
+
+        enc->cache = top;
+        enc->have_cache = 1;
+    }
+    else
+    {
+        enc->ff_count++;
+    }
+
+    enc->low = (enc->low & 0x00FFFFFF) << 8;
+}
+
+static inline void recip_arith_stream_encoder_renorm_slow(recip_arith_stream_encoder * ac)
+{
+    while ( ac->enc.range < (1<<24) )
+    {
+        recip_arith_stream_encoder_shift_low(ac);
+        ac->enc.range <<= 8;
+    }
+}
+
+static recip_arith_inline void recip_arith_stream_encoder_renorm(recip_arith_stream_encoder * ac)
+{
+    // a renorm does at most 4 shifts , and writes at most the pending bytes plus one per shift :
+    if ( (uint64_t)(ac->end - ac->enc.ptr) >= ac->enc.ff_count + 5 )
+        recip_arith_carryless_encoder_renorm(&ac->enc);
+    else
+        recip_arith_stream_encoder_renorm_slow(ac);
+}
+
+static recip_arith_inline void recip_arith_stream_encoder_put(recip_arith_stream_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits)
+{
+    recip_arith_carryless_encoder_put(&ac->enc,cdf_low,cdf_freq,cdf_bits);
+}
+
+// write the final bytes and hand off the last partial buffer
+//  returns false if a flush failed
+static inline bool recip_arith_stream_encoder_finish(recip_arith_stream_encoder * ac)
+{
+    recip_arith_carryless_encoder * enc = &ac->enc;
+
+    // same final bytes as recip_arith_carryless_encoder_finish , but through _put_byte :
+    if ( enc->range > (1<<25) )
+    {
+        enc->low += (1<<24);
+        recip_arith_stream_encoder_shift_low(ac);
+    }
+    else
+    {
+        enc->low += (1<<16);
+        recip_arith_stream_encoder_shift_low(ac);
+        recip_arith_stream_encoder_shift_low(ac);
+    }
+
+    if ( enc->have_cache )
+        recip_arith_stream_encoder_put_byte(ac,enc->cache);
+    for(;enc->ff_count>0;enc->ff_count--)
+        recip_arith_stream_encoder_put_byte(ac,0xFF);
+    enc->have_cache = 0;
+
+    if ( ! ac->error )
+    {
+        size_t capacity = 0;
+        ac->flush(ac->user,ac->buf,(size_t)(enc->ptr - ac->buf),&capacity);
+    }
+    enc->ptr = ac->buf;
+
+    return ! ac->error;
+}
+
+//=========================================================================================
+
+struct recip_arith_stream_decoder
+{
+    recip_arith_decoder dec;    // use recip_arith_decoder_peek / _remove on this
+    const uint8_t * end;
+    recip_arith_stream_refill_func refill;
+    void * user;
+    bool eof;
+    size_t overread;            // zero bytes read past the end of input
+};
+
+static inline uint32_t recip_arith_stream_decoder_get_byte(recip_arith_stream_decoder * ac)
+{
+    while ( ac->dec.ptr == ac->end )
+    {
+        if ( ac->eof )
+        {
+            ac->overread++;
+            return 0;
+        }
+
+        size_t len = 0;
+        const uint8_t * chunk = ac->refill(ac->user,&len);
+        if ( chunk == NULL || len == 0 )
+        {
+            ac->eof = true;
+            ac->overread++;
+            return 0;
+        }
+        ac->dec.ptr = chunk;
+        ac->end = chunk + len;
+    }
+    return *(ac->dec.ptr)++;
+}
+
+static inline void recip_arith_stream_decoder_start(recip_arith_stream_decoder * ac,recip_arith_stream_refill_func refill,void * user)
+{
+    ac->dec.ptr = NULL;
+    ac->end = NULL;
+    ac->refill = refill;
+    ac->user = user;
+    ac->eof = false;
+    ac->overread = 0;
+
+    ac->dec.range = ~(uint32_t)0;
+    ac->dec.code = 0;
+    for(int i=0;i<4;i++)
+        ac->dec.code = (ac->dec.code << 8) | recip_arith_stream_decoder_get_byte(ac);
+}
+
+static inline void recip_arith_stream_decoder_renorm_slow(recip_arith_stream_decoder * ac)
+{
+    while ( ac->dec.range < (1<<24) )
+    {
+        ac->dec.code = (ac->dec.code << 8) | recip_arith_stream_decoder_get_byte(ac);
+        ac->dec.range <<= 8;
+    }
+}
+
+static recip_arith_inline void recip_arith_stream_decoder_renorm(recip_arith_stream_decoder * ac)
+{
+    // renorm reads at most 4 bytes :
+    if ( ac->end - ac->dec.ptr >= 4 )
+        recip_arith_decoder_renorm(&ac->dec);
+    else
+        recip_arith_stream_decoder_renorm_slow(ac);
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_STREAM_H
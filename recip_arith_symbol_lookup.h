@@ -0,0 +1,320 @@
+#pragma once
+/**
+recip_arith_symbol_lookup.h
+target -> symbol lookup for recip_arith decoders without a (1<<cdf_bits) decode_table
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_SYMBOL_LOOKUP_H
+#define RECIP_ARITH_SYMBOL_LOOKUP_H
+
+#include "recip_arith.h"
+
+#include <stdlib.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RECIP_ARITH_LOOKUP_SSE2
+#include <emmintrin.h>
+#endif
+
+//=========================================================================================
+
+/**
+
+After recip_arith_decoder_peek the decoder needs the sym with cdf[sym] <= target < cdf[sym+1]
+
+test_recip_arith does that with decode_table[target] , which is (1<<cdf_bits) bytes.
+That's 8k at cdf_bits = 13 and fits in L1 , but at RECIP_ARITH_MAX_CDF_BITS (16) it's 64k ,
+and with a template coder configured for more cdf_bits it's MBs and every lookup is a cache miss.
+(and it only holds 256 symbols)
+
+recip_arith_symbol_lookup picks one of :
+
+RECIP_ARITH_LOOKUP_DIRECT :
+    the plain decode_table ; (1<<cdf_bits)+1 bytes , alphabet <= 256
+    used when the table is small enough to stay in L1
+
+RECIP_ARITH_LOOKUP_SIMD :
+    count the cdf entries <= target with vector compares ; no table at all
+    work is linear in alphabet size , so only for small alphabets
+
+RECIP_ARITH_LOOKUP_BUCKETED :
+    two level : a table of ~2*num_syms buckets on the top bits of target gives the first
+    symbol in the bucket , then a short forward walk on cdf.
+    the bucket table is u16 per bucket , so alphabet <= 65536
+    average walk is about 1 step
+
+RECIP_ARITH_LOOKUP_BINARY :
+    branchless binary search on cdf ; no table , log2(num_syms) dependent loads
+    for alphabets over 65536 , or when no extra memory is wanted
+
+cdf is the caller's array of num_syms+1 entries with cdf[num_syms] = (1<<cdf_bits) ;
+it is referenced , not copied , so it must outlive the lookup.
+Zero-frequency symbols are fine , they are never returned.
+
+Targets >= cdf total (only from a corrupt stream) are clamped to the last symbol.
+
+**/
+
+enum recip_arith_lookup_strategy
+{
+    RECIP_ARITH_LOOKUP_AUTO = -1,
+    RECIP_ARITH_LOOKUP_DIRECT = 0,
+    RECIP_ARITH_LOOKUP_SIMD,
+    RECIP_ARITH_LOOKUP_BUCKETED,
+    RECIP_ARITH_LOOKUP_BINARY,
+    RECIP_ARITH_LOOKUP_COUNT
+};
+
+// largest direct decode_table that AUTO will build , in bytes (= 1<<cdf_bits)
+#ifndef RECIP_ARITH_LOOKUP_DIRECT_MAX_BYTES
+#define RECIP_ARITH_LOOKUP_DIRECT_MAX_BYTES     (1<<14)
+#endif
+
+// largest alphabet AUTO will use the SIMD compare for
+#ifndef RECIP_ARITH_LOOKUP_SIMD_MAX_SYMS
+#define RECIP_ARITH_LOOKUP_SIMD_MAX_SYMS        (32)
+#endif
+
+// largest alphabet AUTO will use buckets for ; above this , binary search
+//  even at 65536 symbols (a 256k bucket table) buckets measured 4X faster than binary search
+#ifndef RECIP_ARITH_LOOKUP_BUCKETED_MAX_SYMS
+#define RECIP_ARITH_LOOKUP_BUCKETED_MAX_SYMS    (65536)
+#endif
+
+struct recip_arith_symbol_lookup
+{
+    int strategy;
+    uint32_t num_syms;
+    uint32_t cdf_bits;
+    const uint32_t * cdf;       // num_syms+1 entries , not owned
+
+    uint8_t * direct;           // DIRECT : (1<<cdf_bits)+1 entries
+    uint16_t * buckets;         // BUCKETED : ((1<<cdf_bits)>>bucket_shift) entries
+    uint32_t bucket_shift;
+    int32_t * simd_cdf;         // SIMD : cdf[0..num_syms-1] padded with INT32_MAX to simd_count
+    uint32_t simd_count;
+};
+
+static inline const char * recip_arith_lookup_strategy_name(int strategy)
+{
+    switch(strategy)
+    {
+    case RECIP_ARITH_LOOKUP_DIRECT: return "direct";
+    case RECIP_ARITH_LOOKUP_SIMD: return "simd";
+    case RECIP_ARITH_LOOKUP_BUCKETED: return "bucketed";
+    case RECIP_ARITH_LOOKUP_BINARY: return "binary";
+    default: return "auto";
+    }
+}
+
+static inline int recip_arith_lookup_choose_strategy(uint32_t num_syms,uint32_t cdf_bits)
+{
+    if ( num_syms <= 256 && ((size_t)1<<cdf_bits) <= RECIP_ARITH_LOOKUP_DIRECT_MAX_BYTES )
+        return RECIP_ARITH_LOOKUP_DIRECT;
+    if ( num_syms <= RECIP_ARITH_LOOKUP_SIMD_MAX_SYMS )
+        return RECIP_ARITH_LOOKUP_SIMD;
+    if ( num_syms <= RECIP_ARITH_LOOKUP_BUCKETED_MAX_SYMS )
+        return RECIP_ARITH_LOOKUP_BUCKETED;
+    return RECIP_ARITH_LOOKUP_BINARY;
+}
+
+static inline void recip_arith_symbol_lookup_free(recip_arith_symbol_lookup * lut)
+{
+    free(lut->direct);
+    free(lut->buckets);
+    free(lut->simd_cdf);
+    lut->direct = NULL;
+    lut->buckets = NULL;
+    lut->simd_cdf = NULL;
+}
+
+/**
+
+recip_arith_symbol_lookup_init builds the lookup for cdf ; strategy = RECIP_ARITH_LOOKUP_AUTO to pick from num_syms & cdf_bits
+
+returns false if the strategy can't handle this alphabet (DIRECT & SIMD need num_syms <= 256 , BUCKETED <= 65536)
+or on allocation failure.
+call recip_arith_symbol_lookup_free when done.
+
+**/
+static inline bool recip_arith_symbol_lookup_init(recip_arith_symbol_lookup * lut,const uint32_t * cdf,uint32_t num_syms,uint32_t cdf_bits,int strategy)
+{
+    recip_arith_assert( num_syms >= 1 );
+    recip_arith_assert( cdf_bits < 31 ); // SIMD compares are signed
+    recip_arith_assert( cdf[0] == 0 && cdf[num_syms] == ((uint32_t)1<<cdf_bits) );
+
+    if ( strategy == RECIP_ARITH_LOOKUP_AUTO )
+        strategy = recip_arith_lookup_choose_strategy(num_syms,cdf_bits);
+
+    lut->strategy = strategy;
+    lut->num_syms = num_syms;
+    lut->cdf_bits = cdf_bits;
+    lut->cdf = cdf;
+    lut->direct = NULL;
+    lut->buckets = NULL;
+    lut->bucket_shift = 0;
+    lut->simd_cdf = NULL;
+    lut->simd_count = 0;
+
+    const uint32_t cdf_tot = (uint32_t)1<<cdf_bits;
+
+    switch(strategy)
+    {
+    case RECIP_ARITH_LOOKUP_DIRECT:
+    {
+        if ( num_syms > 256 ) return false;
+
+        lut->direct = (uint8_t *)malloc(cdf_tot+1);
+        if ( lut->direct == NULL ) return false;
+
+        for(uint32_t s=0;s<num_syms;s++)
+        {
+            for(uint32_t c=cdf[s];c<cdf[s+1];c++)
+                lut->direct[c] = (uint8_t) s;
+        }
+        // pad one extra slot at the end so that cdf target == cdf_tot is okay :
+        lut->direct[cdf_tot] = lut->direct[cdf_tot-1];
+        return true;
+    }
+
+    case RECIP_ARITH_LOOKUP_SIMD:
+    {
+        if ( num_syms > 256 ) return false;
+
+        // two vectors per step :
+        lut->simd_count = (num_syms + 7) & ~7U;
+        lut->simd_cdf = (int32_t *)malloc(lut->simd_count * sizeof(int32_t));
+        if ( lut->simd_cdf == NULL ) return false;
+
+        for(uint32_t i=0;i<lut->simd_count;i++)
+            lut->simd_cdf[i] = ( i < num_syms ) ? (int32_t)cdf[i] : 0x7FFFFFFF;
+        return true;
+    }
+
+    case RECIP_ARITH_LOOKUP_BUCKETED:
+    {
+        if ( num_syms > 65536 ) return false;
+
+        // ~2 buckets per symbol , but never more than 1 per cdf slot :
+        uint32_t bucket_bits = ( num_syms > 1 ) ? (33 - clz32(num_syms-1)) : 1;
+        if ( bucket_bits > cdf_bits ) bucket_bits = cdf_bits;
+        lut->bucket_shift = cdf_bits - bucket_bits;
+
+        uint32_t num_buckets = (uint32_t)1<<bucket_bits;
+        lut->buckets = (uint16_t *)malloc(num_buckets * sizeof(uint16_t));
+        if ( lut->buckets == NULL ) return false;
+
+        // bucket b starts at target (b<<shift) ; store the symbol that contains it
+        uint32_t s = 0;
+        for(uint32_t b=0;b<num_buckets;b++)
+        {
+            uint32_t t = b << lut->bucket_shift;
+            while ( cdf[s+1] <= t ) s++;
+            lut->buckets[b] = (uint16_t) s;
+        }
+        return true;
+    }
+
+    case RECIP_ARITH_LOOKUP_BINARY:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+//=========================================================================================
+// the finds , one per strategy , so a decode loop can call its strategy directly
+
+static recip_arith_inline uint32_t recip_arith_symbol_lookup_clamp(const recip_arith_symbol_lookup * lut,uint32_t target)
+{
+    const uint32_t cdf_max = ((uint32_t)1<<lut->cdf_bits) - 1;
+    return ( target > cdf_max ) ? cdf_max : target;
+}
+
+static recip_arith_inline uint32_t recip_arith_symbol_lookup_find_direct(const recip_arith_symbol_lookup * lut,uint32_t target)
+{
+    target = recip_arith_symbol_lookup_clamp(lut,target);
+    return lut->direct[target];
+}
+
+static recip_arith_inline uint32_t recip_arith_symbol_lookup_find_simd(const recip_arith_symbol_lookup * lut,uint32_t target)
+{
+    target = recip_arith_symbol_lookup_clamp(lut,target);
+
+    // sym = (number of cdf[i] <= target) - 1 , counting cdf[0] = 0
+    #ifdef RECIP_ARITH_LOOKUP_SSE2
+
+    const __m128i * pcdf = (const __m128i *)lut->simd_cdf;
+    const __m128i vtarget = _mm_set1_epi32((int)target);
+    __m128i gt_count = _mm_setzero_si128();
+
+    // cmpgt is -1 where cdf[i] > target , so subtracting counts them :
+    for(uint32_t i=0;i<lut->simd_count;i+=8,pcdf+=2)
+    {
+        gt_count = _mm_sub_epi32(gt_count, _mm_cmpgt_epi32( _mm_loadu_si128(pcdf) , vtarget ) );
+        gt_count = _mm_sub_epi32(gt_count, _mm_cmpgt_epi32( _mm_loadu_si128(pcdf+1) , vtarget ) );
+    }
+
+    gt_count = _mm_add_epi32(gt_count, _mm_shuffle_epi32(gt_count, _MM_SHUFFLE(1,0,3,2)) );
+    gt_count = _mm_add_epi32(gt_count, _mm_shuffle_epi32(gt_count, _MM_SHUFFLE(2,3,0,1)) );
+    uint32_t gt = (uint32_t)_mm_cvtsi128_si32(gt_count);
+
+    return lut->simd_count - gt - 1;
+
+    #else
+
+    uint32_t le = 0;
+    for(uint32_t i=0;i<lut->simd_count;i++)
+        le += ( lut->simd_cdf[i] <= (int32_t)target );
+    return le - 1;
+
+    #endif
+}
+
+static recip_arith_inline uint32_t recip_arith_symbol_lookup_find_bucketed(const recip_arith_symbol_lookup * lut,uint32_t target)
+{
+    target = recip_arith_symbol_lookup_clamp(lut,target);
+
+    uint32_t sym = lut->buckets[target >> lut->bucket_shift];
+    // cdf[num_syms] > target always stops the walk :
+    while ( lut->cdf[sym+1] <= target ) sym++;
+    return sym;
+}
+
+static recip_arith_inline uint32_t recip_arith_symbol_lookup_find_binary(const recip_arith_symbol_lookup * lut,uint32_t target)
+{
+    target = recip_arith_symbol_lookup_clamp(lut,target);
+
+    // largest sym in [0,num_syms) with cdf[sym] <= target ; the select compiles to cmov
+    const uint32_t * base = lut->cdf;
+    uint32_t len = lut->num_syms;
+    while ( len > 1 )
+    {
+        uint32_t half = len >> 1;
+        base = ( base[half] <= target ) ? base + half : base;
+        len -= half;
+    }
+    return (uint32_t)(base - lut->cdf);
+}
+
+// generic find ; the switch is perfectly predicted since strategy doesn't change
+static recip_arith_inline uint32_t recip_arith_symbol_lookup_find(const recip_arith_symbol_lookup * lut,uint32_t target)
+{
+    switch(lut->strategy)
+    {
+    case RECIP_ARITH_LOOKUP_DIRECT: return recip_arith_symbol_lookup_find_direct(lut,target);
+    case RECIP_ARITH_LOOKUP_SIMD: return recip_arith_symbol_lookup_find_simd(lut,target);
+    case RECIP_ARITH_LOOKUP_BUCKETED: return recip_arith_symbol_lookup_find_bucketed(lut,target);
+    default: return recip_arith_symbol_lookup_find_binary(lut,target);
+    }
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_SYMBOL_LOOKUP_H
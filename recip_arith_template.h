@@ -0,0 +1,186 @@
+#pragma once
+/**
+recip_arith_template.h
+recip_arith with compile-time reciprocal tables
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_TEMPLATE_H
+#define RECIP_ARITH_TEMPLATE_H
+
+#include "recip_arith.h"
+
+//=========================================================================================
+
+/**
+
+recip_arith_coder_t< table_bits , numerator_bits , cdf_bits >
+
+the same coder as recip_arith_encoder_put / recip_arith_decoder_peek / _remove ,
+on the same recip_arith_encoder / recip_arith_decoder (and 64-bit) states ,
+but with the configuration as template parameters instead of the global macros :
+
+the reciprocal table is built constexpr , so it lives in read-only data ,
+  needs no recip_arith_table_init call , and is shared by all threads & processes
+several configurations can live in one binary
+with cdf_bits fixed , all the shifts are (constant - clz)
+
+with <RECIP_ARITH_TABLE_BITS,RECIP_ARITH_NUMERATOR_BITS,cdf_bits> the bitstream is identical to the macro version
+
+requires C++14 (constexpr loops)
+
+**/
+
+//=========================================================================================
+
+template <int t_table_bits,int t_numerator_bits>
+struct recip_arith_recip_table_t
+{
+    static_assert( t_table_bits >= 2 && t_table_bits <= 16 , "table_bits out of range" );
+    // the largest reciprocal is 1<<(t_numerator_bits - t_table_bits + 1) , for (1<<(t_table_bits-1)) ; it must fit in a u32 :
+    static_assert( t_numerator_bits <= t_table_bits + 30 , "reciprocals don't fit in u32" );
+
+    uint32_t table[(1<<t_table_bits)];
+
+    constexpr recip_arith_recip_table_t() : table()
+    {
+        // first half of table is empty , same as recip_arith_table_init :
+        for(int i=((1<<t_table_bits)/2);i<(1<<t_table_bits);i++)
+        {
+            // ceil reciprocal :
+            table[i] = (uint32_t)( (((uint64_t)1<<t_numerator_bits) + i-1) / (i) );
+        }
+    }
+};
+
+//=========================================================================================
+
+template <int t_table_bits,int t_numerator_bits,int t_cdf_bits>
+struct recip_arith_coder_t
+{
+    // numerator precision must cover code_necessary_bits times r_top for the reciprocal to be exact
+    //  (see RECIP_ARITH_NUMERATOR_BITS) , and code_necessary_bits * recip must fit in 64 bits :
+    static_assert( t_cdf_bits >= 1 , "cdf_bits out of range" );
+    static_assert( t_cdf_bits + 2*t_table_bits <= t_numerator_bits , "numerator_bits too small for cdf_bits" );
+    static_assert( t_cdf_bits + t_table_bits <= 32 , "cdf_bits too large for the reciprocal multiply" );
+
+    typedef recip_arith_recip_table_t<t_table_bits,t_numerator_bits> recip_table_t;
+
+    static constexpr recip_table_t c_recip_table = recip_table_t();
+
+    enum { table_bits = t_table_bits , numerator_bits = t_numerator_bits , cdf_bits = t_cdf_bits };
+
+    //-------------------------------------------------------------
+    // 32-bit state
+
+    static recip_arith_inline void put(recip_arith_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq)
+    {
+        // 32-bit renorm leaves range >= (1<<24) :
+        static_assert( t_cdf_bits + t_table_bits - 1 <= 24 , "cdf_bits too large for the 32-bit coder" );
+
+        recip_arith_assert( (cdf_low + cdf_freq) <= ((uint32_t)1<<t_cdf_bits) );
+        recip_arith_assert( cdf_freq > 0 );
+        recip_arith_assert( ac->range >= ((uint32_t)1<<t_cdf_bits) );
+
+        uint32_t range = ac->range;
+        int range_clz = clz32(range);
+
+        uint32_t r_top = range >> (32 - range_clz - t_table_bits);
+        uint32_t r_norm = r_top << (32 - range_clz - t_table_bits - t_cdf_bits);
+
+        uint32_t save_low = ac->low;
+        ac->low += cdf_low * r_norm;
+        ac->range = cdf_freq * r_norm;
+
+        if ( ac->low < save_low ) recip_arith_encoder_carry(ac);
+    }
+
+    static recip_arith_inline uint32_t peek(recip_arith_decoder * ac)
+    {
+        static_assert( t_cdf_bits + t_table_bits - 1 <= 24 , "cdf_bits too large for the 32-bit coder" );
+
+        recip_arith_assert( ac->range >= ((uint32_t)1<<t_cdf_bits) );
+
+        uint32_t range = ac->range;
+        int range_clz = clz32(range);
+
+        uint32_t r_top = range >> (32 - range_clz - t_table_bits);
+        uint32_t r_norm = r_top << (32 - range_clz - t_table_bits - t_cdf_bits);
+
+        // save r_norm for the "remove" step later :
+        ac->range = r_norm;
+
+        uint32_t code_necessary_bits = ac->code >> (32 - range_clz - t_table_bits - t_cdf_bits);
+
+        uint32_t target = (uint32_t)( ( code_necessary_bits * (uint64_t)c_recip_table.table[r_top] ) >> t_numerator_bits );
+
+        recip_arith_assert( target <= ((uint32_t)1<<t_cdf_bits) );
+        return target;
+    }
+
+    static recip_arith_inline void remove(recip_arith_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq)
+    {
+        recip_arith_decoder_remove(ac,cdf_low,cdf_freq);
+    }
+
+    //-------------------------------------------------------------
+    // 64-bit state
+
+    static recip_arith_inline void put(recip_arith64_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq)
+    {
+        recip_arith_assert( (cdf_low + cdf_freq) <= ((uint32_t)1<<t_cdf_bits) );
+        recip_arith_assert( cdf_freq > 0 );
+        recip_arith_assert( ac->range >= ((uint64_t)1<<(t_cdf_bits + t_table_bits - 1)) );
+
+        uint64_t range = ac->range;
+        int range_clz = clz64(range);
+
+        uint64_t r_top = range >> (64 - range_clz - t_table_bits);
+        uint64_t r_norm = r_top << (64 - range_clz - t_table_bits - t_cdf_bits);
+
+        uint64_t save_low = ac->low;
+        ac->low += cdf_low * r_norm;
+        ac->range = cdf_freq * r_norm;
+
+        if ( ac->low < save_low ) recip_arith64_encoder_carry(ac);
+    }
+
+    static recip_arith_inline uint32_t peek(recip_arith64_decoder * ac)
+    {
+        recip_arith_assert( ac->range >= ((uint64_t)1<<(t_cdf_bits + t_table_bits - 1)) );
+
+        uint64_t range = ac->range;
+        int range_clz = clz64(range);
+
+        uint64_t r_top = range >> (64 - range_clz - t_table_bits);
+        uint64_t r_norm = r_top << (64 - range_clz - t_table_bits - t_cdf_bits);
+
+        // save r_norm for the "remove" step later :
+        ac->range = r_norm;
+
+        uint64_t code_necessary_bits = ac->code >> (64 - range_clz - t_table_bits - t_cdf_bits);
+
+        uint32_t target = (uint32_t)( ( code_necessary_bits * c_recip_table.table[r_top] ) >> t_numerator_bits );
+
+        recip_arith_assert( target <= ((uint32_t)1<<t_cdf_bits) );
+        return target;
+    }
+
+    static recip_arith_inline void remove(recip_arith64_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq)
+    {
+        recip_arith64_decoder_remove(ac,cdf_low,cdf_freq);
+    }
+};
+
+// out-of-class definition of the table , needed before C++17 :
+template <int t_table_bits,int t_numerator_bits,int t_cdf_bits>
+constexpr typename recip_arith_coder_t<t_table_bits,t_numerator_bits,t_cdf_bits>::recip_table_t
+    recip_arith_coder_t<t_table_bits,t_numerator_bits,t_cdf_bits>::c_recip_table;
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_TEMPLATE_H
@@ -0,0 +1,289 @@
+#pragma once
+/**
+recip_arith_total.h
+recip_arith with any cdf total (not just a power of two) , still division free ,
+and count-based adaptive nibble & byte models that use it
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_TOTAL_H
+#define RECIP_ARITH_TOTAL_H
+
+#include "recip_arith.h"
+#include "recip_arith_adaptive.h" // for RECIP_ARITH_ADAPTIVE_SSE2
+
+//=========================================================================================
+
+/**
+
+recip_arith_encoder_put wants r_norm = range / 2^cdf_bits , which is a shift of r_top.
+For a cdf total T that isn't a power of two , r_norm = range / T needs a divide.
+
+Instead T is quantized (rounded up) to its top RECIP_ARITH_TABLE_BITS bits , t_top * 2^e >= T ,
+and r_norm is built from a second reciprocal lookup , on t_top :
+
+    R2 = top 2*RECIP_ARITH_TABLE_BITS bits of range
+    q = R2 / t_top                      (recip_arith_table[t_top] , exact)
+    r_norm = q << s                     (s chosen so q has RECIP_ARITH_TABLE_BITS bits)
+
+q * T << s <= range , so the intervals fit ; the leftover is coding loss , as in the base coder.
+The decoder computes the same q and finds target = (code >> s) / q with recip_arith_table[q] ,
+exactly like recip_arith_decoder_peek does with r_top ; recip_arith_decoder_remove is unchanged.
+
+so it's two reciprocal multiplies in the decoder (one in the encoder) vs one , and no divides.
+the t_top part only depends on T ; recip_arith_total holds it so models can compute it once per total.
+
+loss : T rounding up to t_top costs up to 2^-(TABLE_BITS-1) , q rounding down about the same as the base map ,
+both small vs. the model ; the coded T doesn't have to be a power of two , so count models don't rescale
+to one , they only halve when T would pass RECIP_ARITH_MAX_TOTAL.
+
+T is limitted so that (code >> s) stays within the exact reciprocal precision (cdf_bits + table bits , 24 by default)
+and s >= 0 for range >= 2^24 : 1 <= T <= 2^(RECIP_ARITH_MAX_CDF_BITS-1) , 32768 by default.
+with T = 2^cdf_bits , t_top is exact and q comes out as r_top , so it's the same map & bitstream as recip_arith_encoder_put.
+
+**/
+
+#define RECIP_ARITH_MAX_TOTAL       (1<<(RECIP_ARITH_MAX_CDF_BITS-1))
+
+struct recip_arith_total
+{
+    uint32_t total;
+    uint32_t top;           // T rounded up to RECIP_ARITH_TABLE_BITS bits , in [2^(TABLE_BITS-1),2^TABLE_BITS)
+    uint32_t top_recip;     // recip_arith_table[top]
+    uint32_t total_shift;   // s = (bits in range) - total_shift , before the q fixup
+};
+
+static recip_arith_inline void recip_arith_total_init(recip_arith_total * t,uint32_t total)
+{
+    recip_arith_assert( total >= 1 && total <= RECIP_ARITH_MAX_TOTAL );
+    recip_arith_assert( recip_arith_table[(1<<RECIP_ARITH_TABLE_BITS)-1] != 0 ); // call recip_arith_table_init
+
+    int total_bits = 32 - clz32(total);
+    int e = total_bits - RECIP_ARITH_TABLE_BITS;
+    uint32_t top;
+    if ( e <= 0 )
+    {
+        // exact , scaled up to a full table index :
+        top = total << (-e);
+    }
+    else
+    {
+        // ceil to the top bits ; if that carries out , drop a bit :
+        top = ((total - 1) >> e) + 1;
+        if ( top == (1<<RECIP_ARITH_TABLE_BITS) )
+        {
+            top >>= 1;
+            e++;
+        }
+    }
+
+    t->total = total;
+    t->top = top;
+    t->top_recip = recip_arith_table[top];
+    t->total_shift = (uint32_t)(2*RECIP_ARITH_TABLE_BITS + e);
+}
+
+// r_norm = q << *p_shift , with q in [2^(TABLE_BITS-1),2^TABLE_BITS) ; same in encoder & decoder
+static recip_arith_inline uint32_t recip_arith_total_scale(uint32_t range,const recip_arith_total * t,uint32_t * p_shift)
+{
+    int range_bits = 32 - clz32(range);
+    recip_arith_assert( range_bits >= (int)t->total_shift );
+
+    uint32_t r2 = range >> (range_bits - 2*RECIP_ARITH_TABLE_BITS);
+    uint32_t q = (uint32_t)( ( r2 * (uint64_t)t->top_recip ) >> RECIP_ARITH_NUMERATOR_BITS );
+    uint32_t shift = range_bits - t->total_shift;
+
+    // q is in [2^(TABLE_BITS-1),2^(TABLE_BITS+1)) , bring it into the table :
+    uint32_t q_hi = q >> RECIP_ARITH_TABLE_BITS;
+    q >>= q_hi;
+    shift += q_hi;
+
+    *p_shift = shift;
+    return q;
+}
+
+// encode a symbol with a given cdf range , cdf_low + cdf_freq <= t->total
+static recip_arith_inline void recip_arith_encoder_put_total(recip_arith_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,const recip_arith_total * t)
+{
+    recip_arith_assert( (cdf_low + cdf_freq) <= t->total );
+    recip_arith_assert( cdf_freq > 0 );
+    recip_arith_assert( ac->range >= (1<<24) );
+
+    uint32_t shift;
+    uint32_t q = recip_arith_total_scale(ac->range,t,&shift);
+    uint32_t r_norm = q << shift;
+
+    uint32_t save_low = ac->low;
+    ac->low += cdf_low * r_norm;
+    ac->range = cdf_freq * r_norm;
+
+    if ( ac->low < save_low ) recip_arith_encoder_carry(ac);
+}
+
+// peek finds the target cdf currently specified (mutates decoder) ; then recip_arith_decoder_remove as usual
+static recip_arith_inline uint32_t recip_arith_decoder_peek_total(recip_arith_decoder * ac,const recip_arith_total * t)
+{
+    recip_arith_assert( ac->range >= (1<<24) );
+
+    uint32_t shift;
+    uint32_t q = recip_arith_total_scale(ac->range,t,&shift);
+
+    // save r_norm for the "remove" step later :
+    ac->range = q << shift;
+
+    uint32_t code_necessary_bits = ac->code >> shift;
+    uint32_t target = (uint32_t)( ( code_necessary_bits * (uint64_t)recip_arith_table[q] ) >> RECIP_ARITH_NUMERATOR_BITS );
+
+    recip_arith_assert( target <= t->total );
+    return target;
+}
+
+//=========================================================================================
+
+/**
+
+count-based adaptive nibble & byte models , coded with the raw count total :
+
+each coded symbol adds RECIP_ARITH_COUNT_INCREMENT to its count ;
+when the total would pass RECIP_ARITH_MAX_TOTAL all counts are halved (rounding up , so none go to 0).
+There is no rescale to a power of two.
+
+cum[] is the running cdf , cum[16] is the total.
+
+**/
+
+#ifndef RECIP_ARITH_COUNT_INCREMENT
+#define RECIP_ARITH_COUNT_INCREMENT     (24)
+#endif
+
+struct recip_arith_count_nibble_model
+{
+    uint16_t cum[17];
+    recip_arith_total total;
+};
+
+struct recip_arith_count_byte_model
+{
+    recip_arith_count_nibble_model hi;
+    recip_arith_count_nibble_model lo[16];
+};
+
+static inline void recip_arith_count_nibble_model_init(recip_arith_count_nibble_model * m)
+{
+    // start flat , every count 1 :
+    for(int i=0;i<=16;i++)
+        m->cum[i] = (uint16_t)i;
+    recip_arith_total_init(&m->total,16);
+}
+
+static inline void recip_arith_count_byte_model_init(recip_arith_count_byte_model * m)
+{
+    recip_arith_count_nibble_model_init(&m->hi);
+    for(int i=0;i<16;i++)
+        recip_arith_count_nibble_model_init(&m->lo[i]);
+}
+
+static recip_arith_inline void recip_arith_count_nibble_model_update(recip_arith_count_nibble_model * m,int sym)
+{
+    #ifdef RECIP_ARITH_ADAPTIVE_SSE2
+
+    __m128i * pcum = (__m128i *)m->cum;
+    const __m128i index0 = _mm_setr_epi16(0,1,2,3,4,5,6,7);
+    const __m128i index1 = _mm_setr_epi16(8,9,10,11,12,13,14,15);
+    const __m128i inc = _mm_set1_epi16(RECIP_ARITH_COUNT_INCREMENT);
+    __m128i vsym = _mm_set1_epi16((short)sym);
+
+    // cum[i] += inc for i > sym
+    _mm_storeu_si128(pcum  , _mm_add_epi16( _mm_loadu_si128(pcum)   , _mm_and_si128( _mm_cmpgt_epi16(index0,vsym) , inc ) ) );
+    _mm_storeu_si128(pcum+1, _mm_add_epi16( _mm_loadu_si128(pcum+1) , _mm_and_si128( _mm_cmpgt_epi16(index1,vsym) , inc ) ) );
+    m->cum[16] += RECIP_ARITH_COUNT_INCREMENT;
+
+    #else
+
+    for(int i=sym+1;i<=16;i++)
+        m->cum[i] += RECIP_ARITH_COUNT_INCREMENT;
+
+    #endif
+
+    if ( m->cum[16] > RECIP_ARITH_MAX_TOTAL - RECIP_ARITH_COUNT_INCREMENT )
+    {
+        uint32_t prev = 0 , sum = 0;
+        for(int i=1;i<=16;i++)
+        {
+            uint32_t freq = m->cum[i] - prev;
+            prev = m->cum[i];
+            sum += (freq + 1) >> 1;
+            m->cum[i] = (uint16_t)sum;
+        }
+    }
+
+    recip_arith_total_init(&m->total,m->cum[16]);
+}
+
+// find sym such that cum[sym] <= target < cum[sym+1]
+static recip_arith_inline int recip_arith_count_nibble_model_find(const recip_arith_count_nibble_model * m,uint32_t target)
+{
+    #ifdef RECIP_ARITH_ADAPTIVE_SSE2
+
+    // same as recip_arith_nibble_model_find ; cum[0-15] < 32768 , so signed compares are fine
+    if ( target >= RECIP_ARITH_MAX_TOTAL ) target = RECIP_ARITH_MAX_TOTAL-1;
+    const __m128i * pcum = (const __m128i *)m->cum;
+    __m128i vtarget = _mm_set1_epi16((short)target);
+    __m128i gt0 = _mm_cmpgt_epi16( _mm_loadu_si128(pcum) , vtarget );
+    __m128i gt1 = _mm_cmpgt_epi16( _mm_loadu_si128(pcum+1) , vtarget );
+    uint32_t gt_mask = (uint32_t)_mm_movemask_epi8( _mm_packs_epi16(gt0,gt1) );
+    uint32_t le_mask = (~gt_mask) & 0xFFFF;
+    return 31 - clz32(le_mask);
+
+    #else
+
+    int sym = 0;
+    for(int i=1;i<16;i++)
+        sym += ( m->cum[i] <= target );
+    return sym;
+
+    #endif
+}
+
+static recip_arith_inline void recip_arith_encoder_put_count_nibble(recip_arith_encoder * ac,recip_arith_count_nibble_model * m,int sym)
+{
+    recip_arith_assert( sym >= 0 && sym < 16 );
+    uint32_t low = m->cum[sym];
+    uint32_t high = m->cum[sym+1];
+    recip_arith_encoder_put_total(ac,low,high-low,&m->total);
+    recip_arith_encoder_renorm(ac);
+    recip_arith_count_nibble_model_update(m,sym);
+}
+
+static recip_arith_inline int recip_arith_decoder_get_count_nibble(recip_arith_decoder * ac,recip_arith_count_nibble_model * m)
+{
+    uint32_t target = recip_arith_decoder_peek_total(ac,&m->total);
+    int sym = recip_arith_count_nibble_model_find(m,target);
+    uint32_t low = m->cum[sym];
+    uint32_t high = m->cum[sym+1];
+    recip_arith_decoder_remove(ac,low,high-low);
+    recip_arith_decoder_renorm(ac);
+    recip_arith_count_nibble_model_update(m,sym);
+    return sym;
+}
+
+static recip_arith_inline void recip_arith_encoder_put_count_byte(recip_arith_encoder * ac,recip_arith_count_byte_model * m,int sym)
+{
+    recip_arith_encoder_put_count_nibble(ac,&m->hi,sym>>4);
+    recip_arith_encoder_put_count_nibble(ac,&m->lo[sym>>4],sym&15);
+}
+
+static recip_arith_inline int recip_arith_decoder_get_count_byte(recip_arith_decoder * ac,recip_arith_count_byte_model * m)
+{
+    int hi = recip_arith_decoder_get_count_nibble(ac,&m->hi);
+    int lo = recip_arith_decoder_get_count_nibble(ac,&m->lo[hi]);
+    return (hi<<4) | lo;
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_TOTAL_H
@@ -0,0 +1,182 @@
+#pragma once
+/**
+recip_arith_unrolled.h
+encode_block / decode_block : whole arrays of symbols with a static model ,
+several symbols per renorm , unrolled at compile time from cdf_bits
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#ifndef RECIP_ARITH_UNROLLED_H
+#define RECIP_ARITH_UNROLLED_H
+
+#include "recip_arith.h"
+
+#include <stddef.h>
+
+//=========================================================================================
+
+/**
+
+The recip_arith64 coder only has to renorm when range could get too small for the next _put/_peek ;
+with the word renorms (recip_arith64_encoder_renorm , recip_arith64_decoder_renorm32) range has 33 bits after a renorm ,
+and each symbol takes at most cdf_bits , so RECIP_ARITH64_WORD_SYMBOLS_PER_RENORM(cdf_bits) symbols fit
+between renorms (1 at cdf_bits 13 , 2 at cdf_bits 9-12 , 3 at cdf_bits 7-8).
+
+recip_arith_encode_block_t / recip_arith_decode_block_t take cdf_bits as a template parameter ,
+so that count is a compile-time constant and the inner loop is fully unrolled ,
+the shifts are constants , and the decoder state and table pointers live in registers.
+recip_arith_encode_block / recip_arith_decode_block take cdf_bits at runtime and switch to the template.
+the templates and the runtime switches are force-inlined so a caller compiled for another target
+(recip_arith_dispatch.cpp) gets its own copy of the loop built with that instruction set.
+
+The byte renorm (recip_arith64_decoder_renorm) allows more symbols per renorm ,
+RECIP_ARITH64_SYMBOLS_PER_RENORM (3 at cdf_bits 13) , but its byte loop costs more than it saves :
+measured on big.txt the word renorm decode is as fast at cdf_bits 13 and 5-10% faster at 8-12 ,
+and the word renorm encoder is faster at every cdf_bits.
+
+the model is cdf[num_syms+1] (cdf[num_syms] == 1<<cdf_bits) and ,
+for decoding , a (1<<cdf_bits) entry decode_table of symbols , as in test_recip_arith.
+symbols are bytes.
+
+the stream is the recip_arith64_encoder stream , which recip_arith_decoder & recip_arith64_decoder also read ;
+it's the same bitstream as recip_arith_encoder up to the final bytes.
+
+the decoder reads ahead of the stream ;
+comp needs RECIP_ARITH_DECODER_TAIL_PADDING readable bytes after the end of the stream.
+the stream is trusted , see recip_arith_checked.h for untrusted input.
+
+**/
+
+//=========================================================================================
+
+template <uint32_t t_cdf_bits,int t_count>
+struct recip_arith_unroll_t
+{
+    static recip_arith_inline void put(recip_arith64_encoder * enc,const uint8_t * syms,const uint32_t * cdf)
+    {
+        recip_arith_unroll_t<t_cdf_bits,t_count-1>::put(enc,syms,cdf);
+        uint32_t sym = syms[t_count-1];
+        recip_arith64_encoder_put(enc,cdf[sym],cdf[sym+1] - cdf[sym],t_cdf_bits);
+    }
+
+    static recip_arith_inline void get(recip_arith64_decoder * dec,uint8_t * syms,const uint32_t * cdf,const uint8_t * decode_table)
+    {
+        recip_arith_unroll_t<t_cdf_bits,t_count-1>::get(dec,syms,cdf,decode_table);
+        uint32_t target = recip_arith64_decoder_peek(dec,t_cdf_bits);
+        uint32_t sym = decode_table[target];
+        syms[t_count-1] = (uint8_t) sym;
+        recip_arith64_decoder_remove(dec,cdf[sym],cdf[sym+1] - cdf[sym]);
+    }
+};
+
+template <uint32_t t_cdf_bits>
+struct recip_arith_unroll_t<t_cdf_bits,0>
+{
+    static recip_arith_inline void put(recip_arith64_encoder *,const uint8_t *,const uint32_t *) { }
+    static recip_arith_inline void get(recip_arith64_decoder *,uint8_t *,const uint32_t *,const uint8_t *) { }
+};
+
+//=========================================================================================
+
+// returns the end of the stream
+template <uint32_t t_cdf_bits>
+static recip_arith_inline uint8_t * recip_arith_encode_block_t(uint8_t * comp,const uint8_t * syms,size_t count,const uint32_t * cdf)
+{
+    static_assert( t_cdf_bits >= 1 && t_cdf_bits <= RECIP_ARITH_MAX_CDF_BITS , "cdf_bits out of range" );
+    const int c_per_renorm = RECIP_ARITH64_WORD_SYMBOLS_PER_RENORM(t_cdf_bits);
+    static_assert( c_per_renorm >= 1 , "cdf_bits too big" );
+
+    recip_arith64_encoder enc;
+    recip_arith64_encoder_start(&enc,comp);
+
+    const uint8_t * end = syms + count;
+    const uint8_t * end_unrolled = syms + (count/c_per_renorm)*c_per_renorm;
+
+    while ( syms < end_unrolled )
+    {
+        recip_arith_unroll_t<t_cdf_bits,c_per_renorm>::put(&enc,syms,cdf);
+        syms += c_per_renorm;
+        recip_arith64_encoder_renorm(&enc);
+    }
+
+    for(;syms<end;syms++)
+    {
+        recip_arith_unroll_t<t_cdf_bits,1>::put(&enc,syms,cdf);
+        recip_arith64_encoder_renorm(&enc);
+    }
+
+    return recip_arith64_encoder_finish(&enc);
+}
+
+template <uint32_t t_cdf_bits>
+static recip_arith_inline void recip_arith_decode_block_t(uint8_t * syms,size_t count,const uint8_t * comp,
+                                            const uint32_t * cdf,const uint8_t * decode_table)
+{
+    static_assert( t_cdf_bits >= 1 && t_cdf_bits <= RECIP_ARITH_MAX_CDF_BITS , "cdf_bits out of range" );
+    const int c_per_renorm = RECIP_ARITH64_WORD_SYMBOLS_PER_RENORM(t_cdf_bits);
+    static_assert( c_per_renorm >= 1 , "cdf_bits too big" );
+
+    // decoder state in a local so it stays in registers :
+    recip_arith64_decoder dec;
+    recip_arith64_decoder_start(&dec,comp);
+
+    uint8_t * end = syms + count;
+    uint8_t * end_unrolled = syms + (count/c_per_renorm)*c_per_renorm;
+
+    while ( syms < end_unrolled )
+    {
+        recip_arith_unroll_t<t_cdf_bits,c_per_renorm>::get(&dec,syms,cdf,decode_table);
+        syms += c_per_renorm;
+        recip_arith64_decoder_renorm32(&dec);
+    }
+
+    for(;syms<end;syms++)
+    {
+        recip_arith_unroll_t<t_cdf_bits,1>::get(&dec,syms,cdf,decode_table);
+        recip_arith64_decoder_renorm32(&dec);
+    }
+}
+
+//=========================================================================================
+// runtime cdf_bits
+
+#define RECIP_ARITH_UNROLLED_CASES(macro) \
+    macro(1)  macro(2)  macro(3)  macro(4)  macro(5)  macro(6)  macro(7)  macro(8) \
+    macro(9)  macro(10) macro(11) macro(12) macro(13) macro(14) macro(15) macro(16)
+
+static_assert( RECIP_ARITH_MAX_CDF_BITS <= 16 , "add cases to RECIP_ARITH_UNROLLED_CASES" );
+
+// returns the end of the stream , or NULL if cdf_bits is out of range
+static recip_arith_inline uint8_t * recip_arith_encode_block(uint8_t * comp,const uint8_t * syms,size_t count,const uint32_t * cdf,uint32_t cdf_bits)
+{
+    switch(cdf_bits)
+    {
+    #define RECIP_ARITH_ENCODE_CASE(b)  case b: return ( b <= RECIP_ARITH_MAX_CDF_BITS ) ? \
+                                            recip_arith_encode_block_t<( b <= RECIP_ARITH_MAX_CDF_BITS ? b : 1 )>(comp,syms,count,cdf) : NULL;
+    RECIP_ARITH_UNROLLED_CASES(RECIP_ARITH_ENCODE_CASE)
+    #undef RECIP_ARITH_ENCODE_CASE
+    default: return NULL;
+    }
+}
+
+// returns false if cdf_bits is out of range
+static recip_arith_inline bool recip_arith_decode_block(uint8_t * syms,size_t count,const uint8_t * comp,
+                                            const uint32_t * cdf,const uint8_t * decode_table,uint32_t cdf_bits)
+{
+    switch(cdf_bits)
+    {
+    #define RECIP_ARITH_DECODE_CASE(b)  case b: if ( b > RECIP_ARITH_MAX_CDF_BITS ) return false; \
+                                            recip_arith_decode_block_t<( b <= RECIP_ARITH_MAX_CDF_BITS ? b : 1 )>(syms,count,comp,cdf,decode_table); return true;
+    RECIP_ARITH_UNROLLED_CASES(RECIP_ARITH_DECODE_CASE)
+    #undef RECIP_ARITH_DECODE_CASE
+    default: return false;
+    }
+}
+
+//=========================================================================================
+
+#endif // RECIP_ARITH_UNROLLED_H
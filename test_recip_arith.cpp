@@ -14,97 +14,385 @@ public domain
 // define assert or recip_arith_assert before including recip_arith.h
 
 #include "recip_arith.h"
+#include "recip_arith_interleaved.h"
+#include "recip_arith_simd.h"
+#include "recip_arith_template.h"
+#include "recip_arith_adaptive.h"
+#include "recip_arith_binary.h"
+#include "recip_arith_static_model.h"
+#include "recip_arith_symbol_lookup.h"
+#include "recip_arith_block.h"
+#include "recip_arith_order1.h"
+#include "recip_arith_lz.h"
+#include "recip_arith_stream.h"
+#include "recip_arith_checked.h"
+#include "recip_arith_reference_maps.h"
+#include "recip_arith_loss.h"
+#include "recip_arith_fused.h"
+#include "recip_arith_lj.h"
+#include "recip_arith_bypass.h"
+#include "recip_arith_total.h"
+#include "recip_arith_unrolled.h"
+#include "recip_arith_dispatch.h"
+#include "recip_arith_policy.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
 
 static uint8_t * read_whole_file(const char *name,size_t * pLength);
 
+// wall clock , so the threaded sections show their scaling :
+static double seconds_now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void print_decode_speed(double seconds,size_t len)
+{
+    if ( seconds <= 0.0 ) seconds = 1e-9;
+    printf("decode : %.1f MB/s\n",len/(seconds*1000000.0));
+}
+
 //=================================================================
 //
-// test functions with the cacm87 cdf-range map
-//  not in recip_arith.h
+// round trip with a compile-time configured coder from recip_arith_template.h
 
-// encode a symbol with a given cdf range
-static recip_arith_inline void recip_arith_encoder_put_cacm87(recip_arith_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits)
+template <typename t_coder>
+static size_t test_template_coder(const uint8_t * file_buf,size_t file_len,uint8_t * comp_buf,uint8_t * dec_buf,
+                                    const uint32_t * cdf,const uint8_t * decode_table)
 {
-    recip_arith_assert( (cdf_low + cdf_freq) <= ((uint32_t)1<<cdf_bits) );
-    recip_arith_assert( cdf_freq > 0 );
-    recip_arith_assert( ac->range >= ((uint32_t)1<<cdf_bits) );
+    printf("recip_arith_coder_t<%d,%d,%d>:\n",(int)t_coder::table_bits,(int)t_coder::numerator_bits,(int)t_coder::cdf_bits);
+
+    recip_arith_encoder enc;
+    recip_arith_encoder_start(&enc,comp_buf);
     
-    uint32_t lo = (uint32_t)( ((uint64_t)cdf_low * ac->range) >> cdf_bits);
-    uint32_t hi = (uint32_t)( ((uint64_t)(cdf_low + cdf_freq) * ac->range) >> cdf_bits);
+    for(size_t i=0;i<file_len;i++) 
+    {
+        int sym = file_buf[i];
+        uint32_t low = cdf[sym];
+        uint32_t freq = cdf[sym+1] - low;
+        
+        t_coder::put(&enc,low,freq);
+        recip_arith_encoder_renorm(&enc);
+    }
     
-    uint32_t save_low = ac->low;
-    ac->low += lo;
-    ac->range = hi - lo;    
-    if ( ac->low < save_low ) recip_arith_encoder_carry(ac);
-}
+    uint8_t * comp_end = recip_arith_encoder_finish(&enc);
 
-// peek finds the target cdf currently specified (mutates decoder)
-static recip_arith_inline uint32_t recip_arith_decoder_peek_cacm87(recip_arith_decoder * ac,uint32_t cdf_bits)
-{
-    recip_arith_assert( ac->range >= ((uint32_t)1<<cdf_bits) );
+    size_t comp_len = comp_end - comp_buf; 
+
+    printf("comp_len : %d = %.3f bpb\n",(int)comp_len,comp_len*8.0/file_len);
+    
+    recip_arith_decoder dec;
+    
+    double t0 = seconds_now();
+        
+    recip_arith_decoder_start(&dec,comp_buf);
+    
+    for(size_t i=0;i<file_len;i++) 
+    {
+        uint32_t target = t_coder::peek(&dec);
+        uint8_t sym = decode_table[target];
+        dec_buf[i] = sym;
+        uint32_t low = cdf[sym];
+        uint32_t freq = cdf[sym+1] - low;
+        t_coder::remove(&dec,low,freq);
+        recip_arith_decoder_renorm(&dec);
+    }
+    
+    print_decode_speed(seconds_now() - t0,file_len);
+        
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
     
-    uint32_t target = (uint32_t)( ((((uint64_t)ac->code) << cdf_bits) + ((uint64_t)1<<cdf_bits) - 1 ) / ac->range );
-    recip_arith_assert( target <= ((uint32_t)1<<cdf_bits) );
-    return target;
+    return comp_len;
 }
 
-// remove the symbol found by the previous call to peek
-static recip_arith_inline void recip_arith_decoder_remove_cacm87(recip_arith_decoder * ac,uint32_t cdf_low,uint32_t cdf_freq,int cdf_bits)
+//=================================================================
+//
+// round trip with a map & state policy coder from recip_arith_policy.h
+
+template <typename t_coder>
+static size_t test_policy_coder(const char * name,const uint8_t * file_buf,size_t file_len,uint8_t * comp_buf,uint8_t * dec_buf,
+                                    const uint32_t * cdf,const uint8_t * decode_table,uint32_t cdf_bits)
 {
-    uint32_t lo = (uint32_t)( ((uint64_t)cdf_low * ac->range) >> cdf_bits);
-    uint32_t hi = (uint32_t)( ((uint64_t)(cdf_low + cdf_freq) * ac->range) >> cdf_bits);
-    ac->code -= lo;
-    ac->range = hi - lo;
+    printf("recip_arith_policy_coder_t %s:\n",name);
+
+    uint8_t * comp_end = t_coder::encode(comp_buf,file_buf,file_len,cdf,cdf_bits);
+
+    size_t comp_len = comp_end - comp_buf; 
+
+    printf("comp_len : %d = %.3f bpb\n",(int)comp_len,comp_len*8.0/file_len);
+    
+    double t0 = seconds_now();
+    
+    t_coder::decode(dec_buf,file_len,comp_buf,cdf,decode_table,cdf_bits);
+    
+    print_decode_speed(seconds_now() - t0,file_len);
+        
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    return comp_len;
 }
 
 //=================================================================
 //
-// test functions with the sm98 cdf-range map
-//  not in recip_arith.h
+// round trip of a large-alphabet , high-precision model through recip_arith_symbol_lookup
+//  using the 64-bit encoder & decoder with word renorm
 
-#define MAX(a,b)            (((a) > (b)) ? (a) : (b))
-
-// encode a symbol with a given cdf range
-static recip_arith_inline void recip_arith_encoder_put_sm98(recip_arith_encoder * ac,uint32_t cdf_low,uint32_t cdf_freq,uint32_t cdf_bits)
+static void test_symbol_lookup(const uint32_t * syms,size_t count,uint32_t num_syms,uint32_t cdf_bits,
+                                uint8_t * comp_buf,uint32_t * dec_syms)
 {
-    recip_arith_assert( (cdf_low + cdf_freq) <= ((uint32_t)1<<cdf_bits) );
-    recip_arith_assert( cdf_freq > 0 );
-    recip_arith_assert( ac->range >= ((uint32_t)1<<cdf_bits) );
+    uint32_t * counts = (uint32_t *)calloc(num_syms,sizeof(uint32_t));
+    uint32_t * freqs = (uint32_t *)malloc(num_syms*sizeof(uint32_t));
+    uint32_t * cdf = (uint32_t *)malloc((num_syms+1)*sizeof(uint32_t));
     
-    // need to find the top bit position of range
-    // an alternative implementation is to keep range left-justified
-    //  so that r_bits is always 31 and bits free varies in [0-7] at the bottom
-    uint32_t range = ac->range;
-    int range_clz = clz32(range);
-    int r_bits = 31-range_clz;
-    int cdf_to_r_shift = r_bits - cdf_bits;
+    for(size_t i=0;i<count;i++) counts[ syms[i] ] += 1;
     
-    // 2<<r_bits can be 2^32 , be careful of 32 bit vars
-    //  and we need that to be compared with sign (eg. not wrapping in 32-bit)
-    //  so bump up to signed S64
-        
-    int64_t threshold = ((int64_t)2<<r_bits) - range;
+    if ( ! recip_arith_normalize_counts(freqs,counts,num_syms,cdf_bits) )
+    {
+        printf("symbol lookup : can't normalize histogram , skipped\n");
+        free(counts);
+        free(freqs);
+        free(cdf);
+        return;
+    }
+    recip_arith_cdf_from_freqs(cdf,freqs,num_syms);
+    
+    printf("symbol lookup : %d symbols at cdf_bits %d , auto = %s\n",(int)num_syms,(int)cdf_bits,
+        recip_arith_lookup_strategy_name( recip_arith_lookup_choose_strategy(num_syms,cdf_bits) ) );
+    
+    const int syms_per_renorm = RECIP_ARITH64_WORD_SYMBOLS_PER_RENORM(cdf_bits);
+    recip_arith_assert( syms_per_renorm >= 1 );
     
-    uint32_t lo = cdf_low << cdf_to_r_shift;
-    uint32_t hi = (cdf_low + cdf_freq) << cdf_to_r_shift;
+    recip_arith64_encoder enc;
+    recip_arith64_encoder_start(&enc,comp_buf);
     
-    // use MAX of two mappings; 1X from the bottom or 2X down from the top :
-    //  MAX( lo , range - 2*(cdf_tot - low) )
-    // some algebra can factor that into just a satsub and add :
+    for(size_t i=0;i<count;) 
+    {
+        for(int j=0;j<syms_per_renorm && i<count;j++,i++)
+        {
+            uint32_t sym = syms[i];
+            recip_arith64_encoder_put(&enc,cdf[sym],cdf[sym+1] - cdf[sym],cdf_bits);
+        }
+        recip_arith64_encoder_renorm(&enc);
+    }
     
-    lo += (uint32_t) MAX(0, (int64_t)lo - threshold);
-    hi += (uint32_t) MAX(0, (int64_t)hi - threshold);
+    uint8_t * comp_end = recip_arith64_encoder_finish(&enc);
+
+    size_t comp_len = comp_end - comp_buf; 
+
+    printf("comp_len : %d = %.3f bits per symbol\n",(int)comp_len,comp_len*8.0/count);
     
-    recip_arith_assert( hi > lo && hi <= range );
+    for(int strategy=0;strategy<RECIP_ARITH_LOOKUP_COUNT;strategy++)
+    {
+        recip_arith_symbol_lookup lut;
+        if ( ! recip_arith_symbol_lookup_init(&lut,cdf,num_syms,cdf_bits,strategy) )
+        {
+            printf("%s : n/a\n",recip_arith_lookup_strategy_name(strategy));
+            continue;
+        }
+        
+        printf("%s : ",recip_arith_lookup_strategy_name(strategy));
+        
+        recip_arith64_decoder dec;
+        
+        double t0 = seconds_now();
+        
+        recip_arith64_decoder_start(&dec,comp_buf);
+        
+        for(size_t i=0;i<count;) 
+        {
+            for(int j=0;j<syms_per_renorm && i<count;j++,i++)
+            {
+                uint32_t target = recip_arith64_decoder_peek(&dec,cdf_bits);
+                uint32_t sym = recip_arith_symbol_lookup_find(&lut,target);
+                dec_syms[i] = sym;
+                recip_arith64_decoder_remove(&dec,cdf[sym],cdf[sym+1] - cdf[sym]);
+            }
+            recip_arith64_decoder_renorm32(&dec);
+        }
+        
+        print_decode_speed(seconds_now() - t0,count);
+        
+        int chk = memcmp(syms,dec_syms,count*sizeof(uint32_t));
+        recip_arith_assert(chk == 0 );
+        printf("memcmp : %d\n",chk);
+        memset(dec_syms,0,count*sizeof(uint32_t));
+        
+        recip_arith_symbol_lookup_free(&lut);
+    }
     
-    uint32_t save_low = ac->low;
-    ac->low += lo;
-    ac->range = hi - lo;    
-    if ( ac->low < save_low ) recip_arith_encoder_carry(ac);
+    free(counts);
+    free(freqs);
+    free(cdf);
+}
+
+//=================================================================
+//
+// the byte decode loop with decode_table + cdf (three loads) vs. recip_arith_fused decode_symbol
+
+static void test_fused_decode(const uint8_t * file_buf,size_t file_len,uint32_t cdf_bits,
+                                uint8_t * comp_buf,uint8_t * dec_buf)
+{
+    uint32_t counts[256] = { };
+    uint32_t freqs[256];
+    uint32_t cdf[257];
+
+    for(size_t i=0;i<file_len;i++) counts[ file_buf[i] ] += 1;
+
+    if ( ! recip_arith_normalize_counts(freqs,counts,256,cdf_bits) )
+    {
+        printf("fused decode : can't normalize histogram , skipped\n");
+        return;
+    }
+    recip_arith_cdf_from_freqs(cdf,freqs,256);
+
+    const uint32_t cdf_tot = (uint32_t)1<<cdf_bits;
+    uint8_t * decode_table = (uint8_t *)malloc(cdf_tot+1);
+    for(uint32_t s=0;s<256;s++)
+        for(uint32_t c=cdf[s];c<cdf[s+1];c++)
+            decode_table[c] = (uint8_t) s;
+    decode_table[cdf_tot] = decode_table[cdf_tot-1];
+
+    recip_arith_fused_table ft;
+    if ( ! recip_arith_fused_table_init(&ft,cdf,256,cdf_bits) )
+    {
+        printf("fused decode : recip_arith_fused_table_init failed , skipped\n");
+        free(decode_table);
+        return;
+    }
+
+    printf("fused decode : cdf_bits %d , %s\n",(int)cdf_bits,( ft.mode == RECIP_ARITH_FUSED_SLOTS ) ? "slots" : "buckets");
+
+    recip_arith_encoder enc;
+    recip_arith_encoder_start(&enc,comp_buf);
+
+    for(size_t i=0;i<file_len;i++)
+    {
+        int sym = file_buf[i];
+        recip_arith_encoder_put(&enc,cdf[sym],cdf[sym+1] - cdf[sym],cdf_bits);
+        recip_arith_encoder_renorm(&enc);
+    }
+
+    uint8_t * comp_end = recip_arith_encoder_finish(&enc);
+    size_t comp_len = comp_end - comp_buf;
+
+    printf("comp_len : %d = %.3f bpb\n",(int)comp_len,comp_len*8.0/file_len);
+
+    {
+    printf("decode_table + cdf : ");
+
+    recip_arith_decoder dec;
+
+    double t0 = seconds_now();
+
+    recip_arith_decoder_start(&dec,comp_buf);
+
+    for(size_t i=0;i<file_len;i++)
+    {
+        uint32_t target = recip_arith_decoder_peek(&dec,cdf_bits);
+        uint8_t sym = decode_table[target];
+        dec_buf[i] = sym;
+        uint32_t low = cdf[sym];
+        uint32_t freq = cdf[sym+1] - low;
+        recip_arith_decoder_remove(&dec,low,freq);
+        recip_arith_decoder_renorm(&dec);
+    }
+
+    print_decode_speed(seconds_now() - t0,file_len);
+
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    }
+
+    {
+    printf("fused decode_symbol : ");
+
+    recip_arith_decoder dec;
+
+    double t0 = seconds_now();
+
+    recip_arith_decoder_start(&dec,comp_buf);
+
+    if ( ft.mode == RECIP_ARITH_FUSED_SLOTS )
+    {
+        for(size_t i=0;i<file_len;i++)
+        {
+            dec_buf[i] = (uint8_t) recip_arith_decoder_decode_symbol_slots(&dec,&ft);
+            recip_arith_decoder_renorm(&dec);
+        }
+    }
+    else
+    {
+        for(size_t i=0;i<file_len;i++)
+        {
+            dec_buf[i] = (uint8_t) recip_arith_decoder_decode_symbol_buckets(&dec,&ft);
+            recip_arith_decoder_renorm(&dec);
+        }
+    }
+
+    print_decode_speed(seconds_now() - t0,file_len);
+
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    }
+
+    recip_arith_fused_table_free(&ft);
+    free(decode_table);
+}
+
+//=================================================================
+//
+// recip_arith_stream callbacks : a small buffer flushed to a memory sink ,
+//  and a memory source handed out in odd-sized chunks
+
+struct test_stream_sink
+{
+    uint8_t * out;
+    size_t out_len;
+    uint8_t * buf;
+    size_t buf_size;
+};
+
+static uint8_t * test_stream_flush(void * user,uint8_t * buf,size_t len,size_t * p_capacity)
+{
+    test_stream_sink * sink = (test_stream_sink *)user;
+    memcpy(sink->out + sink->out_len,buf,len);
+    sink->out_len += len;
+    *p_capacity = sink->buf_size;
+    return sink->buf;
+}
+
+struct test_stream_source
+{
+    const uint8_t * ptr;
+    size_t len;
+    size_t chunk_size;
+};
+
+static const uint8_t * test_stream_refill(void * user,size_t * p_len)
+{
+    test_stream_source * source = (test_stream_source *)user;
+    size_t len = source->len < source->chunk_size ? source->len : source->chunk_size;
+    const uint8_t * chunk = source->ptr;
+    source->ptr += len;
+    source->len -= len;
+    *p_len = len;
+    return chunk;
 }
 
 //=================================================================
@@ -127,7 +415,8 @@ int main(int argc,char * argv[])
     printf("loaded %s , len=%d\n",argv[1],(int)file_len);
 
     uint8_t * dec_buf = (uint8_t *) malloc(file_len);
-    uint8_t * comp_buf = (uint8_t *) malloc(file_len + (file_len/8) + 4096);
+    // adaptive models can expand incompressible data more than the static coders :
+    uint8_t * comp_buf = (uint8_t *) malloc(file_len + (file_len/4) + 4096);
 
     //-----------------------------------------
     
@@ -169,7 +458,9 @@ int main(int argc,char * argv[])
     uint32_t cdf[257];
     
     uint8_t * decode_table;
-    decode_table = (uint8_t *)malloc(cdf_tot+1);
+    // SIMD decoders gather 4 bytes from decode_table , so pad it :
+    decode_table = (uint8_t *)malloc(cdf_tot+RECIP_ARITH_SIMD_DECODE_TABLE_PADDING);
+    memset(decode_table,0,cdf_tot+RECIP_ARITH_SIMD_DECODE_TABLE_PADDING);
     
     cdf[0] = 0;
     for(int i=0;i<256;i++)
@@ -188,6 +479,7 @@ int main(int argc,char * argv[])
     recip_arith_assert( cdf[256] == cdf_tot );
         
     //-----------------------------------------
+    size_t comp_len_sm98;
     size_t comp_len_cacm87;
     size_t comp_len_rangecoder;
     size_t comp_len_reciparith;
@@ -210,10 +502,30 @@ int main(int argc,char * argv[])
     
     uint8_t * comp_end = recip_arith_encoder_finish(&enc);
 
-    size_t comp_len_sm98 = comp_end - comp_buf; 
+    comp_len_sm98 = comp_end - comp_buf; 
 
     printf("comp_len : %d = %.3f bpb\n",(int)comp_len_sm98,comp_len_sm98*8.0/file_len);
 
+    recip_arith_decoder dec;
+        
+    recip_arith_decoder_start(&dec,comp_buf);
+    
+    for(size_t i=0;i<file_len;i++) 
+    {
+        uint32_t target = recip_arith_decoder_peek_sm98(&dec,cdf_bits);
+        uint8_t sym = decode_table[target];
+        dec_buf[i] = sym;
+        uint32_t low = cdf[sym];
+        uint32_t freq = cdf[sym+1] - low; // == histogram[sym]      
+        recip_arith_decoder_remove_sm98(&dec,low,freq,cdf_bits);
+        recip_arith_decoder_renorm(&dec);
+    }
+        
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+
     }
     //-----------------------------------------
     {   
@@ -293,6 +605,8 @@ int main(int argc,char * argv[])
     
     recip_arith_decoder dec;
     
+    double t0 = seconds_now();
+    
     recip_arith_decoder_start(&dec,comp_buf);
     
     for(size_t i=0;i<file_len;i++) 
@@ -307,6 +621,8 @@ int main(int argc,char * argv[])
         recip_arith_decoder_renorm(&dec);
     }
     
+    print_decode_speed(seconds_now() - t0,file_len);
+    
     int chk = memcmp(file_buf,dec_buf,file_len);
     recip_arith_assert(chk == 0 );
     printf("memcmp : %d\n",chk);
@@ -343,6 +659,8 @@ int main(int argc,char * argv[])
     
     recip_arith_decoder dec;
         
+    double t0 = seconds_now();
+
     recip_arith_decoder_start(&dec,comp_buf);
     
     for(size_t i=0;i<file_len;i++) 
@@ -355,6 +673,8 @@ int main(int argc,char * argv[])
         recip_arith_decoder_remove(&dec,low,freq);
         recip_arith_decoder_renorm(&dec);
     }
+    
+    print_decode_speed(seconds_now() - t0,file_len);
         
     int chk = memcmp(file_buf,dec_buf,file_len);
     recip_arith_assert(chk == 0 );
@@ -366,10 +686,12 @@ int main(int argc,char * argv[])
     {
     
     recip_arith64_decoder dec;
+    
+    double t0 = seconds_now();
         
     recip_arith64_decoder_start(&dec,comp_buf);
     
-    recip_arith_assert( (3*cdf_bits) + RECIP_ARITH_TABLE_BITS <= 56 );
+    recip_arith_assert( RECIP_ARITH64_SYMBOLS_PER_RENORM(cdf_bits) >= 3 );
     
     uint8_t * pout = dec_buf;
     for(size_t i=0;i<(file_len/3);i++) 
@@ -392,8 +714,7 @@ int main(int argc,char * argv[])
         pout += 3;
         
         recip_arith64_decoder_renorm(&dec);
-        // no advantage :
-        //recip_arith64_decoder_renorm_branchless(&dec);
+        // see the recip_arith64_decoder_renorm_branchless test below
     }
     
     for(size_t i=0;i<(file_len%3);i++) 
@@ -405,12 +726,1245 @@ int main(int argc,char * argv[])
         
         recip_arith64_decoder_renorm(&dec);
     }
+    
+    print_decode_speed(seconds_now() - t0,file_len);
+        
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    }
+    //-----------------------------------------
+    {
+    
+    // same stream with the branchless renorms :
+    //  comp_buf has far more than RECIP_ARITH_DECODER_TAIL_PADDING bytes after the stream
+    printf("recip_arith decoder branchless renorm:\n");
+    
+    recip_arith_decoder dec;
+    
+    double t0 = seconds_now();
+
+    recip_arith_decoder_start(&dec,comp_buf);
+    
+    for(size_t i=0;i<file_len;i++) 
+    {
+        uint32_t target = recip_arith_decoder_peek(&dec,cdf_bits);
+        uint8_t sym = decode_table[target];
+        dec_buf[i] = sym;
+        recip_arith_decoder_remove(&dec,cdf[sym],cdf[sym+1] - cdf[sym]);
+        recip_arith_decoder_renorm_branchless(&dec);
+    }
+    
+    print_decode_speed(seconds_now() - t0,file_len);
+        
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    }
+    //-----------------------------------------
+    {
+    
+    printf("recip_arith64 decoder branchless renorm:\n");
+    
+    recip_arith64_decoder dec;
+    
+    double t0 = seconds_now();
+        
+    recip_arith64_decoder_start(&dec,comp_buf);
+    
+    for(size_t i=0;i<file_len;) 
+    {
+        for(int j=0;j<3 && i<file_len;j++,i++)
+        {
+            uint64_t target = recip_arith64_decoder_peek(&dec,cdf_bits);
+            uint64_t sym = decode_table[target];    
+            dec_buf[i] = (uint8_t) sym;
+            recip_arith64_decoder_remove(&dec,cdf[sym],cdf[sym+1] - cdf[sym]);
+        }
+        recip_arith64_decoder_renorm_branchless(&dec);
+    }
+    
+    print_decode_speed(seconds_now() - t0,file_len);
         
     int chk = memcmp(file_buf,dec_buf,file_len);
     recip_arith_assert(chk == 0 );
     printf("memcmp : %d\n",chk);
     memset(dec_buf,0,file_len);
     
+    }
+    //-----------------------------------------
+    {
+    
+    // library block coder , symbols per renorm from cdf_bits at compile time :
+    uint8_t * block_buf = (uint8_t *) malloc(file_len + (file_len/4) + 4096 + RECIP_ARITH_DECODER_TAIL_PADDING);
+    
+    for(uint32_t block_cdf_bits=10;block_cdf_bits<=13;block_cdf_bits+=3)
+    {
+        printf("recip_arith encode_block / decode_block , cdf_bits %d , %d symbols per renorm:\n",
+            (int)block_cdf_bits,(int)RECIP_ARITH64_WORD_SYMBOLS_PER_RENORM(block_cdf_bits));
+        
+        uint32_t block_counts[256] = { };
+        for(size_t i=0;i<file_len;i++) block_counts[ file_buf[i] ] += 1;
+        uint32_t block_freqs[256];
+        uint32_t block_cdf[257];
+        recip_arith_normalize_counts(block_freqs,block_counts,256,block_cdf_bits);
+        recip_arith_cdf_from_freqs(block_cdf,block_freqs,256);
+        
+        uint8_t * block_decode_table = (uint8_t *) malloc((size_t)1<<block_cdf_bits);
+        for(int s=0;s<256;s++)
+            memset(block_decode_table + block_cdf[s],s,block_freqs[s]);
+        
+        uint8_t * block_end = recip_arith_encode_block(block_buf,file_buf,file_len,block_cdf,block_cdf_bits);
+        recip_arith_assert( block_end != NULL );
+        size_t block_len = block_end - block_buf;
+        memset(block_end,0,RECIP_ARITH_DECODER_TAIL_PADDING);
+        
+        printf("comp_len : %d = %.3f bpb\n",(int)block_len,block_len*8.0/file_len);
+        
+        double t0 = seconds_now();
+        
+        bool ok = recip_arith_decode_block(dec_buf,file_len,block_buf,block_cdf,block_decode_table,block_cdf_bits);
+        recip_arith_assert( ok );
+        
+        print_decode_speed(seconds_now() - t0,file_len);
+        printf("decode_block ok : %d\n",ok ? 1 : 0);
+        
+        int chk = memcmp(file_buf,dec_buf,file_len);
+        recip_arith_assert(chk == 0 );
+        printf("memcmp : %d\n",chk);
+        memset(dec_buf,0,file_len);
+        
+        // it's the recip_arith_encoder bitstream , the plain decoder reads it :
+        recip_arith_decoder dec;
+        recip_arith_decoder_start(&dec,block_buf);
+        for(size_t i=0;i<file_len;i++)
+        {
+            uint32_t target = recip_arith_decoder_peek(&dec,block_cdf_bits);
+            uint8_t sym = block_decode_table[target];
+            dec_buf[i] = sym;
+            recip_arith_decoder_remove(&dec,block_cdf[sym],block_freqs[sym]);
+            recip_arith_decoder_renorm(&dec);
+        }
+        chk = memcmp(file_buf,dec_buf,file_len);
+        recip_arith_assert(chk == 0 );
+        printf("recip_arith_decoder : memcmp : %d\n",chk);
+        memset(dec_buf,0,file_len);
+        
+        free(block_decode_table);
+    }
+    
+    free(block_buf);
+    
+    }
+    //-----------------------------------------
+    {
+
+    // left-justified range : same bitstream , no clz before the table lookup
+    printf("recip_arith left-justified range:\n");
+
+    uint8_t * lj_buf = (uint8_t *) malloc(comp_len_reciparith + 4096);
+
+    recip_arith_lj_encoder enc;
+    recip_arith_lj_encoder_start(&enc,lj_buf);
+
+    for(size_t i=0;i<file_len;i++)
+    {
+        int sym = file_buf[i];
+        recip_arith_lj_encoder_put(&enc,cdf[sym],cdf[sym+1] - cdf[sym],cdf_bits);
+        recip_arith_lj_encoder_renorm(&enc);
+    }
+
+    size_t lj_len = recip_arith_lj_encoder_finish(&enc) - lj_buf;
+
+    // compare to the recip_arith_encoder stream still in comp_buf :
+    int chk = ( lj_len == comp_len_reciparith ) ? memcmp(comp_buf,lj_buf,lj_len) : 1;
+    recip_arith_assert(chk == 0 );
+    printf("same bitstream : memcmp : %d\n",chk);
+
+    free(lj_buf);
+
+    for(int branchless=0;branchless<2;branchless++)
+    {
+        recip_arith_lj_decoder dec;
+
+        double t0 = seconds_now();
+
+        recip_arith_lj_decoder_start(&dec,comp_buf);
+
+        if ( branchless )
+        {
+            for(size_t i=0;i<file_len;i++)
+            {
+                uint32_t target = recip_arith_lj_decoder_peek(&dec,cdf_bits);
+                uint8_t sym = decode_table[target];
+                dec_buf[i] = sym;
+                recip_arith_lj_decoder_remove(&dec,cdf[sym],cdf[sym+1] - cdf[sym]);
+                recip_arith_lj_decoder_renorm_branchless(&dec);
+            }
+        }
+        else
+        {
+            for(size_t i=0;i<file_len;i++)
+            {
+                uint32_t target = recip_arith_lj_decoder_peek(&dec,cdf_bits);
+                uint8_t sym = decode_table[target];
+                dec_buf[i] = sym;
+                recip_arith_lj_decoder_remove(&dec,cdf[sym],cdf[sym+1] - cdf[sym]);
+                recip_arith_lj_decoder_renorm(&dec);
+            }
+        }
+
+        printf("%s : ",branchless ? "branchless renorm" : "byte renorm");
+        print_decode_speed(seconds_now() - t0,file_len);
+
+        chk = memcmp(file_buf,dec_buf,file_len);
+        recip_arith_assert(chk == 0 );
+        printf("memcmp : %d\n",chk);
+        memset(dec_buf,0,file_len);
+    }
+
+    }
+    //-----------------------------------------
+    {
+
+    // bounds-checked decode of the same stream , then of broken copies of it :
+    printf("recip_arith checked decoder:\n");
+    
+    double t0 = seconds_now();
+    
+    int status = recip_arith_checked_decode(dec_buf,file_len,comp_buf,comp_len_reciparith,cdf,decode_table,cdf_bits);
+    
+    print_decode_speed(seconds_now() - t0,file_len);
+    
+    recip_arith_assert( status == RECIP_ARITH_DECODE_OK );
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    // truncated :
+    status = recip_arith_checked_decode(dec_buf,file_len,comp_buf,comp_len_reciparith/2,cdf,decode_table,cdf_bits);
+    printf("truncated : status %d\n",status);
+    recip_arith_assert( status != RECIP_ARITH_DECODE_OK );
+    
+    // all 0xFF can't be a valid stream : code >= range right away
+    uint8_t * junk = (uint8_t *)malloc(comp_len_reciparith);
+    memset(junk,0xFF,comp_len_reciparith);
+    status = recip_arith_checked_decode(dec_buf,file_len,junk,comp_len_reciparith,cdf,decode_table,cdf_bits);
+    printf("all 0xFF : status %d\n",status);
+    recip_arith_assert( status == RECIP_ARITH_DECODE_CORRUPT );
+    
+    // random damage is not always detectable , but must stay in bounds :
+    memcpy(junk,comp_buf,comp_len_reciparith);
+    for(size_t i=0;i<comp_len_reciparith;i+=997) junk[i] ^= 0x5A;
+    status = recip_arith_checked_decode(dec_buf,file_len,junk,comp_len_reciparith,cdf,decode_table,cdf_bits);
+    printf("damaged : status %d\n",status);
+    free(junk);
+    memset(dec_buf,0,file_len);
+    
+    }
+    //-----------------------------------------
+    {
+    
+    // the compile-time table matches recip_arith_table_init :
+    typedef recip_arith_coder_t<RECIP_ARITH_TABLE_BITS,RECIP_ARITH_NUMERATOR_BITS,cdf_bits> coder_default;
+    int chk = memcmp(coder_default::c_recip_table.table,recip_arith_table,sizeof(recip_arith_table));
+    recip_arith_assert(chk == 0 );
+    printf("recip table memcmp : %d\n",chk);
+    
+    // and makes the same bitstream :
+    size_t comp_len = test_template_coder<coder_default>(file_buf,file_len,comp_buf,dec_buf,cdf,decode_table);
+    recip_arith_assert( comp_len == comp_len_reciparith );
+    (void)comp_len;
+    
+    // another configuration in the same binary ; 10 table bits needs 33 numerator bits at cdf_bits 13 :
+    test_template_coder< recip_arith_coder_t<10,33,cdf_bits> >(file_buf,file_len,comp_buf,dec_buf,cdf,decode_table);
+    
+    }
+    //-----------------------------------------
+    {
+    
+    printf("recip_arith64 encoder (32-bit words):\n");
+    
+    // several symbols per renorm when cdf_bits is small enough :
+    const int syms_per_renorm = RECIP_ARITH64_WORD_SYMBOLS_PER_RENORM(cdf_bits);
+    recip_arith_assert( syms_per_renorm >= 1 );
+
+    recip_arith64_encoder enc;
+    recip_arith64_encoder_start(&enc,comp_buf);
+    
+    for(size_t i=0;i<file_len;) 
+    {
+        for(int j=0;j<syms_per_renorm && i<file_len;j++,i++)
+        {
+            int sym = file_buf[i];
+            uint32_t low = cdf[sym];
+            uint32_t freq = cdf[sym+1] - low; // == histogram[sym]
+            
+            recip_arith64_encoder_put(&enc,low,freq,cdf_bits);
+        }
+        recip_arith64_encoder_renorm(&enc);
+    }
+    
+    uint8_t * comp_end = recip_arith64_encoder_finish(&enc);
+
+    size_t comp_len = comp_end - comp_buf; 
+
+    printf("comp_len : %d = %.3f bpb\n",(int)comp_len,comp_len*8.0/file_len);
+    
+    // same bitstream as the 32-bit encoder , so the 32-bit decoder reads it :
+    recip_arith_decoder dec;
+    recip_arith_decoder_start(&dec,comp_buf);
+    
+    for(size_t i=0;i<file_len;i++) 
+    {
+        uint32_t target = recip_arith_decoder_peek(&dec,cdf_bits);
+        uint8_t sym = decode_table[target];
+        dec_buf[i] = sym;
+        uint32_t low = cdf[sym];
+        uint32_t freq = cdf[sym+1] - low; // == histogram[sym]      
+        recip_arith_decoder_remove(&dec,low,freq);
+        recip_arith_decoder_renorm(&dec);
+    }
+    
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    // and the 64-bit decoder with word renorm :
+    recip_arith64_decoder dec64;
+    
+    double t0 = seconds_now();
+    
+    recip_arith64_decoder_start(&dec64,comp_buf);
+    
+    for(size_t i=0;i<file_len;) 
+    {
+        for(int j=0;j<syms_per_renorm && i<file_len;j++,i++)
+        {
+            uint64_t target = recip_arith64_decoder_peek(&dec64,cdf_bits);
+            uint64_t sym = decode_table[target];    
+            dec_buf[i] = (uint8_t) sym;
+            recip_arith64_decoder_remove(&dec64,cdf[sym],cdf[sym+1] - cdf[sym]);
+        }
+        recip_arith64_decoder_renorm32(&dec64);
+    }
+    
+    print_decode_speed(seconds_now() - t0,file_len);
+    
+    chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    }
+    //-----------------------------------------
+    {
+    
+    // symbol lookups without a (1<<cdf_bits) decode_table :
+    //  bytes and byte pairs (a 65536-symbol alphabet) at cdf_bits 16 , the max for the default table_bits
+    //  a direct decode_table would be 64k , too big for L1
+    uint32_t * syms = (uint32_t *)malloc(file_len*sizeof(uint32_t));
+    uint32_t * dec_syms = (uint32_t *)malloc(file_len*sizeof(uint32_t));
+    
+    for(size_t i=0;i<file_len;i++) syms[i] = file_buf[i];
+    test_symbol_lookup(syms,file_len,256,RECIP_ARITH_MAX_CDF_BITS,comp_buf,dec_syms);
+    
+    size_t num_pairs = file_len/2;
+    for(size_t i=0;i<num_pairs;i++) syms[i] = file_buf[2*i] | (file_buf[2*i+1]<<8);
+    test_symbol_lookup(syms,num_pairs,65536,RECIP_ARITH_MAX_CDF_BITS,comp_buf,dec_syms);
+    
+    free(syms);
+    free(dec_syms);
+
+    }
+    //-----------------------------------------
+    {
+
+    // one-load fused decode tables , per-slot at 12 bits , bucketed above :
+    printf("recip_arith fused decode table:\n");
+
+    test_fused_decode(file_buf,file_len,12,comp_buf,dec_buf);
+    test_fused_decode(file_buf,file_len,cdf_bits,comp_buf,dec_buf);
+    test_fused_decode(file_buf,file_len,RECIP_ARITH_MAX_CDF_BITS,comp_buf,dec_buf);
+
+    }
+    //-----------------------------------------
+    {
+
+    // raw bits : the file as 16-bit bypass words , then each byte followed by 12 extra bits ,
+    //  those through put_bits vs. through _put with freq 1
+    printf("recip_arith bypass bits:\n");
+
+    size_t num_words = file_len/2;
+
+    recip_arith_encoder enc;
+    recip_arith_encoder_start(&enc,comp_buf);
+
+    for(size_t i=0;i<num_words;i++)
+    {
+        uint32_t word = file_buf[2*i] | (file_buf[2*i+1]<<8);
+        recip_arith_encoder_put_bits(&enc,word,16);
+        recip_arith_encoder_renorm(&enc);
+    }
+
+    size_t comp_len = recip_arith_encoder_finish(&enc) - comp_buf;
+
+    printf("16-bit words : comp_len : %d , %.4f bits lost per put_bits\n",(int)comp_len,
+        num_words ? (comp_len*8.0 - num_words*16.0)/num_words : 0.0);
+
+    {
+    recip_arith_decoder dec;
+
+    double t0 = seconds_now();
+
+    recip_arith_decoder_start(&dec,comp_buf);
+
+    for(size_t i=0;i<num_words;i++)
+    {
+        uint32_t word = recip_arith_decoder_get_bits(&dec,16);
+        dec_buf[2*i] = (uint8_t) word;
+        dec_buf[2*i+1] = (uint8_t)(word>>8);
+        recip_arith_decoder_renorm(&dec);
+    }
+
+    print_decode_speed(seconds_now() - t0,num_words*2);
+
+    int chk = memcmp(file_buf,dec_buf,num_words*2);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    }
+
+    const uint32_t extra_bits = 12;
+    uint16_t * extras = (uint16_t *)malloc(file_len*sizeof(uint16_t));
+    uint16_t * dec_extras = (uint16_t *)malloc(file_len*sizeof(uint16_t));
+    memset(dec_extras,0,file_len*sizeof(uint16_t)); // fault it in before the timings
+    uint8_t * mixed_buf = (uint8_t *)malloc(file_len*3 + 4096);
+
+    for(size_t i=0;i<file_len;i++)
+        extras[i] = (uint16_t)( ((uint32_t)i * 2654435761u) >> (32 - extra_bits) );
+
+    for(int bypass=1;bypass>=0;bypass--)
+    {
+        recip_arith_encoder_start(&enc,mixed_buf);
+
+        for(size_t i=0;i<file_len;i++)
+        {
+            int sym = file_buf[i];
+            recip_arith_encoder_put(&enc,cdf[sym],cdf[sym+1] - cdf[sym],cdf_bits);
+            recip_arith_encoder_renorm(&enc);
+            if ( bypass )
+                recip_arith_encoder_put_bits(&enc,extras[i],extra_bits);
+            else
+                recip_arith_encoder_put(&enc,extras[i],1,extra_bits);
+            recip_arith_encoder_renorm(&enc);
+        }
+
+        size_t mixed_len = recip_arith_encoder_finish(&enc) - mixed_buf;
+
+        // cost of the extra bits over the modeled-only stream :
+        printf("byte + %d bits , %s : extra bits cost %.4f bits\n",(int)extra_bits,bypass ? "put_bits" : "put freq 1",
+            (mixed_len*8.0 - comp_len_reciparith*8.0)/file_len);
+
+        recip_arith_decoder dec;
+
+        double t0 = seconds_now();
+
+        recip_arith_decoder_start(&dec,mixed_buf);
+
+        for(size_t i=0;i<file_len;i++)
+        {
+            uint32_t target = recip_arith_decoder_peek(&dec,cdf_bits);
+            uint8_t sym = decode_table[target];
+            dec_buf[i] = sym;
+            recip_arith_decoder_remove(&dec,cdf[sym],cdf[sym+1] - cdf[sym]);
+            recip_arith_decoder_renorm(&dec);
+            if ( bypass )
+            {
+                dec_extras[i] = (uint16_t) recip_arith_decoder_get_bits(&dec,extra_bits);
+            }
+            else
+            {
+                uint32_t value = recip_arith_decoder_peek(&dec,extra_bits);
+                recip_arith_decoder_remove(&dec,value,1);
+                dec_extras[i] = (uint16_t) value;
+            }
+            recip_arith_decoder_renorm(&dec);
+        }
+
+        print_decode_speed(seconds_now() - t0,file_len);
+
+        int chk = memcmp(file_buf,dec_buf,file_len) | memcmp(extras,dec_extras,file_len*sizeof(uint16_t));
+        recip_arith_assert(chk == 0 );
+        printf("memcmp : %d\n",chk);
+        memset(dec_buf,0,file_len);
+    }
+
+    free(extras);
+    free(dec_extras);
+    free(mixed_buf);
+
+    }
+    //-----------------------------------------
+    {
+    
+    // block-parallel container ; small blocks so the test file has several :
+    printf("recip_arith_block container:\n");
+    
+    const uint32_t block_size = 64*1024;
+    const int num_threads = 4;
+    int hw_threads = (int)std::thread::hardware_concurrency();
+    if ( hw_threads < 1 ) hw_threads = 1;
+    
+    uint64_t bound = recip_arith_block_compress_bound(file_len,block_size);
+    uint8_t * container = (uint8_t *)malloc((size_t)bound);
+    
+    uint64_t container_len = recip_arith_block_compress(container,bound,file_buf,file_len,block_size,cdf_bits,num_threads);
+    recip_arith_assert( container_len != 0 );
+    
+    printf("comp_len : %d = %.3f bpb\n",(int)container_len,container_len*8.0/file_len);
+    
+    uint64_t raw_len = 0;
+    bool ok = recip_arith_block_get_raw_len(container,container_len,&raw_len);
+    recip_arith_assert( ok && raw_len == file_len );
+    printf("get_raw_len ok : %d\n",( ok && raw_len == file_len ) ? 1 : 0);
+    
+    ok = recip_arith_block_decompress(dec_buf,file_len,container,container_len,num_threads);
+    recip_arith_assert( ok );
+    printf("decompress ok : %d\n",ok ? 1 : 0);
+    
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    // scaling , best of 3 wall clock :
+    printf("hardware threads : %d\n",hw_threads);
+    const int thread_counts[4] = { 1, 2, 4, hw_threads };
+    for(int c=0;c<4;c++)
+    {
+        int threads = thread_counts[c];
+        if ( c == 3 && threads <= 4 ) break;
+        
+        double enc_secs = 0, dec_secs = 0;
+        for(int r=0;r<3;r++)
+        {
+            double t0 = seconds_now();
+            uint64_t len = recip_arith_block_compress(container,bound,file_buf,file_len,block_size,cdf_bits,threads);
+            double t1 = seconds_now();
+            ok = ( len == container_len ) && recip_arith_block_decompress(dec_buf,file_len,container,container_len,threads);
+            double t2 = seconds_now();
+            recip_arith_assert( ok );
+            if ( r == 0 || t1 - t0 < enc_secs ) enc_secs = t1 - t0;
+            if ( r == 0 || t2 - t1 < dec_secs ) dec_secs = t2 - t1;
+        }
+        if ( enc_secs <= 0.0 ) enc_secs = 1e-9;
+        if ( dec_secs <= 0.0 ) dec_secs = 1e-9;
+        
+        chk = memcmp(file_buf,dec_buf,file_len);
+        recip_arith_assert(chk == 0 );
+        printf("%d threads : encode : %.1f MB/s , decode : %.1f MB/s , memcmp : %d\n",threads,
+            file_len/(enc_secs*1000000.0),file_len/(dec_secs*1000000.0),chk);
+        memset(dec_buf,0,file_len);
+    }
+    
+    free(container);
+    
+    }
+    //-----------------------------------------
+    {
+    
+    // static order-1 , per-context cdf_bits & compact tables :
+    printf("recip_arith order1 codec:\n");
+    
+    uint64_t bound = recip_arith_order1_compress_bound(file_len);
+    uint8_t * container = (uint8_t *)malloc((size_t)bound);
+    
+    recip_arith_order1_stats stats;
+    uint64_t container_len = recip_arith_order1_compress(container,bound,file_buf,file_len,RECIP_ARITH_ORDER1_DEFAULT_CDF_BITS,&stats);
+    recip_arith_assert( container_len != 0 );
+    
+    printf("comp_len : %d = %.3f bpb\n",(int)container_len,container_len*8.0/file_len);
+    printf("contexts : %d (%d coded) , tables : %d bytes sent , %d bytes in the decoder\n",
+        (int)stats.num_contexts,(int)stats.num_coded_contexts,(int)stats.header_bytes,(int)stats.table_bytes);
+    
+    uint64_t raw_len = 0;
+    bool ok = recip_arith_order1_get_raw_len(container,container_len,&raw_len);
+    recip_arith_assert( ok && raw_len == file_len );
+    printf("get_raw_len ok : %d\n",( ok && raw_len == file_len ) ? 1 : 0);
+    
+    double t0 = seconds_now();
+    
+    ok = recip_arith_order1_decompress(dec_buf,file_len,container,container_len);
+    recip_arith_assert( ok );
+    
+    print_decode_speed(seconds_now() - t0,file_len);
+    printf("decompress ok : %d\n",ok ? 1 : 0);
+    
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    // truncated input is caught , not read past :
+    ok = recip_arith_order1_decompress(dec_buf,file_len,container,container_len/2);
+    recip_arith_assert( ! ok );
+    printf("truncated rejected : %d\n",ok ? 0 : 1);
+    memset(dec_buf,0,file_len);
+    
+    free(container);
+    
+    }
+    //-----------------------------------------
+    {
+    
+    // LZ77 on the recip_arith stream , vs the order-0 recip_arith coder above :
+    printf("recip_arith lz codec:\n");
+    
+    uint64_t bound = recip_arith_lz_compress_bound(file_len);
+    uint8_t * container = (uint8_t *)malloc((size_t)bound);
+    
+    recip_arith_lz_stats stats;
+    uint64_t container_len = recip_arith_lz_compress(container,bound,file_buf,file_len,
+                                RECIP_ARITH_LZ_DEFAULT_CDF_BITS,RECIP_ARITH_LZ_DEFAULT_CHAIN,&stats);
+    recip_arith_assert( container_len != 0 );
+    
+    printf("comp_len : %d = %.3f bpb (order-0 : %.3f bpb)\n",(int)container_len,container_len*8.0/file_len,comp_len_reciparith*8.0/file_len);
+    printf("literals : %d , matches : %d covering %d bytes , extra bits : %d , cdf_bits lit %d len %d off %d\n",
+        (int)stats.num_literals,(int)stats.num_matches,(int)stats.match_bytes,(int)stats.extra_bits,
+        (int)stats.literal_cdf_bits,(int)stats.length_cdf_bits,(int)stats.offset_cdf_bits);
+    
+    uint64_t raw_len = 0;
+    bool ok = recip_arith_lz_get_raw_len(container,container_len,&raw_len);
+    recip_arith_assert( ok && raw_len == file_len );
+    printf("get_raw_len ok : %d\n",( ok && raw_len == file_len ) ? 1 : 0);
+    
+    double t0 = seconds_now();
+    
+    ok = recip_arith_lz_decompress(dec_buf,file_len,container,container_len);
+    recip_arith_assert( ok );
+    
+    print_decode_speed(seconds_now() - t0,file_len);
+    printf("decompress ok : %d\n",ok ? 1 : 0);
+    
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    // truncated input is caught , not read past :
+    ok = recip_arith_lz_decompress(dec_buf,file_len,container,container_len/2);
+    recip_arith_assert( ! ok );
+    printf("truncated rejected : %d\n",ok ? 0 : 1);
+    memset(dec_buf,0,file_len);
+    
+    free(container);
+    
+    }
+    //-----------------------------------------
+    {
+    
+    printf("recip_arith carryless encoder:\n");
+    
+    recip_arith_carryless_encoder enc;
+    recip_arith_carryless_encoder_start(&enc,comp_buf);
+    
+    for(size_t i=0;i<file_len;i++) 
+    {
+        int sym = file_buf[i];
+        recip_arith_carryless_encoder_put(&enc,cdf[sym],cdf[sym+1] - cdf[sym],cdf_bits);
+        recip_arith_carryless_encoder_renorm(&enc);
+    }
+    
+    uint8_t * comp_end = recip_arith_carryless_encoder_finish(&enc);
+
+    size_t comp_len = comp_end - comp_buf; 
+
+    printf("comp_len : %d = %.3f bpb\n",(int)comp_len,comp_len*8.0/file_len);
+    
+    // same bitstream , so the plain decoder reads it :
+    recip_arith_assert( comp_len == comp_len_reciparith );
+    
+    recip_arith_decoder dec;
+    recip_arith_decoder_start(&dec,comp_buf);
+    
+    for(size_t i=0;i<file_len;i++) 
+    {
+        uint32_t target = recip_arith_decoder_peek(&dec,cdf_bits);
+        uint8_t sym = decode_table[target];
+        dec_buf[i] = sym;
+        recip_arith_decoder_remove(&dec,cdf[sym],cdf[sym+1] - cdf[sym]);
+        recip_arith_decoder_renorm(&dec);
+    }
+    
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    }
+    //-----------------------------------------
+    {
+    
+    // streaming through a 1000 byte output buffer and 777 byte input chunks :
+    printf("recip_arith_stream:\n");
+    
+    uint8_t stream_buf[1000];
+    test_stream_sink sink = { comp_buf , 0 , stream_buf , sizeof(stream_buf) };
+    
+    recip_arith_stream_encoder enc;
+    recip_arith_stream_encoder_start(&enc,stream_buf,sizeof(stream_buf),test_stream_flush,&sink);
+    
+    for(size_t i=0;i<file_len;i++) 
+    {
+        int sym = file_buf[i];
+        recip_arith_stream_encoder_put(&enc,cdf[sym],cdf[sym+1] - cdf[sym],cdf_bits);
+        recip_arith_stream_encoder_renorm(&enc);
+    }
+    
+    bool ok = recip_arith_stream_encoder_finish(&enc);
+    recip_arith_assert( ok );
+    (void)ok;
+    
+    size_t comp_len = sink.out_len;
+    printf("comp_len : %d = %.3f bpb\n",(int)comp_len,comp_len*8.0/file_len);
+    
+    // same bitstream as recip_arith_encoder :
+    {
+    uint8_t * ref_buf = (uint8_t *)malloc(comp_len_reciparith);
+    recip_arith_encoder ref;
+    recip_arith_encoder_start(&ref,ref_buf);
+    for(size_t i=0;i<file_len;i++) 
+    {
+        int sym = file_buf[i];
+        recip_arith_encoder_put(&ref,cdf[sym],cdf[sym+1] - cdf[sym],cdf_bits);
+        recip_arith_encoder_renorm(&ref);
+    }
+    recip_arith_encoder_finish(&ref);
+    recip_arith_assert( comp_len == comp_len_reciparith );
+    recip_arith_assert( memcmp(ref_buf,comp_buf,comp_len) == 0 );
+    free(ref_buf);
+    }
+    
+    test_stream_source source = { comp_buf , comp_len , 777 };
+    
+    recip_arith_stream_decoder dec;
+    
+    double t0 = seconds_now();
+    
+    recip_arith_stream_decoder_start(&dec,test_stream_refill,&source);
+    
+    for(size_t i=0;i<file_len;i++) 
+    {
+        uint32_t target = recip_arith_decoder_peek(&dec.dec,cdf_bits);
+        uint8_t sym = decode_table[target];
+        dec_buf[i] = sym;
+        recip_arith_decoder_remove(&dec.dec,cdf[sym],cdf[sym+1] - cdf[sym]);
+        recip_arith_stream_decoder_renorm(&dec);
+    }
+    
+    print_decode_speed(seconds_now() - t0,file_len);
+    
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    // a valid stream is read only a few bytes past its end :
+    printf("overread : %d\n",(int)dec.overread);
+    recip_arith_assert( dec.overread <= RECIP_ARITH_DECODER_MAX_OVERREAD );
+    
+    // a truncated one is read further , and a masked peek keeps the lookup in bounds until we stop :
+    test_stream_source truncated = { comp_buf , comp_len/2 , 777 };
+    recip_arith_stream_decoder_start(&dec,test_stream_refill,&truncated);
+    uint32_t corrupt = 0;
+    size_t i = 0;
+    for(;i<file_len;i++) 
+    {
+        uint32_t target = recip_arith_decoder_peek_masked(&dec.dec,cdf_bits,&corrupt);
+        uint8_t sym = decode_table[target];
+        dec_buf[i] = sym;
+        recip_arith_decoder_remove(&dec.dec,cdf[sym],cdf[sym+1] - cdf[sym]);
+        recip_arith_stream_decoder_renorm(&dec);
+        if ( dec.overread > RECIP_ARITH_DECODER_MAX_OVERREAD ) break;
+    }
+    printf("truncated rejected : %d\n",( i < file_len ) ? 1 : 0);
+    recip_arith_assert( i < file_len );
+    memset(dec_buf,0,file_len);
+    
+    }
+    //-----------------------------------------
+    {
+    
+    printf("recip_arith adaptive nibble models:\n");
+    
+    recip_arith_byte_model model;
+    recip_arith_byte_model_init(&model);
+
+    recip_arith_encoder enc;
+    recip_arith_encoder_start(&enc,comp_buf);
+    
+    for(size_t i=0;i<file_len;i++) 
+    {
+        recip_arith_encoder_put_byte(&enc,&model,file_buf[i]);
+    }
+    
+    uint8_t * comp_end = recip_arith_encoder_finish(&enc);
+
+    size_t comp_len = comp_end - comp_buf; 
+
+    printf("comp_len : %d = %.3f bpb\n",(int)comp_len,comp_len*8.0/file_len);
+    
+    recip_arith_byte_model_init(&model);
+    
+    recip_arith_decoder dec;
+    
+    double t0 = seconds_now();
+    
+    recip_arith_decoder_start(&dec,comp_buf);
+    
+    for(size_t i=0;i<file_len;i++) 
+    {
+        dec_buf[i] = (uint8_t) recip_arith_decoder_get_byte(&dec,&model);
+    }
+    
+    print_decode_speed(seconds_now() - t0,file_len);
+    
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    }
+    //-----------------------------------------
+    {
+
+    // count models coded with their raw totals , no power of two rescaling :
+    printf("recip_arith count models (any cdf total):\n");
+
+    recip_arith_count_byte_model model;
+    recip_arith_count_byte_model_init(&model);
+
+    recip_arith_encoder enc;
+    recip_arith_encoder_start(&enc,comp_buf);
+
+    for(size_t i=0;i<file_len;i++)
+    {
+        recip_arith_encoder_put_count_byte(&enc,&model,file_buf[i]);
+    }
+
+    uint8_t * comp_end = recip_arith_encoder_finish(&enc);
+
+    size_t comp_len = comp_end - comp_buf;
+
+    printf("comp_len : %d = %.3f bpb\n",(int)comp_len,comp_len*8.0/file_len);
+
+    recip_arith_count_byte_model_init(&model);
+
+    recip_arith_decoder dec;
+
+    double t0 = seconds_now();
+
+    recip_arith_decoder_start(&dec,comp_buf);
+
+    for(size_t i=0;i<file_len;i++)
+    {
+        dec_buf[i] = (uint8_t) recip_arith_decoder_get_count_byte(&dec,&model);
+    }
+
+    print_decode_speed(seconds_now() - t0,file_len);
+
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+
+    // a power of two total is the plain recip_arith map :
+    recip_arith_total total;
+    recip_arith_total_init(&total,cdf_tot);
+
+    uint8_t * pow2_buf = (uint8_t *)malloc(file_len + (file_len/4) + 4096);
+    recip_arith_encoder_start(&enc,comp_buf);
+    recip_arith_encoder pow2_enc;
+    recip_arith_encoder_start(&pow2_enc,pow2_buf);
+
+    for(size_t i=0;i<file_len;i++)
+    {
+        int sym = file_buf[i];
+        recip_arith_encoder_put_total(&enc,cdf[sym],cdf[sym+1] - cdf[sym],&total);
+        recip_arith_encoder_renorm(&enc);
+        recip_arith_encoder_put(&pow2_enc,cdf[sym],cdf[sym+1] - cdf[sym],cdf_bits);
+        recip_arith_encoder_renorm(&pow2_enc);
+    }
+
+    comp_len = recip_arith_encoder_finish(&enc) - comp_buf;
+    size_t pow2_len = recip_arith_encoder_finish(&pow2_enc) - pow2_buf;
+
+    chk = ( comp_len == pow2_len ) ? memcmp(comp_buf,pow2_buf,comp_len) : 1;
+    recip_arith_assert(chk == 0 );
+    printf("total %d , same as recip_arith_encoder_put : memcmp : %d\n",(int)cdf_tot,chk);
+    free(pow2_buf);
+
+    // and an odd total : the histogram scaled to a non power of two , coded without normalizing
+    uint32_t odd_counts[257] = { };
+    for(size_t i=0;i<file_len;i++) odd_counts[ file_buf[i]+1 ] += 1;
+    uint32_t odd_total = 0;
+    for(int s=0;s<256;s++)
+    {
+        if ( odd_counts[s+1] ) odd_total += (uint32_t)( odd_counts[s+1] * (uint64_t)(RECIP_ARITH_MAX_TOTAL - 512) / file_len ) + 1;
+        odd_counts[s+1] = odd_total;
+    }
+    recip_arith_total_init(&total,odd_total);
+
+    recip_arith_encoder_start(&enc,comp_buf);
+    for(size_t i=0;i<file_len;i++)
+    {
+        int sym = file_buf[i];
+        recip_arith_encoder_put_total(&enc,odd_counts[sym],odd_counts[sym+1] - odd_counts[sym],&total);
+        recip_arith_encoder_renorm(&enc);
+    }
+    comp_len = recip_arith_encoder_finish(&enc) - comp_buf;
+
+    // loss against the cross entropy of the file under these counts :
+    double cross_entropy = 0;
+    for(size_t i=0;i<file_len;i++)
+    {
+        int sym = file_buf[i];
+        cross_entropy -= log2( (odd_counts[sym+1] - odd_counts[sym]) / (double)odd_total );
+    }
+    printf("total %d : comp_len : %d = %.4f bpb , loss vs cdf %.4f bpb\n",(int)odd_total,(int)comp_len,
+        comp_len*8.0/file_len,(comp_len*8.0 - cross_entropy)/file_len);
+
+    recip_arith_decoder_start(&dec,comp_buf);
+    for(size_t i=0;i<file_len;i++)
+    {
+        uint32_t target = recip_arith_decoder_peek_total(&dec,&total);
+        // find by binary search on the cumulative counts :
+        int lo = 0 , hi = 256;
+        while ( hi - lo > 1 )
+        {
+            int mid = (lo + hi) >> 1;
+            if ( odd_counts[mid] <= target ) lo = mid; else hi = mid;
+        }
+        int sym = lo;
+        dec_buf[i] = (uint8_t) sym;
+        recip_arith_decoder_remove(&dec,odd_counts[sym],odd_counts[sym+1] - odd_counts[sym]);
+        recip_arith_decoder_renorm(&dec);
+    }
+
+    chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+
+    }
+    //-----------------------------------------
+    {
+
+    printf("recip_arith binary bit-tree:\n");
+    
+    recip_arith_prob probs[256];
+    recip_arith_prob_init(probs,256);
+
+    recip_arith_encoder enc;
+    recip_arith_encoder_start(&enc,comp_buf);
+    
+    for(size_t i=0;i<file_len;i++) 
+    {
+        recip_arith_encoder_put_bittree(&enc,probs,8,file_buf[i]);
+    }
+    
+    uint8_t * comp_end = recip_arith_encoder_finish(&enc);
+
+    size_t comp_len = comp_end - comp_buf; 
+
+    printf("comp_len : %d = %.3f bpb\n",(int)comp_len,comp_len*8.0/file_len);
+    
+    recip_arith_prob_init(probs,256);
+    
+    recip_arith_decoder dec;
+    
+    double t0 = seconds_now();
+    
+    recip_arith_decoder_start(&dec,comp_buf);
+    
+    for(size_t i=0;i<file_len;i++) 
+    {
+        dec_buf[i] = (uint8_t) recip_arith_decoder_get_bittree(&dec,probs,8);
+    }
+    
+    print_decode_speed(seconds_now() - t0,file_len);
+    
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    }
+    //-----------------------------------------
+    {
+    
+    // binary and multi-symbol coding mixed in one stream :
+    printf("recip_arith binary + multi-symbol:\n");
+    
+    recip_arith_prob probs[256];
+    recip_arith_prob_init(probs,256);
+    recip_arith_prob flag_prob = RECIP_ARITH_BINARY_PROB_INIT;
+
+    recip_arith_encoder enc;
+    recip_arith_encoder_start(&enc,comp_buf);
+    
+    for(size_t i=0;i<file_len;i++) 
+    {
+        // flag whether this byte is the same as the last :
+        int same = ( i > 0 && file_buf[i] == file_buf[i-1] );
+        recip_arith_encoder_put_bit(&enc,&flag_prob,same);
+        if ( same ) continue;
+        
+        if ( i & 1 )
+        {
+            recip_arith_encoder_put_bittree(&enc,probs,8,file_buf[i]);
+        }
+        else
+        {
+            int sym = file_buf[i];
+            recip_arith_encoder_put(&enc,cdf[sym],cdf[sym+1]-cdf[sym],cdf_bits);
+            recip_arith_encoder_renorm(&enc);
+        }
+    }
+    
+    uint8_t * comp_end = recip_arith_encoder_finish(&enc);
+
+    size_t comp_len = comp_end - comp_buf; 
+
+    printf("comp_len : %d = %.3f bpb\n",(int)comp_len,comp_len*8.0/file_len);
+    
+    recip_arith_prob_init(probs,256);
+    flag_prob = RECIP_ARITH_BINARY_PROB_INIT;
+    
+    recip_arith_decoder dec;
+    recip_arith_decoder_start(&dec,comp_buf);
+    
+    for(size_t i=0;i<file_len;i++) 
+    {
+        if ( recip_arith_decoder_get_bit(&dec,&flag_prob) )
+        {
+            dec_buf[i] = dec_buf[i-1];
+        }
+        else if ( i & 1 )
+        {
+            dec_buf[i] = (uint8_t) recip_arith_decoder_get_bittree(&dec,probs,8);
+        }
+        else
+        {
+            uint32_t target = recip_arith_decoder_peek(&dec,cdf_bits);
+            uint8_t sym = decode_table[target];
+            dec_buf[i] = sym;
+            recip_arith_decoder_remove(&dec,cdf[sym],cdf[sym+1]-cdf[sym]);
+            recip_arith_decoder_renorm(&dec);
+        }
+    }
+    
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    }
+    //-----------------------------------------
+    for(int lanes=2;lanes<=RECIP_ARITH_INTERLEAVE_MAX_LANES;lanes*=2)
+    {
+    
+    printf("recip_arith interleaved x%d:\n",lanes);
+    
+    uint8_t * comp_end = recip_arith_interleaved_encode(comp_buf,lanes,file_buf,file_len,cdf,cdf_bits);
+    
+    size_t comp_len = comp_end - comp_buf;
+    
+    printf("comp_len : %d = %.3f bpb\n",(int)comp_len,comp_len*8.0/file_len);
+    
+    double t0 = seconds_now();
+    
+    recip_arith_interleaved_decode(dec_buf,file_len,comp_buf,lanes,cdf,decode_table,cdf_bits);
+    
+    print_decode_speed(seconds_now() - t0,file_len);
+    
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    }
+    //-----------------------------------------
+    #ifdef RECIP_ARITH_SIMD_AVX2
+    {
+    
+    printf("recip_arith AVX2 x%d:\n",RECIP_ARITH_AVX2_LANES);
+    
+    recip_arith_interleaved_encode(comp_buf,RECIP_ARITH_AVX2_LANES,file_buf,file_len,cdf,cdf_bits);
+    
+    double t0 = seconds_now();
+    
+    recip_arith_avx2_decode(dec_buf,file_len,comp_buf,cdf,decode_table,cdf_bits);
+    
+    print_decode_speed(seconds_now() - t0,file_len);
+    
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    }
+    #endif
+    //-----------------------------------------
+    #ifdef RECIP_ARITH_AVX512_LANES
+    {
+    
+    printf("recip_arith AVX-512 x%d:\n",RECIP_ARITH_AVX512_LANES);
+    
+    recip_arith_interleaved_encode(comp_buf,RECIP_ARITH_AVX512_LANES,file_buf,file_len,cdf,cdf_bits);
+    
+    double t0 = seconds_now();
+    
+    recip_arith_avx512_decode(dec_buf,file_len,comp_buf,cdf,decode_table,cdf_bits);
+    
+    print_decode_speed(seconds_now() - t0,file_len);
+    
+    int chk = memcmp(file_buf,dec_buf,file_len);
+    recip_arith_assert(chk == 0 );
+    printf("memcmp : %d\n",chk);
+    memset(dec_buf,0,file_len);
+    
+    }
+    #endif
+    //-----------------------------------------
+    {
+    
+    // every kernel level this cpu runs , against the scalar level's streams :
+    uint32_t cpu = recip_arith_cpu_features();
+    printf("recip_arith dispatch : cpu lzcnt %d bmi2 %d avx2 %d avx512 %d , best : %s\n",
+        (cpu & RECIP_ARITH_CPU_LZCNT) ? 1 : 0,(cpu & RECIP_ARITH_CPU_BMI2) ? 1 : 0,
+        (cpu & RECIP_ARITH_CPU_AVX2) ? 1 : 0,(cpu & RECIP_ARITH_CPU_AVX512) ? 1 : 0,
+        recip_arith_get_kernels()->name);
+    
+    const recip_arith_kernels * scalar = recip_arith_get_kernels_level(RECIP_ARITH_KERNELS_SCALAR);
+    recip_arith_assert( scalar != NULL );
+    
+    size_t comp_cap = file_len + (file_len/4) + 4096;
+    uint8_t * ref_block = (uint8_t *)malloc(comp_cap + RECIP_ARITH_DECODER_TAIL_PADDING);
+    uint8_t * block_end = scalar->encode_block(ref_block,file_buf,file_len,cdf,cdf_bits);
+    recip_arith_assert( block_end != NULL );
+    size_t ref_block_len = block_end - ref_block;
+    
+    uint8_t * x8_buf = (uint8_t *)malloc(comp_cap + RECIP_ARITH_INTERLEAVE_TAIL_PADDING);
+    uint8_t * x16_buf = (uint8_t *)malloc(comp_cap + RECIP_ARITH_INTERLEAVE_TAIL_PADDING);
+    recip_arith_interleaved_encode(x8_buf,8,file_buf,file_len,cdf,cdf_bits);
+    recip_arith_interleaved_encode(x16_buf,16,file_buf,file_len,cdf,cdf_bits);
+    
+    for(int level=0;level<RECIP_ARITH_KERNELS_COUNT;level++)
+    {
+        const recip_arith_kernels * k = recip_arith_get_kernels_level(level);
+        if ( k == NULL ) continue;
+        
+        memset(comp_buf,0,ref_block_len);
+        block_end = k->encode_block(comp_buf,file_buf,file_len,cdf,cdf_bits);
+        int chk = ( block_end != NULL && (size_t)(block_end - comp_buf) == ref_block_len ) ? memcmp(comp_buf,ref_block,ref_block_len) : -1;
+        recip_arith_assert(chk == 0 );
+        printf("%s encode_block stream memcmp : %d\n",k->name,chk);
+        
+        double t0 = seconds_now();
+        bool ok = k->decode_block(dec_buf,file_len,ref_block,cdf,decode_table,cdf_bits);
+        printf("%s decode_block : ",k->name);
+        print_decode_speed(seconds_now() - t0,file_len);
+        chk = ok ? memcmp(file_buf,dec_buf,file_len) : -1;
+        recip_arith_assert(chk == 0 );
+        printf("memcmp : %d\n",chk);
+        memset(dec_buf,0,file_len);
+        
+        t0 = seconds_now();
+        k->decode_x8(dec_buf,file_len,x8_buf,cdf,decode_table,cdf_bits);
+        printf("%s decode_x8 : ",k->name);
+        print_decode_speed(seconds_now() - t0,file_len);
+        chk = memcmp(file_buf,dec_buf,file_len);
+        recip_arith_assert(chk == 0 );
+        printf("memcmp : %d\n",chk);
+        memset(dec_buf,0,file_len);
+        
+        t0 = seconds_now();
+        k->decode_x16(dec_buf,file_len,x16_buf,cdf,decode_table,cdf_bits);
+        printf("%s decode_x16 : ",k->name);
+        print_decode_speed(seconds_now() - t0,file_len);
+        chk = memcmp(file_buf,dec_buf,file_len);
+        recip_arith_assert(chk == 0 );
+        printf("memcmp : %d\n",chk);
+        memset(dec_buf,0,file_len);
+    }
+    
+    free(x16_buf);
+    free(x8_buf);
+    free(ref_block);
+    
+    }
+    //-----------------------------------------
+    {
+    
+    // every map on both states ;
+    // the 32-bit ones are the plain function coders above and must make the same size streams :
+    typedef recip_arith_policy_coder_t<recip_arith_map_sm98,recip_arith_state32> coder_sm98;
+    typedef recip_arith_policy_coder_t<recip_arith_map_sm98,recip_arith_state64> coder_sm98_64;
+    typedef recip_arith_policy_coder_t<recip_arith_map_cacm87,recip_arith_state32> coder_cacm87;
+    typedef recip_arith_policy_coder_t<recip_arith_map_cacm87,recip_arith_state64> coder_cacm87_64;
+    typedef recip_arith_policy_coder_t<recip_arith_map_rangecoder,recip_arith_state32> coder_rangecoder;
+    typedef recip_arith_policy_coder_t<recip_arith_map_rangecoder,recip_arith_state64> coder_rangecoder_64;
+    typedef recip_arith_policy_coder_t<recip_arith_map_recip,recip_arith_state32> coder_recip;
+    typedef recip_arith_policy_coder_t<recip_arith_map_recip,recip_arith_state64> coder_recip_64;
+    
+    size_t len;
+    len = test_policy_coder<coder_sm98>("sm98",file_buf,file_len,comp_buf,dec_buf,cdf,decode_table,cdf_bits);
+    recip_arith_assert( len == comp_len_sm98 );
+    test_policy_coder<coder_sm98_64>("sm98 64",file_buf,file_len,comp_buf,dec_buf,cdf,decode_table,cdf_bits);
+    len = test_policy_coder<coder_cacm87>("cacm87",file_buf,file_len,comp_buf,dec_buf,cdf,decode_table,cdf_bits);
+    recip_arith_assert( len == comp_len_cacm87 );
+    test_policy_coder<coder_cacm87_64>("cacm87 64",file_buf,file_len,comp_buf,dec_buf,cdf,decode_table,cdf_bits);
+    len = test_policy_coder<coder_rangecoder>("rangecoder",file_buf,file_len,comp_buf,dec_buf,cdf,decode_table,cdf_bits);
+    recip_arith_assert( len == comp_len_rangecoder );
+    test_policy_coder<coder_rangecoder_64>("rangecoder 64",file_buf,file_len,comp_buf,dec_buf,cdf,decode_table,cdf_bits);
+    len = test_policy_coder<coder_recip>("recip",file_buf,file_len,comp_buf,dec_buf,cdf,decode_table,cdf_bits);
+    recip_arith_assert( len == comp_len_reciparith );
+    test_policy_coder<coder_recip_64>("recip 64",file_buf,file_len,comp_buf,dec_buf,cdf,decode_table,cdf_bits);
+    (void)len;
+    
+    }
+    //-----------------------------------------
+
+    {
+    
+    // expected map loss from the r_top Markov chain , vs what recip_arith actually spent over the cdf's cross entropy :
+    printf("recip_arith expected loss:\n");
+    
+    uint32_t counts[256] = { };
+    for(size_t i=0;i<file_len;i++) counts[ file_buf[i] ] += 1;
+    
+    uint32_t freqs[256];
+    double cross_entropy = 0;
+    for(int s=0;s<256;s++)
+    {
+        freqs[s] = cdf[s+1] - cdf[s];
+        if ( counts[s] ) cross_entropy -= counts[s] * log2( freqs[s] / (double)cdf_tot );
+    }
+    
+    double predicted = recip_arith_map_loss(counts,freqs,256,cdf_bits,RECIP_ARITH_TABLE_BITS);
+    double actual = (comp_len_reciparith*8.0 - cross_entropy)/file_len;
+    
+    printf("map loss : predicted %.5f bpb , actual %.5f bpb\n",predicted,actual);
+    printf("normalization loss : %.4f bpb\n",recip_arith_normalization_loss(counts,freqs,256,cdf_bits));
+    
     }
     //-----------------------------------------
 
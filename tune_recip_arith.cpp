@@ -0,0 +1,151 @@
+/**
+tune_recip_arith.cpp
+expected coding loss of a file over table_bits & cdf_bits , and the cheapest config under a target
+
+see:
+https://github.com/thecbloom/recip_arith
+
+copyright 2018 Charles Bloom
+public domain
+**/
+#define _CRT_SECURE_NO_WARNINGS
+
+/**
+
+tune_recip_arith [-target bits] [-tb min max] [-cdf min max] [-all] <files>
+
+for each file , takes the order-0 byte histogram and , without encoding anything ,
+computes the expected loss of every config with recip_arith_loss.h :
+    norm : bits per symbol lost normalizing the histogram to cdf_bits
+    map  : bits per symbol lost by the r_top-quantized cdf->range map
+then recommends the config with the smallest decode footprint (recip table + decode_table)
+whose total loss is under -target (default 0.005 bits per symbol).
+
+-all prints every config evaluated , not just the recommendation ; * marks those over the target.
+use the result as recip_arith_coder_t<table_bits,numerator_bits,cdf_bits> from recip_arith_template.h
+(the runtime coder in recip_arith.h is fixed at RECIP_ARITH_TABLE_BITS).
+
+**/
+
+#include "recip_arith.h"
+#include "recip_arith_loss.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static bool tune_count_file(const char * name,uint32_t * counts,uint64_t * p_len)
+{
+    FILE * fp = fopen(name,"rb");
+    if ( ! fp ) return false;
+
+    memset(counts,0,256*sizeof(uint32_t));
+    uint64_t len = 0;
+    static uint8_t buf[1<<16];
+    size_t got;
+    while ( (got = fread(buf,1,sizeof(buf),fp)) > 0 )
+    {
+        for(size_t i=0;i<got;i++) counts[ buf[i] ] += 1;
+        len += got;
+    }
+    fclose(fp);
+
+    *p_len = len;
+    return len > 0 && len < ((uint64_t)1<<32);
+}
+
+int main(int argc,char * argv[])
+{
+    double target = 0.005;
+    int min_tb = 2 , max_tb = 12;
+    uint32_t min_cdf = 8 , max_cdf = 16;
+    bool print_all = false;
+    int num_files = 0;
+    const char * files[256];
+
+    for(int i=1;i<argc;i++)
+    {
+        const char * arg = argv[i];
+        if ( strcmp(arg,"-target") == 0 && i+1 < argc ) target = atof(argv[++i]);
+        else if ( strcmp(arg,"-tb") == 0 && i+2 < argc ) { min_tb = atoi(argv[i+1]); max_tb = atoi(argv[i+2]); i += 2; }
+        else if ( strcmp(arg,"-cdf") == 0 && i+2 < argc ) { min_cdf = atoi(argv[i+1]); max_cdf = atoi(argv[i+2]); i += 2; }
+        else if ( strcmp(arg,"-all") == 0 ) print_all = true;
+        else if ( arg[0] == '-' || num_files == 256 )
+        {
+            fprintf(stderr,"tune_recip_arith [-target bits] [-tb min max] [-cdf min max] [-all] <files>\n");
+            return 1;
+        }
+        else files[num_files++] = arg;
+    }
+
+    if ( num_files == 0 )
+    {
+        fprintf(stderr,"tune_recip_arith [-target bits] [-tb min max] [-cdf min max] [-all] <files>\n");
+        return 1;
+    }
+    if ( min_tb < 2 ) min_tb = 2;
+    if ( max_tb > 16 ) max_tb = 16;
+
+    int ret = 0;
+
+    for(int f=0;f<num_files;f++)
+    {
+        const char * name = files[f];
+        uint32_t counts[256];
+        uint64_t len;
+        if ( ! tune_count_file(name,counts,&len) )
+        {
+            fprintf(stderr,"tune_recip_arith: can't read %s (or over 4GB)\n",name);
+            ret = 1;
+            continue;
+        }
+
+        double entropy = 0;
+        for(int s=0;s<256;s++)
+        {
+            if ( counts[s] == 0 ) continue;
+            double p = counts[s] / (double)len;
+            entropy -= p * log2(p);
+        }
+
+        printf("%s : len=%llu , order-0 entropy %.4f bpb , target loss %.4f bpb\n",name,(unsigned long long)len,entropy,target);
+
+        if ( print_all )
+        {
+            printf("%3s %3s %3s %9s %9s %9s %9s\n","tb","cdf","num","norm","map","total","bytes");
+            for(int tb=min_tb;tb<=max_tb;tb++)
+            {
+                for(uint32_t cb=min_cdf;cb<=max_cdf;cb++)
+                {
+                    if ( ! recip_arith_tune_valid(tb,cb) ) continue;
+                    recip_arith_tune_result r;
+                    if ( ! recip_arith_tune_evaluate(&r,counts,256,tb,cb) ) continue;
+                    printf("%3d %3d %3d %9.5f %9.5f %9.5f %9u%s\n",tb,(int)cb,r.numerator_bits,
+                        r.normalization_loss,r.map_loss,r.normalization_loss+r.map_loss,r.footprint,
+                        ( r.normalization_loss+r.map_loss <= target ) ? "" : " *");
+                }
+            }
+        }
+
+        recip_arith_tune_result best = { };
+        if ( recip_arith_tune(&best,counts,256,target,min_tb,max_tb,min_cdf,max_cdf) )
+        {
+            printf("recommend recip_arith_coder_t<%d,%d,%d> : loss %.5f bpb (norm %.5f + map %.5f) , %u bytes\n",
+                best.table_bits,best.numerator_bits,(int)best.cdf_bits,
+                best.normalization_loss+best.map_loss,best.normalization_loss,best.map_loss,best.footprint);
+        }
+        else if ( best.table_bits == 0 )
+        {
+            printf("no valid config in the table_bits & cdf_bits ranges\n");
+            ret = 2;
+        }
+        else
+        {
+            printf("nothing under target ; lowest loss is recip_arith_coder_t<%d,%d,%d> : %.5f bpb\n",
+                best.table_bits,best.numerator_bits,(int)best.cdf_bits,best.normalization_loss+best.map_loss);
+            ret = 2;
+        }
+    }
+
+    return ret;
+}